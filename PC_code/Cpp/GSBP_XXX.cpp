@@ -52,6 +52,25 @@
 #define __MakeUChar(X)  	(unsigned char)(X & 0x0000FF)
 
 const uint32_t gsbp_DefaultGetResponceTimeout     		= 300;
+// buffer sizes of the payload pool; the last class must hold the largest payload (+ string termination)
+const uint32_t gsbp_PayloadPoolSizes[gsbp_PayloadPoolSizeClasses] = {16, 64, 256, 1024, ((gsbp_TxMaxUserDataSize > gsbp_RxMaxUserDataSize) ? gsbp_TxMaxUserDataSize : gsbp_RxMaxUserDataSize) +1};
+
+static_assert((gsbp_RxRingBufferSize & (gsbp_RxRingBufferSize -1)) == 0, "gsbp_RxRingBufferSize must be a power of two");
+static_assert(gsbp_RxRingBufferSize > gsbp_RxMaxPackageSize, "gsbp_RxRingBufferSize must be larger than gsbp_RxMaxPackageSize");
+static_assert((gsbp_CaptureRingSize & (gsbp_CaptureRingSize -1)) == 0, "gsbp_CaptureRingSize must be a power of two");
+
+// wire capture -> record in the capture rings, followed by the captured bytes; the records are 16 byte aligned
+struct captureRecordHeader_t {
+	int64_t  TimestampNs;		// monotonic clock
+	uint32_t Size;				// gsbp_CaptureWrapMarker -> the next record starts at the beginning of the ring
+	uint32_t Reserved;
+};
+const uint32_t gsbp_CaptureWrapMarker					= 0xFFFFFFFF;
+// pcapng block types
+const uint32_t gsbp_PcapngSectionHeaderBlock			= 0x0A0D0D0A;
+const uint32_t gsbp_PcapngInterfaceDescriptionBlock		= 0x00000001;
+const uint32_t gsbp_PcapngInterfaceStatisticsBlock		= 0x00000005;
+const uint32_t gsbp_PcapngEnhancedPacketBlock			= 0x00000006;
 
 namespace ns_GSBP_XXX_01 {
 
@@ -97,11 +116,42 @@ typedef union {
      * ### #########################################################################
      */
 
+    // packet lifecycle trace -> name and argument name of the trace points (see tracePoint_t)
+    static const struct {
+    	const char* Name;
+    	const char* ArgName;
+    } TracePointNames[] = {
+    	{"SendPackage",			"cmd"},
+    	{"Request",				"id"},		// b -> cmd, e -> ack (0 -> timed out or not sent)
+    	{"Write",				"bytes"},	// E -> frames
+    	{"Select",				"result"},
+    	{"Read",				"bytes"},
+    	{"BuildPackage",		"bytes"},	// E -> ack
+    	{"AddResponse",			"ack"},
+    	{"AddResponseLock",		NULL},
+    	{"HandlerQueue",		"depth"},
+    	{"PackageHandlers",		"ack"},
+    	{"GetResponse",			"ack"},
+    	{"GetResponseWakeup",	NULL},
+    };
+    static_assert((gsbp_TraceRingSize & (gsbp_TraceRingSize -1)) == 0, "gsbp_TraceRingSize must be a power of two");
+    thread_local GSBP_XXX::traceThreadCache_t GSBP_XXX::TraceThreadCache[gsbp_TraceRingsPerThread];
+    thread_local uint32_t GSBP_XXX::TraceThreadCacheNext = 0;
+    std::atomic<uint64_t> GSBP_XXX::TraceSessions(0);
+
+    static void UpdateMaximum(std::atomic<uint64_t>& Maximum, uint64_t Value)
+    {
+    	uint64_t Current = Maximum.load(std::memory_order_relaxed);
+    	while (Value > Current && !Maximum.compare_exchange_weak(Current, Value, std::memory_order_relaxed)){
+    		// retry
+    	}
+    }
+
     /*
      * Constructors
      */
     GSBP_XXX::GSBP_XXX() : GSBP_XXX((char*)"GSBP") {}
-/*		RequestResponseBuffer(gsbp_RequestResponceBufferSize)
+/*		DuplicateResponseBuffer(gsbp_DuplicateResponseBufferSize)
     {
     	// initialise the variables
     	GSBP_XXX::InitialiseVariables();
@@ -116,7 +166,7 @@ typedef union {
 */
     GSBP_XXX::GSBP_XXX(char* DeviceID)
       : // initialisation
-		RequestResponseBuffer(gsbp_RequestResponceBufferSize)
+		DuplicateResponseBuffer(gsbp_DuplicateResponseBufferSize)
     {
         // initialise the variables
     	GSBP_XXX::InitialiseVariables();
@@ -131,7 +181,7 @@ typedef union {
 
     GSBP_XXX::GSBP_XXX(char* DeviceID, char* DeviceFileName, uint16_t DeviceClass, gsbpConfiguration_t Config)
       : // initialisation
-		RequestResponseBuffer(gsbp_RequestResponceBufferSize)
+		DuplicateResponseBuffer(gsbp_DuplicateResponseBufferSize)
     {
         // initialise the variables
     	GSBP_XXX::InitialiseVariables();
@@ -142,35 +192,74 @@ typedef union {
         this->StatsGSBP.StartTime = boost::posix_time::microsec_clock::local_time();
         // set the external configuration
         this->ExtConfig = Config;
+        GSBP_XXX::SetDefaultPackageHandler(Config.PackageHandler);
 
         // open the character device and use it as tty/virtual com port
         uint16_t ErrorCode = NoError;
         GSBP_XXX::ConnectToDevice(DeviceFileName, DeviceClass, this->ExtConfig.UseThreadToRead, &ErrorCode);
     }
 
+    GSBP_XXX::GSBP_XXX(char* DeviceID, int DeviceFd, uint16_t DeviceClass, gsbpConfiguration_t Config)
+      : // initialisation
+		DuplicateResponseBuffer(gsbp_DuplicateResponseBufferSize)
+    {
+        // initialise the variables
+    	GSBP_XXX::InitialiseVariables();
+
+        // set ID
+        sprintf(this->ID,"%s",DeviceID);
+        // set start time
+        this->StatsGSBP.StartTime = boost::posix_time::microsec_clock::local_time();
+        // set the external configuration
+        this->ExtConfig = Config;
+        GSBP_XXX::SetDefaultPackageHandler(Config.PackageHandler);
+
+        // use the open file descriptor (e.g. an in-memory transport) as device
+        uint16_t ErrorCode = NoError;
+        GSBP_XXX::ConnectToDevice(DeviceFd, DeviceClass, this->ExtConfig.UseThreadToRead, &ErrorCode);
+    }
+
     /*
      * Destructor
      */
     GSBP_XXX::~GSBP_XXX(void)
     {
+        uint16_t ErrorCode;
+        if (this->Metrics_thread != NULL){
+        	GSBP_XXX::StopMetricsSocket(&ErrorCode);
+        }
         // print some statistics
-#if GSBP__DEBUG_REQUEST_AND_RESPONSE_BUFFER
-        GSBP_XXX::PrintRequestResponseBuffer(GSBP__DEBUG_REQUEST_AND_RESPONSE_BUFFER_ALL);
-#endif
-#if GSBP__DEBUG_GSBP_STATS
-        GSBP_XXX::PrintStatsGSBP();
-#endif
-
-        // clear the queue
-        this->RequestResponseBuffer.clear();
+        if (GSBP_XXX::IsDebugEnabled(DebugRequestResponseBuffer)){
+        	GSBP_XXX::PrintRequestResponseBuffer(GSBP_XXX::IsDebugEnabled(DebugRequestResponseBufferAll));
+        }
+        if (GSBP_XXX::IsDebugEnabled(DebugGsbpStats)){
+        	GSBP_XXX::PrintStatsGSBP();
+        }
 
         // close the device
-        uint16_t ErrorCode;
         GSBP_XXX::DisconnectFromDevice(&ErrorCode);
+        if (this->Capture_thread != NULL){
+        	GSBP_XXX::StopCapture(NULL, &ErrorCode);
+        }
+        if (this->TraceActive.load()){
+        	GSBP_XXX::StopTrace(NULL, NULL, &ErrorCode);
+        }
+        GSBP_XXX::StopLogThread();
+
+        // clear the queue
+        this->DuplicateResponseBuffer.clear();
+        // release the payload pool -> after the receiver thread was stopped
+        for (auto Buffer = this->PayloadPoolBuffers.begin(); Buffer != this->PayloadPoolBuffers.end(); ++Buffer){
+        	delete[] *Buffer;
+        }
+        this->PayloadPoolBuffers.clear();
+        for (uint32_t i=0; i<gsbp_CommandIdTableSize; i++){
+        	delete this->LatencyHistograms[i].load();
+        }
     }
 
     bool GSBP_XXX::IsDeviceConnected(void){
-        return this->DeviceConnected;
+        return this->DeviceConnected && !this->DeviceHungUp;
     }
 
     bool GSBP_XXX::ConnectToDevice(char* DeviceFileName, uint16_t DeviceClass, bool UseThreadToRead, uint16_t* ErrorCode)
@@ -197,43 +286,86 @@ typedef union {
             std::cout << this->ID << "\e[1m\e[91m ERROR:\e[0m Can't open device " << this->DeviceFileName << "!!!" << std::endl;
             std::cout << "   " << strerror(errno) << " (" << errno << ")" << std::endl << std::endl;
             return false;
-        } else {
-            // file / socket is open
-            this->DeviceConnected = true;
-#if GSBP__DEBUG_SERIAL_ACTIONS
-            std::cout << this->ID << ": Opening device " << this->DeviceFileName << " was successful!" << std::endl;
-#endif
-            // flush the serial data stream
-            tcflush(fd, TCIOFLUSH);
-
-            if (this->ExtConfig.UseThreadToRead) {
-            	// start receiving packages
-            	this->RunReceiverThread = true;
-            	this->ReceiverThreatRunning = true;
-            	this->Receiver_thread = new boost::thread(&GSBP_XXX::ReadPackages, this, false);
-            	this->ReceiverThreatRunning = true;
-#if GSBP__DEBUG_SERIAL_ACTIONS
-            	std::cout << this->ID << ": Receiver threat started" << std::endl;
-#endif
+        }
+        if (GSBP_XXX::IsDebugEnabled(DebugSerialActions)){
+        	std::cout << this->ID << ": Opening device " << this->DeviceFileName << " was successful!" << std::endl;
+        }
+        return GSBP_XXX::StartConnection(ErrorCode);
+    }
+
+    /*
+     * connects to a device, which is already open (e.g. one end of a socketpair() or a pipe to a simulated device)
+     * -> the interface takes the ownership of the file descriptor; it is closed with DisconnectFromDevice()
+     */
+    bool GSBP_XXX::ConnectToDevice(int DeviceFd, uint16_t DeviceClass, bool UseThreadToRead, uint16_t* ErrorCode)
+    {
+    	*ErrorCode = NoError;
+
+    	// check if already connected
+    	if (this->DeviceConnected){
+    		GSBP_XXX::DisconnectFromDevice(ErrorCode);
+    	}
+    	if (DeviceFd < 0){
+    		*ErrorCode = GSBP_OpeningTheDeviceFailed;
+    		return false;
+    	}
+
+        memset(this->DeviceFileName, 0, sizeof(this->DeviceFileName));
+        sprintf(this->DeviceFileName,"fd:%d",DeviceFd);
+        this->ExtConfig.UseThreadToRead = UseThreadToRead;
+        this->DeviceClass = DeviceClass;
+
+        // the receiver expects a non-blocking file descriptor
+        this->fd = DeviceFd;
+        fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL) | O_NONBLOCK);
+        return GSBP_XXX::StartConnection(ErrorCode);
+    }
+
+    /*
+     * starts the receiver and checks the NodeInfo of the device opened as this->fd
+     */
+    bool GSBP_XXX::StartConnection(uint16_t* ErrorCode)
+    {
+        // file / socket is open
+        this->DeviceConnected = true;
+        this->DeviceHungUp = false;
+        // flush the serial data stream
+        if (isatty(this->fd)){
+        	tcflush(this->fd, TCIOFLUSH);
+        }
+        GSBP_XXX::ResetRxDecoder(false);
+
+        // start the log and package handler threads -> before the first package can be received
+        GSBP_XXX::StartLogThread();
+        GSBP_XXX::StartHandlerWorkers();
+
+        if (this->ExtConfig.UseThreadToRead) {
+        	// start receiving packages
+        	this->RunReceiverThread = true;
+        	this->ReceiverThreatRunning = true;
+        	this->Receiver_thread = new boost::thread(&GSBP_XXX::ReadPackages, this, false);
+        	this->ReceiverThreatRunning = true;
+        	if (GSBP_XXX::IsDebugEnabled(DebugSerialActions)){
+        		std::cout << this->ID << ": Receiver threat started" << std::endl;
         	}
+    	}
 
-            // get the NodeInfo
-            gsbp_ACK_nodeInfo_t NodeInfo = {0};
-            if (!GSBP_XXX::GetNodeInfo(&NodeInfo, false, ErrorCode)){
-            	// get NodeInfo failed
-            	GSBP_XXX::DisconnectFromDevice(ErrorCode);
-            	*ErrorCode = GSBP_NodeInfoWasNotReceived;
-            	return false;
-            } else {
-            	if (NodeInfo.deviceClass != this->DeviceClass){
-            		// get NodeInfo failed
-            		std::cout << this->ID << "\e[1m\e[91m ERROR:\e[0m The device class do not match (" << this->DeviceClass << "!=" << NodeInfo.deviceClass << ")!" << std::endl;
-            		GSBP_XXX::DoPrintNodeInfo(&NodeInfo);
-            		GSBP_XXX::DisconnectFromDevice(ErrorCode);
-            		*ErrorCode = GSBP_DeviceClassDoesNotMatch;
-            		return false;
-            	}
-            }
+        // get the NodeInfo
+        gsbp_ACK_nodeInfo_t NodeInfo = {0};
+        if (!GSBP_XXX::GetNodeInfo(&NodeInfo, false, ErrorCode)){
+        	// get NodeInfo failed
+        	GSBP_XXX::DisconnectFromDevice(ErrorCode);
+        	*ErrorCode = GSBP_NodeInfoWasNotReceived;
+        	return false;
+        } else {
+        	if (NodeInfo.deviceClass != this->DeviceClass){
+        		// get NodeInfo failed
+        		std::cout << this->ID << "\e[1m\e[91m ERROR:\e[0m The device class do not match (" << this->DeviceClass << "!=" << NodeInfo.deviceClass << ")!" << std::endl;
+        		GSBP_XXX::DoPrintNodeInfo(&NodeInfo);
+        		GSBP_XXX::DisconnectFromDevice(ErrorCode);
+        		*ErrorCode = GSBP_DeviceClassDoesNotMatch;
+        		return false;
+        	}
         }
 
         return true;
@@ -248,12 +380,15 @@ typedef union {
     	}
     	this->ExtConfig.UseThreadToRead = Config.UseThreadToRead;
     	this->ExtConfig.PackageHandler = Config.PackageHandler;
+    	GSBP_XXX::SetDefaultPackageHandler(Config.PackageHandler);
     	this->ExtConfig.GetErrorString = Config.GetErrorString;
     	this->ExtConfig.GetCmdString = Config.GetCmdString;
     	this->ExtConfig.MessageACK_ID = Config.MessageACK_ID;
     	this->ExtConfig.ApplicationDataACK_ID = Config.ApplicationDataACK_ID;
     	this->ExtConfig.DisplayWarnings = Config.DisplayWarnings;
     	this->ExtConfig.DisplayErrors = Config.DisplayErrors;
+    	this->ExtConfig.ResponseSpinTimeUs = Config.ResponseSpinTimeUs;
+    	this->ExtConfig.NumberOfHandlerThreads = Config.NumberOfHandlerThreads; // used with the next connect
     	return true;
     }
 
@@ -276,15 +411,15 @@ typedef union {
     		memcpy(NodeInfo, Ack.Data, Ack.DataSize);
     		if (NOR != 0){
     			// unexpected result received
-    			std::cout << this->ID << " Get NodeInfo: received " << NOR << " unexpected responses" << std::endl;
+    			GSBP_XXX::Log(LogSiteNodeInfo, LogWarning, "Get NodeInfo: received %u unexpected responses", NOR);
     			for (uint16_t i = 0; i<NOR; i++){
     				if (GSBP_XXX::GetResponse(RequestID, NoCmdAck_or_Invalid, &Ack, 0, &NOR, ErrorCode)){
-    					GSBP_XXX::PrintPackage(&Ack);
+    					GSBP_XXX::Log(LogSiteNodeInfo, LogWarning, "Get NodeInfo: unexpected response ID %d|0x%02X (%s), %u bytes",
+    							Ack.CommandID, (uint8_t)Ack.CommandID, GSBP_XXX::GetCmdString((uint8_t)Ack.CommandID), (uint32_t)Ack.DataSize);
     				} else {
-    					std::cout << "   -> ACK not matching the request ID" << std::endl;
+    					GSBP_XXX::Log(LogSiteNodeInfo, LogWarning, "Get NodeInfo: ACK not matching the request ID");
     				}
     			}
-    			std::cout << std::endl;
     		}
     		if (PrintNodeInfo){
     			GSBP_XXX::DoPrintNodeInfo(NodeInfo);
@@ -294,17 +429,17 @@ typedef union {
     		// did not receive the NodeInfoAck TODO: better handling of NO ACKs
     		if (NOR > 1){
     			// unexpected result received
-    			std::cout << this->ID << " GetNodeInfo: FAILED but received " << NOR << " unexpected responses" << std::endl;
+    			GSBP_XXX::Log(LogSiteNodeInfo, LogError, "GetNodeInfo: FAILED but received %u unexpected responses", NOR);
     			for (uint16_t i = 0; i< NOR; i++){
     				if (GSBP_XXX::GetResponse(RequestID, NoCmdAck_or_Invalid, &Ack, 0, &NOR, ErrorCode)){
-    					GSBP_XXX::PrintPackage(&Ack);
+    					GSBP_XXX::Log(LogSiteNodeInfo, LogError, "GetNodeInfo: unexpected response ID %d|0x%02X (%s), %u bytes",
+    							Ack.CommandID, (uint8_t)Ack.CommandID, GSBP_XXX::GetCmdString((uint8_t)Ack.CommandID), (uint32_t)Ack.DataSize);
     				} else {
-    					std::cout << "   -> ACK not matching the request ID" << std::endl;
+    					GSBP_XXX::Log(LogSiteNodeInfo, LogError, "GetNodeInfo: ACK not matching the request ID");
     				}
     			}
-    			std::cout << std::endl;
     		} else {
-    			std::cout << this->ID << " GetNodeInfo: did NOT receive a response from the device" << std::endl;
+    			GSBP_XXX::Log(LogSiteNodeInfo, LogError, "GetNodeInfo: did NOT receive a response from the device");
     		}
     		return false;
     	}
@@ -315,8 +450,67 @@ typedef union {
      */
     uint64_t GSBP_XXX::SendPackage(txPackage_t* P, uint16_t* ErrorCode)
     {
+    	return GSBP_XXX::DoSendPackage(P, NULL, 0, ErrorCode);
+    }
+
+    /*
+     * sends a package without waiting for the response
+     * -> the callback is called by the receiver thread with the matching response (AckId; 0 = any response), a received error message or after the timeout
+     * -> if the package can't be send, the callback is called immediately; returns the global request ID or 0
+     */
+    uint64_t GSBP_XXX::SendPackageAsync(txPackage_t* P, uint16_t AckId, int MilliSecondsToWait, std::function<void(asyncResponse_t*)> Callback)
+    {
+    	uint64_t RequestID = 0;
+    	uint16_t ErrorCode = NoError;
+    	if (!this->ReceiverThreatRunning){
+    		// only the receiver thread completes asynchronous requests
+    		ErrorCode = GSBP_ReceiverThreadNotRunning;
+    	} else {
+    		if (MilliSecondsToWait <= 0){
+    			MilliSecondsToWait = gsbp_DefaultGetResponceTimeout;
+    		}
+    		if (GSBP_XXX::IsDebugEnabled(DebugMcuAndIncreaseTimeouts)){
+    			MilliSecondsToWait += gsbp_AdditionalTimeOutForMcuDebuging;
+    		}
+    		asyncRequest_t Async;
+    		Async.AckId = AckId;
+    		Async.Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(MilliSecondsToWait);
+    		Async.Callback = Callback;
+    		RequestID = GSBP_XXX::DoSendPackage(P, &Async, 0, &ErrorCode);
+    	}
+
+    	if (RequestID == 0){
+    		// the package was not send
+    		asyncResponse_t Result = asyncResponse_t();
+    		Result.ErrorCode = ErrorCode;
+    		Callback(&Result);
+    	}
+    	return RequestID;
+    }
+
+    /*
+     * sends a package without waiting for the response -> the future gets the result (see above)
+     */
+    std::future<GSBP_XXX::asyncResponse_t> GSBP_XXX::SendPackageAsync(txPackage_t* P, uint16_t AckId, int MilliSecondsToWait)
+    {
+    	std::shared_ptr< std::promise<asyncResponse_t> > Promise = std::make_shared< std::promise<asyncResponse_t> >();
+    	std::future<asyncResponse_t> Future = Promise->get_future();
+    	GSBP_XXX::SendPackageAsync(P, AckId, MilliSecondsToWait, [Promise](asyncResponse_t* Result){
+    		Promise->set_value(*Result);
+    	});
+    	return Future;
+    }
+
+    /*
+     * sends a package; with Async != NULL the response is handed to Async->Callback by the receiver thread
+     * -> with OldestRequestId != 0 the package is only send, if its request ID does not reuse the local request ID of
+     *    OldestRequestId (or of a later request); otherwise 0 is returned with ErrorCode = NoError
+     */
+    uint64_t GSBP_XXX::DoSendPackage(txPackage_t* P, asyncRequest_t* Async, uint64_t OldestRequestId, uint16_t* ErrorCode)
+    {
+    	*ErrorCode = NoError;
     	// check if connected to a device
-    	if (!this->DeviceConnected){
+    	if (!this->DeviceConnected || this->DeviceHungUp){
     		*ErrorCode = GSBP_NotConnectedToDevice;
     		return 0;
     	}
@@ -325,99 +519,77 @@ typedef union {
     		*ErrorCode = GSBP_InvalidCMD;
     		return 0;
     	}
-    	RequestResponse_t R;
-    	R.Cmd = *P;
-    	R.RequestIdLocal = GetNextRequestIdLocal();
-    	R.RequestIdLocal_Debug = GetCurrentRequestIdLocal();
-    	R.RequestIdGlobal = GetCurrentRequestIdGlobal();
-    	R.RequestIdGlobal_Debug = GetCurrentRequestIdGlobal();
+    	RequestResponse_t R = RequestResponse_t();
+    	if (OldestRequestId == 0){
+    		R.RequestIdGlobal = GSBP_XXX::GetNextRequestIdGlobal();
+    	} else {
+    		// check the window and take the request ID in one step -> other threads can send at the same time
+    		uint64_t Current = this->TxRequestIdGlobal.load();
+    		do {
+    			if (Current +1 - OldestRequestId >= gsbp_MaxRequestIdLocal){
+    				return 0;
+    			}
+    		} while (!this->TxRequestIdGlobal.compare_exchange_weak(Current, Current +1));
+    		R.RequestIdGlobal = Current +1;
+    	}
+    	R.RequestIdLocal = GSBP_XXX::GetRequestIdLocal(R.RequestIdGlobal);
+    	GSBP_XXX::Trace(TraceSendPackage, 'B', R.RequestIdGlobal, P->CommandID);
+    	R.RequestIdLocal_Debug = R.RequestIdLocal;
+    	R.RequestIdGlobal_Debug = R.RequestIdGlobal;
     	R.IsDummyCopy = false;
     	R.ResponseReceived = false;
     	R.WaitForResponce = false;
     	R.WaitTimedOut = false;
     	R.Error = false;
     	R.ErrorCode = NoError;
+    	R.Cmd.CommandID = P->CommandID;
+    	R.Cmd.State = PackageIsOk;
+    	R.Cmd.RequestID = R.RequestIdLocal;
+    	R.Cmd.DataSize = P->DataSize;
 
         // TODO check package
         //GSBP_XXX::CheckPackage(pakage_t* Package)
 
-        // ### build TxBuffer ###
-        memset(this->TxBuffer, 0, sizeof(this->TxBuffer));
-        TxBufferSize = 0;
-        // SET HEADER
-        TxBuffer[TxBufferSize++] = GSBP__UART_START_BYTE;
-        #if GSBP__ACTIVATE_DESTINATION_FEATURE
-        TxBuffer[TxBufferSize++] = __MakeUChar(Command->Destination);
-        #endif
-        #if GSBP__ACTIVATE_SOURCE_FEATURE
-        TxBuffer[TxBufferSize++] = __MakeUChar(Command->Source);
-        #endif
-        #if GSBP__ACTIVATE_SOURCE_DESTINATION_FEATURE
-        TxBuffer[TxBufferSize++] = //TODO
-        #endif
-        #if GSBP__ACTIVATE_16BIT_CMD_FEATURE
-        TxBuffer[TxBufferSize++] = __MakeUChar((Command->CommandID >> 8));
-        #endif
-        TxBuffer[TxBufferSize++] = __MakeUChar(P->CommandID);
-        #if GSBP__ACTIVATE_CONTROL_FEATURE
-        TxBuffer[TxBufferSize++] = __MakeUChar(Command->Control);
-        #endif
-        TxBuffer[TxBufferSize++] = __MakeUChar(R.RequestIdLocal);
-        #if GSBP__ACTIVATE_16BIT_PACKAGE_LENGHT_FEATURE
-        TxBuffer[TxBufferSize++] = __MakeUChar(P->DataSize);
-        #endif
-        TxBuffer[TxBufferSize++] = __MakeUChar((P->DataSize >>8));
-
-#if GSBP__USE_CHECKSUMS
-        // header checksum
-        uint8_t	ChecksumHeaderTemp;
-        ChecksumHeaderTemp = GSBP__UART_HEADER_CHECKSUM_START;
-        for(uint32_t i=1; i<TxBufferSize; i++){
-            ChecksumHeaderTemp ^= TxBuffer[i];
-            //TODO Checksumme ist nicht gut -> lieber one's sum ....
-            //http://betterembsw.blogspot.de/2010/05/which-error-detection-code-should-you.html
-        }
-        TxBuffer[TxBufferSize++] = ChecksumHeaderTemp;
-        Command->ChecksumHeader = ChecksumHeaderTemp;
-#endif
-        if (P->DataSize > 0){
-            // SET DATA
-            memcpy( &TxBuffer[TxBufferSize], P->Data, P->DataSize);
-            TxBufferSize += P->DataSize;
-
-#if GSBP__USE_CHECKSUMS
-            // SET Checksum Data
-            TxBuffer[TxBufferSize++] = 0x00;      // TODO Checksum
-            TxBuffer[TxBufferSize++] = 0x00;      // TODO Checksum
-            TxBuffer[TxBufferSize++] = 0x00;      // TODO Checksum
-            TxBuffer[TxBufferSize++] = 0x00;      // TODO Checksum
-#endif
- //           Command->ChecksumData = 0x00;
-        }
-        // SET TAIL
-        TxBuffer[TxBufferSize++] = GSBP__UART_END_BYTE;
+        // ### build the package ###
+        txFrame_t Frame;
+        Frame.Size = GSBP_XXX::EncodePackage(P, R.RequestIdLocal, Frame.Buffer);
 
+        // add the request to the buffer -> before sending, so the response can't arrive before the request
+        R.SendTimeNs = GSBP_XXX::GetMonotonicTimeNs();
+        GSBP_XXX::AddRequest(&R, P, Async);
+        GSBP_XXX::Trace(TraceRequest, 'b', R.RequestIdGlobal, P->CommandID);
 
         // ### send command ###
-        if (write(this->fd, TxBuffer, TxBufferSize) != (int)TxBufferSize){
-            printf("\e[1m\e[91m%s ERROR:\e[0m Can't write to %s: %s (%d)\n", this->ID, this->DeviceFileName, strerror(errno), errno);
-            return false;
+        if (!GSBP_XXX::TransmitFrame(&Frame)){
+        	// the request was never send -> remove it
+        	measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
+        	if (this->RequestTable[R.RequestIdLocal].RequestIdGlobal == R.RequestIdGlobal){
+        		GSBP_XXX::ClaimRequest(&this->RequestTable[R.RequestIdLocal]);
+        	}
+        	if (Async != NULL && this->AsyncRequests[R.RequestIdLocal].RequestIdGlobal == R.RequestIdGlobal){
+        		// the caller reports the error to the callback
+        		this->AsyncRequests[R.RequestIdLocal].RequestIdGlobal = 0;
+        		this->AsyncRequests[R.RequestIdLocal].Callback = NULL;
+        		this->NumberOfAsyncRequests--;
+        	}
+        	*ErrorCode = GSBP_WritingToDeviceFailed;
+        	GSBP_XXX::Trace(TraceRequest, 'e', R.RequestIdGlobal, 0);
+        	GSBP_XXX::Trace(TraceSendPackage, 'E', R.RequestIdGlobal, P->CommandID);
+            return 0;
         }
 
-        // add the request to the buffer
-        GSBP_XXX::AddRequest(R);
-
         //Debug
-        #if GSBP__DEBUG_SENDING_COMMANDS
-        GSBP_XXX::PrintPackage(P);
-        printf("\033[2A   Send: ");
-        for(uint32_t i=0; i<TxBufferSize; i++){
-            printf("0x%02X ", (uint8_t)TxBuffer[i]);
+        if (GSBP_XXX::IsDebugEnabled(DebugSendingCommands)){
+        	GSBP_XXX::PrintPackage(P);
+        	printf("\033[2A   Send: ");
+        	for(uint32_t i=0; i<Frame.Size; i++){
+        		printf("0x%02X ", (uint8_t)Frame.Buffer[i]);
+        	}
+        	printf("\n\n\n");
+        	fflush(stdout);
         }
-        printf("\n\n\n");
-        fflush(stdout);
-        #endif
 
+        GSBP_XXX::Trace(TraceSendPackage, 'E', R.RequestIdGlobal, P->CommandID);
         return R.RequestIdGlobal;
     }
 
@@ -425,12 +597,13 @@ typedef union {
 	bool GSBP_XXX::GetResponse(uint64_t RequestId, uint16_t AckId, rxPackage_t* ACK, int MilliSecondsToWait, uint32_t* NumberOfOpenRequests, uint16_t* ErrorCode)
 	{
 		// check if connected to a device
-    	if (!this->DeviceConnected){
+    	if (!this->DeviceConnected || this->DeviceHungUp){
     		*NumberOfOpenRequests = 0;
     		*ErrorCode = GSBP_NotConnectedToDevice;
     		return false;
     	}
 
+        GSBP_XXX::Trace(TraceGetResponse, 'B', RequestId, AckId);
         // get the packages if the receiver threat is not running
         if (!this->ReceiverThreatRunning){
             GSBP_XXX::ReadPackages(true);
@@ -445,7 +618,7 @@ typedef union {
 		*ErrorCode = NoError;
 
 		// lock the queue
-		boost::mutex::scoped_lock lock(this->RequestResponseLock_mutex);
+		measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
 
 		// wait for the expected response to arrive?
 		bool WaitForResponce = false;
@@ -453,81 +626,293 @@ typedef union {
 			MilliSecondsToWait = 0;
 		} else {
 			WaitForResponce = true;
-			MilliSecondsToWait++; // add one millisecond because of the loop...
-#if GSBP__DEBUG_MCU_AND_INCREASE_TIMEOUTS
-			MilliSecondsToWait += gsbp_AdditionalTimeOutForMcuDebuging;
-#endif
+			if (GSBP_XXX::IsDebugEnabled(DebugMcuAndIncreaseTimeouts)){
+				MilliSecondsToWait += gsbp_AdditionalTimeOutForMcuDebuging;
+			}
 		}
 
 		// wait for the response ...
-		// get the request(s)
-		boost::circular_buffer<RequestResponse_t>::iterator Item = this->RequestResponseBuffer.begin();
-		bool ResponceFound = false;
-		do {
-			// check the request and response buffer
-			*NumberOfOpenRequests = 0;
-			for (Item = this->RequestResponseBuffer.begin();
-					Item != this->RequestResponseBuffer.end(); Item++){
-				// is the local request ID identical?
-				if (Item->RequestIdGlobal == RequestId){
-					// this is the request
-					(*NumberOfOpenRequests)++;
-					Item->WaitForResponce = WaitForResponce;
-					if (Item->ResponseReceived){
-						// is the response valid?
-						if (AckId == 0 || Item->Ack.CommandID == AckId){
-							// yes -> return this ACK
-							*ACK = Item->Ack;
-							Item->RequestIdLocal = 0;
-							Item->RequestIdGlobal = 0;
-							ResponceFound = true;
-						}
-					}
-				}
-			}
-			if (ResponceFound){
-				this->UnclaimedRequestResponces--;
+		// get the request(s) -> the local request ID addresses the request directly
+		uint8_t RequestIdLocal = GSBP_XXX::GetRequestIdLocal(RequestId);
+		RequestResponse_t* Response = NULL;
+		// -> monotonic deadlines; the spinning phase is only useful if a receiver thread delivers the responses
+		std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point Deadline = Now + std::chrono::milliseconds(MilliSecondsToWait);
+		std::chrono::steady_clock::time_point SpinDeadline = Now + std::chrono::microseconds(this->ExtConfig.ResponseSpinTimeUs);
+		while (true) {
+			// check the request and its dummy copies
+			Response = GSBP_XXX::FindResponse(RequestId, AckId, WaitForResponce, NumberOfOpenRequests);
+			if (Response != NULL){
+				// yes -> return this ACK
+				GSBP_XXX::CopyResponse(Response, ACK);
+				GSBP_XXX::ClaimRequest(Response);
 				--(*NumberOfOpenRequests);
+				GSBP_XXX::Trace(TraceGetResponse, 'E', RequestId, ACK->CommandID);
 				return true;
 			}
 
 			// wait
-			if (MilliSecondsToWait > 0){
+			if (!WaitForResponce){
+				break;
+			}
+			Now = std::chrono::steady_clock::now();
+			if (Now >= Deadline || this->DeviceHungUp){
+				// timeout or the device closed the connection -> no response will arrive
+				break;
+			}
+			if (!this->ReceiverThreatRunning){
+				// no receiver thread -> read the packages within this thread
+				lock.unlock();
+				GSBP_XXX::ReadPackages(true);
+				lock.lock();
+			} else if (Now < SpinDeadline){
+				// spin without the lock until a response for this local request ID arrives or the spinning time is over
+				uint32_t Counter = this->ResponseCounter[RequestIdLocal].load(std::memory_order_acquire);
 				lock.unlock();
-				boost::this_thread::sleep(boost::posix_time::milliseconds(1));
-				MilliSecondsToWait --;
-				if (!this->ReceiverThreatRunning){
-					GSBP_XXX::ReadPackages(true);
+				while (this->ResponseCounter[RequestIdLocal].load(std::memory_order_acquire) == Counter &&
+						std::chrono::steady_clock::now() < SpinDeadline && !this->DeviceHungUp){
+					// busy wait
 				}
+				GSBP_XXX::Trace(TraceGetResponseWakeup, 'i', RequestId, 0);
 				lock.lock();
+			} else {
+				// block until AddResponse signals a response for this local request ID or the timeout is reached
+				lock.TimedWait(this->ResponseCondition[RequestIdLocal], boost::posix_time::microseconds(
+						std::chrono::duration_cast<std::chrono::microseconds>(Deadline - Now).count() +1));
+				GSBP_XXX::Trace(TraceGetResponseWakeup, 'i', RequestId, 0);
 			}
-		} while (MilliSecondsToWait >0);
+		}
 
 		if (WaitForResponce){
 			// check the request and response buffer again and mark the timeout,
 			// because everything, that is there now was received after the timeout
 			*ErrorCode = GSBP_GetResponseTimeout;
-			*NumberOfOpenRequests = 0;
-			for (Item = this->RequestResponseBuffer.begin();
-					Item != this->RequestResponseBuffer.end(); Item++){
-				// is the local request ID identical?
-				if (Item->RequestIdGlobal == RequestId){
-					// this is the request
-					Item->WaitForResponce = true;
-					Item->WaitTimedOut = true;
-					(*NumberOfOpenRequests)++;
-				}
+			*NumberOfOpenRequests = GSBP_XXX::MarkResponseTimeout(RequestId);
+			if (GSBP_XXX::IsDebugEnabled(DebugReceivingCommands) && this->RequestDebugTimes[RequestIdLocal].RequestIdGlobal == RequestId){
+				this->RequestDebugTimes[RequestIdLocal].AckWaitTimeout = MilliSecondsToWait;
 			}
-			this->StatsGSBP.NumberOfRxPackages_Missing++;
-
 			if (*NumberOfOpenRequests == 0){
 				*ErrorCode = GSBP_NoRequestFound;
 			}
+			if (this->DeviceHungUp){
+				*ErrorCode = GSBP_NotConnectedToDevice;
+			}
 		}
 
+		GSBP_XXX::Trace(TraceGetResponse, 'E', RequestId, 0);
 		return false;
 	}
 
+	/*
+	 * sends independent packages and keeps up to WindowSize requests in flight
+	 * -> the responses are collected in any order and every request gets its own result
+	 * -> MilliSecondsToWait is the timeout of each request, starting when it is send
+	 * -> returns true if every request got a valid response
+	 */
+	bool GSBP_XXX::SendPackagesPipelined(pipelineRequest_t* Requests, uint32_t NumberOfRequests, uint32_t WindowSize, int MilliSecondsToWait, uint32_t* NumberOfFailedRequests)
+	{
+		*NumberOfFailedRequests = 0;
+		for (uint32_t i=0; i<NumberOfRequests; i++){
+			Requests[i].RequestID = 0;
+			Requests[i].ResponseReceived = false;
+			Requests[i].ErrorCode = NoError;
+		}
+		// the local request IDs of the requests in flight must be unique
+		if (WindowSize == 0){
+			WindowSize = 1;
+		} else if (WindowSize > gsbp_MaxRequestIdLocal){
+			WindowSize = gsbp_MaxRequestIdLocal;
+		}
+		if (MilliSecondsToWait < 0){
+			MilliSecondsToWait = 0;
+		}
+		if (GSBP_XXX::IsDebugEnabled(DebugMcuAndIncreaseTimeouts)){
+			MilliSecondsToWait += gsbp_AdditionalTimeOutForMcuDebuging;
+		}
+
+		// requests in flight -> in the order they were send
+		struct inFlight_t {
+			uint32_t Index;
+			std::chrono::steady_clock::time_point Deadline;
+		};
+		std::vector<inFlight_t> InFlight;
+		InFlight.reserve(WindowSize);
+
+		uint32_t NextRequest = 0;
+		uint32_t RequestsDone = 0;
+		measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats, boost::defer_lock);
+		while (RequestsDone < NumberOfRequests){
+			// fill the window -> the next request must not get the local request ID of the oldest request in flight
+			// (other threads sending packages meanwhile use local request IDs too)
+			while (NextRequest < NumberOfRequests && InFlight.size() < WindowSize){
+				pipelineRequest_t* R = &Requests[NextRequest];
+				uint64_t OldestRequestId = InFlight.empty() ? 0 : Requests[InFlight.front().Index].RequestID;
+				R->RequestID = GSBP_XXX::DoSendPackage(R->Cmd, NULL, OldestRequestId, &R->ErrorCode);
+				if (R->RequestID == 0 && R->ErrorCode == NoError){
+					// the local request IDs up to the oldest request in flight are used -> wait for its response first
+					break;
+				}
+				if (R->RequestID == 0){
+					(*NumberOfFailedRequests)++;
+					RequestsDone++;
+				} else {
+					inFlight_t Item = {NextRequest, std::chrono::steady_clock::now() + std::chrono::milliseconds(MilliSecondsToWait)};
+					InFlight.push_back(Item);
+				}
+				NextRequest++;
+			}
+			if (InFlight.empty()){
+				continue;
+			}
+
+			// get the packages if the receiver threat is not running
+			if (!this->ReceiverThreatRunning){
+				GSBP_XXX::ReadPackages(true);
+			}
+
+			// collect the responses
+			lock.lock();
+			bool RequestCompleted = false;
+			std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+			for (auto Item = InFlight.begin(); Item != InFlight.end(); ){
+				pipelineRequest_t* R = &Requests[Item->Index];
+				uint32_t NumberOfOpenRequests = 0;
+				RequestResponse_t* Response = GSBP_XXX::FindResponse(R->RequestID, R->AckId, true, &NumberOfOpenRequests);
+				if (Response != NULL){
+					if (R->Ack != NULL){
+						GSBP_XXX::CopyResponse(Response, R->Ack);
+					}
+					R->ResponseReceived = true;
+					if (Response->Error){
+						R->ErrorCode = Response->ErrorCode;
+						(*NumberOfFailedRequests)++;
+					}
+					GSBP_XXX::ClaimRequest(Response);
+				} else if (Now >= Item->Deadline || this->DeviceHungUp){
+					R->ErrorCode = (GSBP_XXX::MarkResponseTimeout(R->RequestID) > 0) ? GSBP_GetResponseTimeout : GSBP_NoRequestFound;
+					if (this->DeviceHungUp){
+						R->ErrorCode = GSBP_NotConnectedToDevice;
+					}
+					(*NumberOfFailedRequests)++;
+				} else {
+					++Item;
+					continue;
+				}
+				Item = InFlight.erase(Item);
+				RequestsDone++;
+				RequestCompleted = true;
+			}
+
+			// nothing can be send before a request is completed
+			// -> wait for the next response or the next timeout; the oldest request times out first
+			if (!RequestCompleted && !InFlight.empty() && this->ReceiverThreatRunning){
+				this->AnyResponseWaiters++;
+				lock.TimedWait(this->AnyResponseCondition, boost::posix_time::microseconds(
+						std::chrono::duration_cast<std::chrono::microseconds>(InFlight.front().Deadline - Now).count() +1));
+				this->AnyResponseWaiters--;
+			}
+			lock.unlock();
+		}
+
+		return (*NumberOfFailedRequests == 0);
+	}
+
+	/*
+	 * routes all received packages with this CMD/ACK ID and local request ID directly from the decoder to Sink
+	 * -> SubscribeToAnyID matches every ID, but not for both; e.g. (ApplicationDataACK_ID, MeasurementDataRequestID)
+	 * -> these packages never reach the request/response buffer or the package handler
+	 * -> Sink is called by the receiver thread; returns the subscription ID or 0
+	 */
+	uint32_t GSBP_XXX::Subscribe(uint16_t CommandID, uint8_t RequestID, std::function<void(rxPackage_t*)> Sink, uint16_t* ErrorCode)
+	{
+		*ErrorCode = NoError;
+		if ((CommandID == SubscribeToAnyID && RequestID == SubscribeToAnyID) || Sink == NULL){
+			*ErrorCode = GSBP_InvalidSubscription;
+			return 0;
+		}
+		boost::mutex::scoped_lock lock(this->Subscription_mutex);
+		std::shared_ptr< std::vector<subscription_t> > NewSubscriptions = std::make_shared< std::vector<subscription_t> >();
+		std::shared_ptr< const std::vector<subscription_t> > OldSubscriptions = std::atomic_load(&this->Subscriptions);
+		if (OldSubscriptions){
+			*NewSubscriptions = *OldSubscriptions;
+		}
+		subscription_t Subscription;
+		Subscription.SubscriptionID = ++this->LastSubscriptionID;
+		Subscription.CommandID = CommandID;
+		Subscription.RequestID = RequestID;
+		Subscription.Sink = Sink;
+		NewSubscriptions->push_back(Subscription);
+		std::atomic_store(&this->Subscriptions, std::shared_ptr< const std::vector<subscription_t> >(NewSubscriptions));
+		this->SubscriptionsActive = true;
+		return Subscription.SubscriptionID;
+	}
+
+	/*
+	 * removes a subscription -> a Sink call, which already started, may still be running
+	 */
+	bool GSBP_XXX::Unsubscribe(uint32_t SubscriptionID, uint16_t* ErrorCode)
+	{
+		*ErrorCode = GSBP_InvalidSubscription;
+		boost::mutex::scoped_lock lock(this->Subscription_mutex);
+		std::shared_ptr< const std::vector<subscription_t> > OldSubscriptions = std::atomic_load(&this->Subscriptions);
+		if (!OldSubscriptions){
+			return false;
+		}
+		std::shared_ptr< std::vector<subscription_t> > NewSubscriptions = std::make_shared< std::vector<subscription_t> >();
+		for (auto Item = OldSubscriptions->begin(); Item != OldSubscriptions->end(); ++Item){
+			if (Item->SubscriptionID == SubscriptionID){
+				*ErrorCode = NoError;
+			} else {
+				NewSubscriptions->push_back(*Item);
+			}
+		}
+		if (*ErrorCode != NoError){
+			return false;
+		}
+		this->SubscriptionsActive = !NewSubscriptions->empty();
+		std::atomic_store(&this->Subscriptions, std::shared_ptr< const std::vector<subscription_t> >(NewSubscriptions));
+		return true;
+	}
+
+	/*
+	 * sets the package handler of a CMD/ACK ID; NULL removes it -> see SetPackageHandlers()
+	 */
+	bool GSBP_XXX::SetPackageHandler(uint16_t CommandID, packageHandler_t Handler, uint16_t* ErrorCode)
+	{
+		std::vector< std::pair<uint16_t, packageHandler_t> > Handlers(1, std::make_pair(CommandID, Handler));
+		return GSBP_XXX::SetPackageHandlers(Handlers, false, ErrorCode);
+	}
+
+	/*
+	 * sets a set of package handlers at once; RemoveOtherHandlers removes all handlers, which are not part of the set
+	 * -> a package with a handler is handed directly to it instead of gsbpConfiguration_t::PackageHandler
+	 * -> the handlers can be changed while packages are received; a handler call, which already started, may still use the old handler
+	 */
+	bool GSBP_XXX::SetPackageHandlers(std::vector< std::pair<uint16_t, packageHandler_t> > Handlers, bool RemoveOtherHandlers, uint16_t* ErrorCode)
+	{
+		*ErrorCode = NoError;
+		for (auto Item = Handlers.begin(); Item != Handlers.end(); ++Item){
+			if (Item->first == 0 || Item->first >= gsbp_CommandIdTableSize){
+				*ErrorCode = GSBP_InvalidCMD;
+				return false;
+			}
+		}
+		// read-copy-update
+		boost::mutex::scoped_lock lock(this->HandlerTable_mutex);
+		std::shared_ptr<handlerTable_t> NewTable = std::make_shared<handlerTable_t>();
+		std::shared_ptr<const handlerTable_t> OldTable = std::atomic_load(&this->HandlerTable);
+		if (RemoveOtherHandlers){
+			NewTable->DefaultHandler = OldTable->DefaultHandler;
+		} else {
+			*NewTable = *OldTable;
+		}
+		for (auto Item = Handlers.begin(); Item != Handlers.end(); ++Item){
+			NewTable->Handler[Item->first] = Item->second;
+		}
+		std::atomic_store(&this->HandlerTable, std::shared_ptr<const handlerTable_t>(NewTable));
+		return true;
+	}
+
 	bool GSBP_XXX::DisconnectFromDevice(uint16_t* ErrorCode)
 	{
 		*ErrorCode = NoError;
@@ -540,14 +925,21 @@ typedef union {
                 this->Receiver_thread->join(); // TODO: use signals to stop the thread
                 this->ReceiverThreatRunning = false;
             }
+            GSBP_XXX::StopHandlerWorkers();
+            // nobody can answer the open asynchronous requests any more
+            GSBP_XXX::CompleteAsyncRequests(false, GSBP_NotConnectedToDevice);
+            // write the remaining log messages
+            GSBP_XXX::StopLogThread();
 
             // flush the serial data stream
             int retval;
-            tcflush(this->fd, TCIOFLUSH);
+            if (isatty(this->fd)){
+            	tcflush(this->fd, TCIOFLUSH);
+            }
             while (retval = close(this->fd), retval == -1 && errno == EINTR) ;
-#if GSBP__DEBUG_SERIAL_ACTIONS
-            std::cout << this->ID << ": Device " << this->DeviceFileName << " closed" << std::endl;
-#endif
+            if (GSBP_XXX::IsDebugEnabled(DebugSerialActions)){
+            	std::cout << this->ID << ": Device " << this->DeviceFileName << " closed" << std::endl;
+            }
             this->DeviceConnected = false;
         }
         return true;
@@ -558,11 +950,25 @@ typedef union {
     	if (ErrorCode < gsbp_MaxErrorCodeNumber){
             switch ( (error_t)ErrorCode ) { // TODO update
                 case NoError:      			  		return "NoError";
+                case GSBP_NotConnectedToDevice:		return "NotConnectedToDevice";
+                case GSBP_InvalidCMD:				return "InvalidCMD";
+                case GSBP_NoRequestFound:			return "NoRequestFound";
+                case GSBP_GetResponseTimeout:		return "GetResponseTimeout";
+                case GSBP_OpeningTheDeviceFailed:	return "OpeningTheDeviceFailed";
+                case GSBP_NodeInfoWasNotReceived:	return "NodeInfoWasNotReceived";
+                case GSBP_DeviceClassDoesNotMatch:	return "DeviceClassDoesNotMatch";
+                case GSBP_WritingToDeviceFailed:	return "WritingToDeviceFailed";
+                case GSBP_ReceiverThreadNotRunning:	return "ReceiverThreadNotRunning";
+                case GSBP_InvalidSubscription:		return "InvalidSubscription";
 
                 case UnknownCMDError:         		return "UnknownCMDError";
                 case ChecksumMissmatchError:  		return "ChecksumMissmatchError";
                 case EndByteMissmatchError:   		return "EndByteMissmatchError";
                 case UARTSizeMissmatchError:  		return "UARTSizeMissmatchError";
+                case GSBP_CaptureFailed:			return "CaptureFailed";
+                case GSBP_ReplayFailed:				return "ReplayFailed";
+                case GSBP_MetricsFailed:			return "MetricsFailed";
+                case GSBP_TraceFailed:				return "TraceFailed";
 
                 case GSBP_Error__CMD_NotValidNow: 	return "CMD_NotValidNow";
 
@@ -595,15 +1001,15 @@ typedef union {
     	std::cout << std::endl << this->ID << " Request/Response:" << std::endl;
 
     	// lock the queue
-        boost::mutex::scoped_lock lock(this->RequestResponseLock_mutex);
-    	for (auto Request = this->RequestResponseBuffer.rbegin();
-    			Request != this->RequestResponseBuffer.rend(); ++Request){
-    		if (Request->RequestIdGlobal_Debug == RequestId){
-    			if (!Request->IsDummyCopy){
-    				GSBP_XXX::DoPrintRequestResponse(&(*Request), false, PrintPackageContent);
-    			} else {
-    				GSBP_XXX::DoPrintRequestResponse(&(*Request), true, PrintPackageContent);
-    			}
+        measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
+        RequestResponse_t* Request = &this->RequestTable[GSBP_XXX::GetRequestIdLocal(RequestId)];
+        if (Request->RequestIdGlobal_Debug == RequestId){
+        	GSBP_XXX::DoPrintRequestResponse(Request, false, PrintPackageContent);
+        }
+    	for (auto Item = this->DuplicateResponseBuffer.rbegin();
+    			Item != this->DuplicateResponseBuffer.rend(); ++Item){
+    		if (Item->RequestIdGlobal_Debug == RequestId){
+    			GSBP_XXX::DoPrintRequestResponse(&(*Item), true, PrintPackageContent);
     		}
     	}
     	lock.unlock();
@@ -612,19 +1018,32 @@ typedef union {
 
     void GSBP_XXX::PrintRequestResponseBuffer(bool ShowAllEntries)
     {
-    	std::cout << std::endl << this->ID << " Request/Response Buffer Debugging: Size=" << this->RequestResponseBuffer.size();
+    	// lock the queue
+        measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
+
+        // the oldest request follows the current local request ID
+        uint32_t NumberOfEntries = 0;
+        uint8_t  RequestIdLocal = GSBP_XXX::GetCurrentRequestIdLocal();
+        for (uint32_t i=0; i<gsbp_MaxRequestIdLocal; i++){
+        	RequestIdLocal = (RequestIdLocal % gsbp_MaxRequestIdLocal) +1;
+        	if (this->RequestTable[RequestIdLocal].RequestIdGlobal_Debug != 0){
+        		NumberOfEntries++;
+        	}
+        }
+    	std::cout << std::endl << this->ID << " Request/Response Buffer Debugging: Size=" << NumberOfEntries + this->DuplicateResponseBuffer.size();
     	std::cout << " with " << this->UnclaimedRequestResponces << " unclaimed requests" << std::endl;
 
-    	// lock the queue
-        boost::mutex::scoped_lock lock(this->RequestResponseLock_mutex);
-    	for (auto Request = this->RequestResponseBuffer.rbegin();
-    			Request != this->RequestResponseBuffer.rend(); ++Request){
-    		if (ShowAllEntries || Request->RequestIdLocal != 0){
-    			if (!Request->IsDummyCopy){
-    				GSBP_XXX::DoPrintRequestResponse(&(*Request), false, GSBP__DEBUG_REQUEST_AND_RESPONSE_BUFFER_PACKAGES);
-    			} else {
-    				GSBP_XXX::DoPrintRequestResponse(&(*Request), true, GSBP__DEBUG_REQUEST_AND_RESPONSE_BUFFER_PACKAGES);
-    			}
+        for (uint32_t i=0; i<gsbp_MaxRequestIdLocal; i++){
+        	RequestIdLocal = (RequestIdLocal % gsbp_MaxRequestIdLocal) +1;
+        	RequestResponse_t* Request = &this->RequestTable[RequestIdLocal];
+        	if (Request->RequestIdGlobal_Debug != 0 && (ShowAllEntries || Request->RequestIdLocal != 0)){
+        		GSBP_XXX::DoPrintRequestResponse(Request, false, GSBP_XXX::IsDebugEnabled(DebugRequestResponseBufferPackages));
+        	}
+        }
+    	for (auto Item = this->DuplicateResponseBuffer.rbegin();
+    			Item != this->DuplicateResponseBuffer.rend(); ++Item){
+    		if (ShowAllEntries || Item->RequestIdLocal != 0){
+    			GSBP_XXX::DoPrintRequestResponse(&(*Item), true, GSBP_XXX::IsDebugEnabled(DebugRequestResponseBufferPackages));
     		}
     	}
     	lock.unlock();
@@ -634,10 +1053,20 @@ typedef union {
     void GSBP_XXX::PrintStatsGSBP()
     {
         // print statistics
+        metrics_t M;
+        GSBP_XXX::GetMetrics(&M);
         printf("\n%s GSBP Statistics:\n   Packages received = %lu (missing: %lu | broken checksum: %lu | broken structure: %lu | bytes discarded: %lu)\n   Packages send = %lu\n\n",
-               this->ID, this->StatsGSBP.NumberOfRxPackages, this->StatsGSBP.NumberOfRxPackages_Missing, (long unsigned int)this->StatsGSBP.NumberOfRxPackages_BrokenChecksum, this->StatsGSBP.NumberOfRxPackages_BrokenStructur, this->StatsGSBP.BytesDiscarded,
-               this->StatsGSBP.GlobalTxRequestID
+               this->ID, (long unsigned int)M.RxPackages, (long unsigned int)M.RxPackagesMissing, (long unsigned int)M.RxPackagesBrokenChecksum, (long unsigned int)M.RxPackagesBrokenStructure, (long unsigned int)M.RxBytesDiscarded,
+               GSBP_XXX::GetCurrentRequestIdGlobal()
         );
+        std::vector<latencySnapshot_t> Latencies = GSBP_XXX::GetLatencySnapshots();
+        for (auto L = Latencies.begin(); L != Latencies.end(); ++L){
+        	printf("   Round trip ID %3d: %lu responses, p50 %.1f us | p99 %.1f us | p99.9 %.1f us | max %.1f us\n",
+        			L->CommandID, (long unsigned int)L->Count, L->P50Ns /1000.0, L->P99Ns /1000.0, L->P999Ns /1000.0, L->MaxNs /1000.0);
+        }
+        if (!Latencies.empty()){
+        	printf("\n");
+        }
         fflush(stdout);
     }
 
@@ -656,15 +1085,105 @@ typedef union {
         this->fd = 0;
         // bool's
         this->DeviceConnected = false;
+        this->DeviceHungUp = false;
         this->RunReceiverThread= false;
         this->ReceiverThreatRunning = false;
+        // wire capture
+        for (uint32_t i=0; i<2; i++){
+        	this->CaptureRing[i].Buffer = NULL;
+        	this->CaptureRing[i].Head = 0;
+        	this->CaptureRing[i].Tail = 0;
+        	this->CaptureRing[i].ChunksCaptured = 0;
+        	this->CaptureRing[i].BytesCaptured = 0;
+        	this->CaptureRing[i].ChunksDropped = 0;
+        }
+        this->CaptureActive = false;
+        this->CaptureUsers = 0;
+        this->RunCaptureThread = false;
+        this->Capture_thread = NULL;
+        this->fdCapture = -1;
+        this->CaptureClockOffsetNs = 0;
         // StatsGSBP
-        memset(&(this->StatsGSBP), 0, sizeof(this->StatsGSBP));
+        this->StatsGSBP.NumberOfRxPackages = 0;
+        this->StatsGSBP.NumberOfRxPackages_Missing = 0;
+        this->StatsGSBP.NumberOfRxPackages_BrokenStructur = 0;
+        this->StatsGSBP.NumberOfRxPackages_BrokenChecksum = 0;
+        this->StatsGSBP.BytesDiscarded = 0;
+        this->StatsGSBP.NumberOfRxBytes = 0;
+        this->StatsGSBP.NumberOfTxPackages = 0;
+        this->StatsGSBP.NumberOfTxBytes = 0;
+        this->StatsGSBP.HandlerCalls = 0;
+        this->StatsGSBP.HandlerTimeNs = 0;
+        this->StatsGSBP.HandlerTimeNsMax = 0;
+        this->StatsGSBP.HandlerQueueFull = 0;
+        this->StatsGSBP.HandlerQueueDepth = 0;
+        this->StatsGSBP.TxQueueDepth = 0;
+        this->StatsGSBP.RxRingLevel = 0;
+        // logging
+        for (uint32_t i=0; i<gsbp_LogRingSize; i++){
+        	this->LogRing[i].Sequence = i;
+        }
+        this->LogHead = 0;
+        this->LogTail = 0;
+        for (uint32_t i=0; i<NumberOfLogSites; i++){
+        	this->LogSites[i].WindowStartNs = 0;
+        	this->LogSites[i].Count = 0;
+        	this->LogSites[i].Suppressed = 0;
+        }
+        this->LogLevel = LogDebug;
+        this->LogRateLimit = gsbp_DefaultLogRateLimit;
+        this->LogLogged = 0;
+        this->LogRateLimited = 0;
+        this->LogDropped = 0;
+        this->LogSink = NULL;
+        this->Log_thread = NULL;
+        this->RunLogThread = false;
+        // metrics socket
+        this->RunMetricsThread = false;
+        this->Metrics_thread = NULL;
+        this->fdMetrics = -1;
+        memset(this->MetricsSocketPath, 0, sizeof(this->MetricsSocketPath));
 
         // buffer
-        memset(this->TxBuffer, 0, sizeof(this->TxBuffer));
-        this->TxBufferSize = 0;
+        this->TxQueue = NULL;
+        this->TxRequestIdGlobal = 0;
+        GSBP_XXX::ResetRxDecoder(false);
     	this->UnclaimedRequestResponces = 0;
+    	this->AnyResponseWaiters = 0;
+    	this->NumberOfAsyncRequests = 0;
+    	this->LastSubscriptionID = 0;
+    	this->HandlerTable = std::make_shared<const handlerTable_t>();
+    	this->SubscriptionsActive = false;
+    	for (uint32_t i=0; i<gsbp_RequestTableSize; i++){
+    		this->RequestTable[i] = RequestResponse_t();
+    		this->ResponseCounter[i] = 0;
+    		this->AsyncRequests[i] = asyncRequest_t();
+    	}
+    	for (uint32_t i=0; i<gsbp_CommandIdTableSize; i++){
+    		this->LatencyHistograms[i] = NULL;
+    	}
+    	// debug categories -> the defaults of the GSBP__DEBUG_* defines
+    	for (uint32_t i=0; i<gsbp_RequestTableSize; i++){
+    		this->RequestDebugTimes[i] = debugTimes_t();
+    	}
+    	this->DebugCategories =
+    			(GSBP__DEBUG_SENDING_COMMANDS                     ? DebugSendingCommands : 0) |
+    			(GSBP__DEBUG_RECEIVING_COMMANDS                   ? DebugReceivingCommands : 0) |
+    			(GSBP__DEBUG_RECEIVING_COMMANDS_EXEPT_MEAS_ACKS   ? DebugReceivingExceptMeasurementAcks : 0) |
+    			(GSBP__DEBUG_MCU_AND_INCREASE_TIMEOUTS            ? DebugMcuAndIncreaseTimeouts : 0) |
+    			(GSBP__DEBUG_GSBP_STATS                           ? DebugGsbpStats : 0) |
+    			(GSBP__DEBUG_SERIAL_ACTIONS                       ? DebugSerialActions : 0) |
+    			(GSBP__DEBUG_REQUEST_AND_RESPONSE_BUFFER          ? DebugRequestResponseBuffer : 0) |
+    			(GSBP__DEBUG_REQUEST_AND_RESPONSE_BUFFER_ALL      ? DebugRequestResponseBufferAll : 0) |
+    			(GSBP__DEBUG_REQUEST_AND_RESPONSE_BUFFER_PACKAGES ? DebugRequestResponseBufferPackages : 0);
+    	// packet lifecycle trace
+    	this->TraceActive = false;
+    	this->TraceUsers = 0;
+    	this->TraceSession = 0;
+    	// lock statistics
+    	this->RequestResponseLockStats.Enabled = false;
+    	this->ReadPackageLockStats.Enabled = false;
+    	GSBP_XXX::GetLockStatistics(NULL, NULL, true);
     }
 
     void GSBP_XXX::SetDefaultExtConfiguration(void)
@@ -673,6 +1192,7 @@ typedef union {
     	sprintf(this->ExtConfig.DeviceID, "GSBP");
     	this->ExtConfig.UseThreadToRead = true;
     	this->ExtConfig.PackageHandler = NULL;
+    	GSBP_XXX::SetDefaultPackageHandler(NULL);
     	this->ExtConfig.GetErrorString = NULL;
     	this->ExtConfig.GetCmdString = NULL;
     	this->ExtConfig.NodeInfoCMD_ID = 1;
@@ -681,6 +1201,8 @@ typedef union {
     	this->ExtConfig.ApplicationDataACK_ID = 216;
     	this->ExtConfig.DisplayWarnings = true;
     	this->ExtConfig.DisplayErrors = true;
+    	this->ExtConfig.ResponseSpinTimeUs = 0;
+    	this->ExtConfig.NumberOfHandlerThreads = gsbp_DefaultNumberOfHandlerThreads;
     }
 
     int GSBP_XXX::OpenDevice()
@@ -757,76 +1279,170 @@ typedef union {
         return fd;
     }
 
-    void GSBP_XXX::AddRequest(RequestResponse_t item)
+    void GSBP_XXX::AddRequest(RequestResponse_t* Request, txPackage_t* Cmd, asyncRequest_t* Async)
     {
-#if GSBP__DEBUG_SENDING_COMMANDS
-        item.CmdTime = boost::posix_time::microsec_clock::local_time();
-#endif
-#if GSBP__DEBUG_RECEIVING_COMMANDS
-        item.AckTime = boost::posix_time::ptime();
-#endif
-        boost::mutex::scoped_lock lock(this->RequestResponseLock_mutex);
-        GSBP_XXX::RequestResponseBuffer.push_front(item);
+        measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
+        if (GSBP_XXX::IsDebugEnabled(DebugSendingCommands | DebugReceivingCommands)){
+        	debugTimes_t* Times = &this->RequestDebugTimes[Request->RequestIdLocal];
+        	*Times = debugTimes_t();
+        	Times->RequestIdGlobal = Request->RequestIdGlobal;
+        	if (GSBP_XXX::IsDebugEnabled(DebugSendingCommands)){
+        		Times->CmdTime = boost::posix_time::microsec_clock::local_time();
+        	}
+        }
+        RequestResponse_t* Entry = &this->RequestTable[Request->RequestIdLocal];
+        if (Entry->RequestIdLocal != 0){
+        	// the previous request with this local request ID was never claimed -> it is replaced
+        	this->UnclaimedRequestResponces--;
+        }
+        GSBP_XXX::FreeRequestPayloads(Entry);
+        *Entry = *Request;
+        Entry->Cmd.Data = GSBP_XXX::AllocatePayload(Cmd->Data, Cmd->DataSize);
         ++this->UnclaimedRequestResponces;
+
+        // register the asynchronous request -> before the package is send
+        asyncRequest_t* AsyncEntry = &this->AsyncRequests[Request->RequestIdLocal];
+        std::function<void(asyncResponse_t*)> ReplacedCallback;
+        uint64_t ReplacedRequestID = AsyncEntry->RequestIdGlobal;
+        if (ReplacedRequestID != 0){
+        	// an asynchronous request with this local request ID is still open -> it can't be answered any more
+        	ReplacedCallback.swap(AsyncEntry->Callback);
+        	AsyncEntry->RequestIdGlobal = 0;
+        	this->NumberOfAsyncRequests--;
+        }
+        if (Async != NULL){
+        	*AsyncEntry = *Async;
+        	AsyncEntry->RequestIdGlobal = Request->RequestIdGlobal;
+        	this->NumberOfAsyncRequests++;
+        }
         lock.unlock();
+
+        if (ReplacedRequestID != 0){
+        	asyncResponse_t Result = asyncResponse_t();
+        	Result.RequestID = ReplacedRequestID;
+        	Result.ErrorCode = GSBP_NoRequestFound;
+        	ReplacedCallback(&Result);
+        }
     }
 
-    bool GSBP_XXX::ReadPackages(bool doReturnAfterTimeout)
+    /*
+     * swaps in a handler table with a new default handler (gsbpConfiguration_t::PackageHandler)
+     */
+    void GSBP_XXX::SetDefaultPackageHandler(packageHandler_t Handler)
     {
-        // look this function
-        boost::mutex::scoped_lock lock(this->ReadPackage_mutex);
-
-        fd_set rfd;
-        struct timeval TimeTimeout;
-        unsigned char       RxBuffer[gsbp_RxMaxUserDataSize];
-        size_t              RxBufferSize = 0;
-        size_t              BytesToRead = 0;
-        int                 BytesRead = 0;
-        int sel;
-        uint8_t ChecksumHeaderTemp = 0x00;
-
-        bool                SearchStartByte = true;
-        bool                ReadHeader = false;
-        bool                ReadData   = false;
-        bool                NewPackage = false;
-
-        memset(RxBuffer, 0, sizeof(RxBuffer));
-        FD_ZERO(&rfd);
-        FD_SET(this->fd, &rfd);
-        TimeTimeout.tv_sec = 0;
-        TimeTimeout.tv_usec = gsbp_PackageReadTimoutUs;
-
-        #if GSBP__ACTIVATE_16BIT_PACKAGE_LENGHT_FEATURE
-        convert16_t temp_datasize;
-        #endif
+		boost::mutex::scoped_lock lock(this->HandlerTable_mutex);
+		std::shared_ptr<handlerTable_t> NewTable = std::make_shared<handlerTable_t>(*std::atomic_load(&this->HandlerTable));
+		NewTable->DefaultHandler = Handler;
+		std::atomic_store(&this->HandlerTable, std::shared_ptr<const handlerTable_t>(NewTable));
+    }
 
-        //   struct timeval TimeTimeout, time_start, time_stop;
-        //gettimeofday(&time_start,NULL);
-        //gettimeofday(&time_stop,NULL);
-        //   u1 = time_start.tv_sec*1000 + time_start.tv_usec/1000;
-        //   u2 = time_stop.tv_sec*1000 + time_stop.tv_usec/1000;
-        //   *time_needed = (int)u2-u1;
+    /*
+     * hands a received package to the matching subscriptions -> returns false if there is none
+     */
+    bool GSBP_XXX::DeliverToSubscribers(rxPackage_t* Package)
+    {
+    	if (!this->SubscriptionsActive){
+    		return false;
+    	}
+    	bool Delivered = false;
+    	std::shared_ptr< const std::vector<subscription_t> > CurrentSubscriptions = std::atomic_load(&this->Subscriptions);
+    	for (auto Item = CurrentSubscriptions->begin(); Item != CurrentSubscriptions->end(); ++Item){
+    		if ((Item->CommandID == SubscribeToAnyID || Item->CommandID == Package->CommandID) &&
+    				(Item->RequestID == SubscribeToAnyID || Item->RequestID == Package->RequestID)){
+    			Item->Sink(Package);
+    			Delivered = true;
+    		}
+    	}
+    	return Delivered;
+    }
 
-        while(this->RunReceiverThread || doReturnAfterTimeout)
+    /*
+     * the device closed the connection -> marks it as hung up and wakes up all threads waiting for a response
+     * -> the flag is set under the request/response lock, so a waiter either sees it before it blocks or gets the notification
+     */
+    void GSBP_XXX::SignalHangup(void)
+    {
+    	boost::mutex::scoped_lock lock(this->RequestResponseLock_mutex);
+    	this->DeviceHungUp = true;
+    	for (uint32_t i=0; i<gsbp_RequestTableSize; i++){
+    		this->ResponseCounter[i].fetch_add(1, std::memory_order_release);
+    		this->ResponseCondition[i].notify_all();
+    	}
+    	this->AnyResponseCondition.notify_all();
+    }
+
+    /*
+     * completes the open asynchronous requests, which timed out (OnlyTimedOut) or all of them, with ErrorCode
+     * -> the callbacks are called without the lock
+     */
+    void GSBP_XXX::CompleteAsyncRequests(bool OnlyTimedOut, uint16_t ErrorCode)
+    {
+    	std::vector< std::pair<uint64_t, std::function<void(asyncResponse_t*)> > > Completed;
+    	measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
+    	std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+    	for (uint32_t i=1; i<=gsbp_MaxRequestIdLocal && this->NumberOfAsyncRequests > 0; i++){
+    		asyncRequest_t* Async = &this->AsyncRequests[i];
+    		if (Async->RequestIdGlobal != 0 && (!OnlyTimedOut || Now >= Async->Deadline)){
+    			// responses received later are removed by AddResponse
+    			GSBP_XXX::MarkResponseTimeout(Async->RequestIdGlobal);
+    			Completed.push_back(std::make_pair(Async->RequestIdGlobal, Async->Callback));
+    			Async->RequestIdGlobal = 0;
+    			Async->Callback = NULL;
+    			this->NumberOfAsyncRequests--;
+    		}
+    	}
+    	lock.unlock();
+
+    	if (Completed.empty()){
+    		return;
+    	}
+    	asyncResponse_t Result = asyncResponse_t();
+    	for (auto Item = Completed.begin(); Item != Completed.end(); ++Item){
+    		Result.RequestID = Item->first;
+    		Result.ErrorCode = ErrorCode;
+    		Item->second(&Result);
+    	}
+    }
+
+    bool GSBP_XXX::ReadPackages(bool doReturnAfterTimeout)
+    {
+        // the decoder is locked per read -> the chunks of concurrent readers are decoded in the order they were read,
+        // and the lock statistics show the wait and hold time of every read also for the receiver thread
+        measuredLock_t lock(this->ReadPackage_mutex, this->ReadPackageLockStats, boost::defer_lock);
+
+        fd_set rfd;
+        struct timeval TimeTimeout;
+        int  BytesRead = 0;
+        int  sel;
+        bool NewPackage = false;
+
+        FD_ZERO(&rfd);
+        FD_SET(this->fd, &rfd);
+        TimeTimeout.tv_sec = 0;
+        TimeTimeout.tv_usec = gsbp_PackageReadTimoutUs;
+
+        while((this->RunReceiverThread || doReturnAfterTimeout) && !this->DeviceHungUp)
         {
-            // TODO Watchdog??? TODO abbruch nach dem Einlesen aller Bytes von der Schnittstelle (don't use read threat)
+        	// complete the asynchronous requests, which timed out
+        	if (this->NumberOfAsyncRequests > 0){
+        		GSBP_XXX::CompleteAsyncRequests(true, GSBP_GetResponseTimeout);
+        	}
 
             // wait that something is received and check if the TimeTimeout was reached
             FD_SET(this->fd, &rfd);
+            TimeTimeout.tv_sec = 0;
             TimeTimeout.tv_usec = gsbp_PackageReadTimoutUs;
-            if ( (sel = select(this->fd+1, &rfd, NULL, NULL, &TimeTimeout)) == 0) {
-                // timeout triggered -> check if the package was complete;
-                if (!SearchStartByte){
-                    // the package is incomplete; this should never happen
-                    // build package from what we have so far
-                    GSBP_XXX::BuildPackage(RxBuffer, RxBufferSize, PackageIsBroken_IncompleteTimout, 0x00);
-                    // reset the buffer for the next command
-                    RxBufferSize = 0;
-                    BytesToRead = 0;
-                    SearchStartByte = true;
-                    ReadHeader = false;
-                    ReadData = false;
+            GSBP_XXX::Trace(TraceSelect, 'B', 0, 0);
+            sel = select(this->fd+1, &rfd, NULL, NULL, &TimeTimeout);
+            GSBP_XXX::Trace(TraceSelect, 'E', 0, (uint32_t)sel);
+            if (sel == 0) {
+                // timeout triggered -> check if a package is incomplete; this should never happen
+                lock.lock();
+                if (this->RxDecoder.Head != this->RxDecoder.Tail){
+                    // build package from what we have so far and reset the decoder for the next package
+                    GSBP_XXX::ResetRxDecoder(true);
                 }
+                lock.unlock();
                 // wait for a byte or exit -> start at the beginning of the loop
                 if (doReturnAfterTimeout){
                     // do not continuously read the serial interface; abort if there are no more bytes to read -> break
@@ -836,127 +1452,212 @@ typedef union {
             } else {
                 // the timeout did not occur -> did an error occur?
                 if (sel < 0){
-                    printf("\e[1m\e[91m%s ERROR during package read:\e[0m Wait for a byte: %s (%d)\n", this->ID, strerror(errno), errno);
+                    GSBP_XXX::Log(LogSiteRead, LogError, "during package read: Wait for a byte: %s (%d)", strerror(errno), errno);
                     // wait for one or more bytes or exit -> start at the beginning of the loop
                     continue;
                 }
             }
 
-            // read the x bytes available
-            if (SearchStartByte){
-                // a new package starts -> read only one byte to search for the start byte
-                BytesToRead = 1;
-            }
-            // check if the RxBuffer is large enough
-            if ((RxBufferSize+BytesToRead) > gsbp_RxMaxPackageSize){
-                // the RxBuffer is NOT large enough; this should never happen!
-                printf("\e[1m\e[91m%s ERROR during package read:\e[0m RxBuffer is NOT large enough!\n   Requested buffer = %d bytes; available buffer = %d\n", this->ID, (int)(RxBufferSize+BytesToRead), gsbp_RxMaxPackageSize);
-                // fill the buffer and let the BuildPackage function decide if the package is still usable
-                BytesToRead = gsbp_RxMaxPackageSize - RxBufferSize;
-                SearchStartByte = false;
-                ReadHeader = false;
-                ReadData = true;
-            }
-            // read n bytes
-            BytesRead = read(this->fd, (void* ) &RxBuffer[RxBufferSize], BytesToRead);
+            // read all bytes available (the device is opened non-blocking)
+            lock.lock();
+            GSBP_XXX::Trace(TraceRead, 'B', 0, 0);
+            BytesRead = read(this->fd, (void* ) this->RxChunk, sizeof(this->RxChunk));
+            GSBP_XXX::Trace(TraceRead, 'E', 0, (BytesRead > 0) ? BytesRead : 0);
             if (BytesRead < 0) {
-                printf("\e[1m\e[91m%s ERROR during package read:\e[0m Read n bytes < 0: %s (%d)\n", this->ID, strerror(errno), errno);
+                if (errno != EAGAIN && errno != EINTR){
+                    GSBP_XXX::Log(LogSiteRead, LogError, "during package read: Read n bytes < 0: %s (%d)", strerror(errno), errno);
+                }
+                lock.unlock();
                 continue;
             }
-            // we did read n bytes; set RxBufferSize to the next free value
-            RxBufferSize += BytesRead;
-            // degrease the BytesToRead counter
-            BytesToRead -= BytesRead;
-            // see if we are done for now?
-            if (BytesToRead == 0) {
-                // done to read a specific section -> start or header or data?
-                if (SearchStartByte){
-                    if (RxBuffer[0] == GSBP__UART_START_BYTE){
-                        // a new package starts -> read the header first - the one start byte
-                        BytesToRead = GSBP__UART_PACKAGE_HEADER_SIZE -1 ;
-                        SearchStartByte = false;
-                        ReadHeader = true;
-                        ReadData = false;
-                    } else {
-                        // this was not the start byte, something went wrong -> at least log the error
-                        this->StatsGSBP.BytesDiscarded++;
-                        RxBufferSize = 0;
+            if (BytesRead == 0){
+            	// end of file -> the device closed the connection (PTY hangup, socket closed, USB device removed);
+            	// select() reports the fd as readable from now on -> stop reading until DisconnectFromDevice()
+            	GSBP_XXX::Log(LogSiteRead, LogError, "during package read: The device closed the connection -> stop reading");
+            	lock.unlock();
+            	GSBP_XXX::SignalHangup();
+            	GSBP_XXX::CompleteAsyncRequests(false, GSBP_NotConnectedToDevice);
+            	break;
+            }
+            // wire capture
+            if (this->CaptureActive.load(std::memory_order_relaxed)){
+            	struct iovec IoVec = {this->RxChunk, (size_t)BytesRead};
+            	GSBP_XXX::CaptureData(CaptureInbound, &IoVec, 1);
+            }
+            // decode the chunk -> every complete package is build and added to the queue
+            if (GSBP_XXX::DecodeRxChunk(this->RxChunk, (uint32_t)BytesRead) > 0){
+                NewPackage = true;
+            }
+            lock.unlock();
+            if (doReturnAfterTimeout && NewPackage){
+                // called by a requesting thread -> return with the new packages; a device, which streams
+                // without a pause, would otherwise never let the read time out
+                break;
+            }
+        }
+
+        return NewPackage;  // return if called from same thread
+    }
+
+    /*
+     * adds a chunk of received bytes to the decoder ring and builds all packages completed by it
+     * returns the number of packages build
+     */
+    uint32_t GSBP_XXX::DecodeRxChunk(const uint8_t* Chunk, uint32_t ChunkSize)
+    {
+        uint32_t NumberOfPackages = 0;
+        rxDecoder_t* D = &this->RxDecoder;
+        this->StatsGSBP.NumberOfRxBytes.fetch_add(ChunkSize, std::memory_order_relaxed);
+
+        while (ChunkSize > 0){
+            // copy as much of the chunk into the ring as fits; the decoder always frees at least
+            // (gsbp_RxRingBufferSize - gsbp_RxMaxPackageSize) bytes, so the loop does progress
+            uint32_t BytesToCopy = gsbp_RxRingBufferSize - (D->Head - D->Tail);
+            if (BytesToCopy > ChunkSize){
+                BytesToCopy = ChunkSize;
+            }
+            uint32_t Index = D->Head & (gsbp_RxRingBufferSize -1);
+            uint32_t BytesUntilEnd = gsbp_RxRingBufferSize - Index;
+            if (BytesToCopy <= BytesUntilEnd){
+                memcpy(&D->Ring[Index], Chunk, BytesToCopy);
+            } else {
+                memcpy(&D->Ring[Index], Chunk, BytesUntilEnd);
+                memcpy(&D->Ring[0], &Chunk[BytesUntilEnd], BytesToCopy - BytesUntilEnd);
+            }
+            D->Head   += BytesToCopy;
+            Chunk     += BytesToCopy;
+            ChunkSize -= BytesToCopy;
+
+            // build all complete packages
+            NumberOfPackages += GSBP_XXX::DecodeRxRing();
+        }
+        this->StatsGSBP.RxRingLevel.store(D->Head - D->Tail, std::memory_order_relaxed);
+        return NumberOfPackages;
+    }
+
+    /*
+     * builds all complete packages in the decoder ring; incomplete packages stay in the ring
+     * returns the number of packages build
+     */
+    uint32_t GSBP_XXX::DecodeRxRing(void)
+    {
+        uint32_t NumberOfPackages = 0;
+        rxDecoder_t* D = &this->RxDecoder;
+        const uint32_t Mask = gsbp_RxRingBufferSize -1;
+
+        while (D->Head != D->Tail){
+            uint32_t BytesAvailable = D->Head - D->Tail;
+
+            if (D->PackageSize == 0){
+                // search the start byte -> only within the continuous part of the ring
+                uint32_t Index = D->Tail & Mask;
+                if (D->Ring[Index] != GSBP__UART_START_BYTE){
+                    uint32_t BytesToSearch = gsbp_RxRingBufferSize - Index;
+                    if (BytesToSearch > BytesAvailable){
+                        BytesToSearch = BytesAvailable;
                     }
+                    uint8_t* StartByte = (uint8_t*)memchr(&D->Ring[Index], GSBP__UART_START_BYTE, BytesToSearch);
+                    uint32_t BytesToDiscard = (StartByte != NULL) ? (uint32_t)(StartByte - &D->Ring[Index]) : BytesToSearch;
+                    // this was not the start byte, something went wrong -> at least log the error
+                    this->StatsGSBP.BytesDiscarded += BytesToDiscard;
+                    D->Tail += BytesToDiscard;
+                    continue;
                 }
-                else if (ReadHeader) {
-                    // reading the header is done -> make the checksum and get how many data bytes to read
-                    // make the checksum without the start byte and the checksum (RxBufferSize-1)
-#if GSBP__USE_CHECKSUMS
-                    ChecksumHeaderTemp = GSBP__UART_HEADER_CHECKSUM_START;
-                    for(uint32_t i=1; i<(RxBufferSize-1); i++){
-                        ChecksumHeaderTemp ^= RxBuffer[i];
-                        //TODO Checksumme ist nicht gut -> lieber one's sum ....
-                        //http://betterembsw.blogspot.de/2010/05/which-error-detection-code-should-you.html
-                    }
-                    // check the checksum
-                    if (RxBuffer[RxBufferSize-1] == ChecksumHeaderTemp) {
-#endif
-                        // checksum matches -> get the number of bytes to read next
-                        #if GSBP__ACTIVATE_16BIT_PACKAGE_LENGHT_FEATURE
-                        //temp_datasize.data = 0;
-                        //temp_datasize.c_data[1] = RxBuffer[GSBP__UART_NUMBER_OF_DATA_BYTES__START_BYTE];
-                        //temp_datasize.c_data[0] = RxBuffer[GSBP__UART_NUMBER_OF_DATA_BYTES__START_BYTE+1];
-                        //BytesToRead = temp_datasize.data;
-						BytesToRead = ((uint16_t)RxBuffer[GSBP__UART_NUMBER_OF_DATA_BYTES__START_BYTE+1] <<8) | (uint16_t)RxBuffer[GSBP__UART_NUMBER_OF_DATA_BYTES__START_BYTE];
-                        #else
-                        BytesToRead = (size_t)RxBuffer[GSBP__UART_NUMBER_OF_DATA_BYTES__START_BYTE];
-                        #endif
-                        if (BytesToRead > 0){
-                            BytesToRead += GSBP__UART_PACKAGE_TAIL_SIZE;
-                        } else {
-                            // TODO TAIL Size unabhäning vom den Daten machen bzw. Checksumsize einführen
-                            BytesToRead += 1;
-                        }
-                        SearchStartByte = false;
-                        ReadHeader = false;
-                        ReadData = true;
-                        continue;
+                // wait until the header is complete
+                if (BytesAvailable < GSBP__UART_PACKAGE_HEADER_SIZE){
+                    break;
+                }
+
 #if GSBP__USE_CHECKSUMS
-                    } else {
-                        // checksum does not match -> TODO what now? wait 10 us and flush the buffer?
-                        printf("\e[1m\e[91m%s ERROR during package read:\e[0m Header checksum failed for ACK number %lu (%s (ID = 0x%02X)) (is: 0x%02X; should be: 0x%02X)\n", this->ID, (long unsigned int)GSBP_XXX::GetCurrentRequestIdGlobal(isACK), GSBP_XXX::ext_GetCommandString((command_t)RxBuffer[1]), RxBuffer[1], ChecksumHeaderTemp, RxBuffer[RxBufferSize-1]);
-                        // update the statistics
-                        this->StatsGSBP.NumberOfRxPackages_BrokenChecksum++;
-                        // update the package counter because we receive a package, even if it is invalid
-//                        GSBP_XXX::GetRequestIdLocal(isACK, true);
-                        // TODO: send "repeat command" command
-                        //  wait 10 us and flush the buffer? there are data bytes availabe, which could contain a start_byte
-                        RxBufferSize = 0;
-                        BytesToRead = 0;
-                        SearchStartByte = true;
-                        ReadHeader = false;
-                        ReadData = false;
-                        continue;
-                    }
-#endif
+                // make the checksum without the start byte and the checksum
+                D->ChecksumHeader = GSBP__UART_HEADER_CHECKSUM_START;
+                for(uint32_t i=1; i<(GSBP__UART_PACKAGE_HEADER_SIZE -1); i++){
+                    D->ChecksumHeader ^= D->Ring[(D->Tail +i) & Mask];
                 }
-                else if (ReadData) {
-                    // reading the data section is done -> build the package (check for the end byte later)
-                    GSBP_XXX::BuildPackage(RxBuffer, RxBufferSize-1, PackageIsOk, ChecksumHeaderTemp);
-                    // reset the buffer for the next command
-                    RxBufferSize = 0;
-                    BytesToRead = 0;
-                    SearchStartByte = true;
-                    ReadHeader = false;
-                    ReadData = false;
-                    NewPackage = true;
+                if (D->Ring[(D->Tail +GSBP__UART_PACKAGE_HEADER_SIZE -1) & Mask] != D->ChecksumHeader){
+                    GSBP_XXX::Log(LogSiteDecoder, LogError, "during package read: Header checksum failed (is: 0x%02X; should be: 0x%02X)",
+                           D->Ring[(D->Tail +GSBP__UART_PACKAGE_HEADER_SIZE -1) & Mask], D->ChecksumHeader);
+                    // update the statistics and search the next start byte
+                    this->StatsGSBP.NumberOfRxPackages_BrokenChecksum++;
+                    this->StatsGSBP.BytesDiscarded++;
+                    D->Tail++;
                     continue;
                 }
-                else {
-                    printf("\e[1m\e[91m%s ERROR during package read:\e[0m Neither ReadHeader / ReadData active\n", this->ID);
+#endif
+                // get the number of data bytes
+                uint32_t DataSize;
+                #if GSBP__ACTIVATE_16BIT_PACKAGE_LENGHT_FEATURE
+                DataSize = ((uint32_t)D->Ring[(D->Tail +GSBP__UART_NUMBER_OF_DATA_BYTES__START_BYTE +1) & Mask] <<8) | (uint32_t)D->Ring[(D->Tail +GSBP__UART_NUMBER_OF_DATA_BYTES__START_BYTE) & Mask];
+                #else
+                DataSize = (uint32_t)D->Ring[(D->Tail +GSBP__UART_NUMBER_OF_DATA_BYTES__START_BYTE) & Mask];
+                #endif
+                if (DataSize > gsbp_RxMaxUserDataSize){
+                    // this can not be a valid header -> discard the start byte and search the next one
+                    GSBP_XXX::Log(LogSiteDecoder, LogError, "during package read: DataSize is to large!!! (DataSize = %u | max = %u)", DataSize, gsbp_RxMaxUserDataSize);
+                    this->StatsGSBP.NumberOfRxPackages_BrokenStructur++;
+                    this->StatsGSBP.BytesDiscarded++;
+                    D->Tail++;
+                    continue;
                 }
-            } // endif (BytesToRead == 0)
-        }
+                if (DataSize > 0){
+                    D->PackageSize = GSBP__UART_PACKAGE_HEADER_SIZE + DataSize + GSBP__UART_PACKAGE_TAIL_SIZE;
+                } else {
+                    // TODO TAIL Size unabhäning vom den Daten machen bzw. Checksumsize einführen
+                    D->PackageSize = GSBP__UART_PACKAGE_HEADER_SIZE + 1;
+                }
+            }
 
-        // UnLock the function
-        lock.unlock();
+            // wait until the package is complete
+            if (BytesAvailable < D->PackageSize){
+                break;
+            }
 
-        return NewPackage;  // return if called from same thread
+            // the package is complete -> build it directly from the ring, or from a linear copy if it wraps around
+            uint32_t Index = D->Tail & Mask;
+            uint8_t* Package = &D->Ring[Index];
+            if ((Index + D->PackageSize) > gsbp_RxRingBufferSize){
+                uint32_t BytesUntilEnd = gsbp_RxRingBufferSize - Index;
+                memcpy(D->Package, &D->Ring[Index], BytesUntilEnd);
+                memcpy(&D->Package[BytesUntilEnd], &D->Ring[0], D->PackageSize - BytesUntilEnd);
+                Package = D->Package;
+            }
+            // (check for the end byte later)
+            GSBP_XXX::BuildPackage(Package, D->PackageSize -1, PackageIsOk, D->ChecksumHeader);
+            D->Tail += D->PackageSize;
+            D->PackageSize = 0;
+            NumberOfPackages++;
+        }
+        return NumberOfPackages;
+    }
+
+    /*
+     * resets the decoder; an incomplete package is build (and discarded) if requested
+     */
+    void GSBP_XXX::ResetRxDecoder(bool DiscardIncompletePackage)
+    {
+        rxDecoder_t* D = &this->RxDecoder;
+
+        if (DiscardIncompletePackage && D->Head != D->Tail){
+            // build package from what we have so far
+            uint32_t BytesAvailable = D->Head - D->Tail;
+            uint32_t Index = D->Tail & (gsbp_RxRingBufferSize -1);
+            uint32_t BytesUntilEnd = gsbp_RxRingBufferSize - Index;
+            if (BytesAvailable > gsbp_RxMaxPackageSize){
+                BytesAvailable = gsbp_RxMaxPackageSize;
+            }
+            if (BytesAvailable <= BytesUntilEnd){
+                memcpy(D->Package, &D->Ring[Index], BytesAvailable);
+            } else {
+                memcpy(D->Package, &D->Ring[Index], BytesUntilEnd);
+                memcpy(&D->Package[BytesUntilEnd], &D->Ring[0], BytesAvailable - BytesUntilEnd);
+            }
+            GSBP_XXX::BuildPackage(D->Package, BytesAvailable, PackageIsBroken_IncompleteTimout, 0x00);
+        }
+        D->Head = 0;
+        D->Tail = 0;
+        D->PackageSize = 0;
+        D->ChecksumHeader = 0x00;
+        this->StatsGSBP.RxRingLevel.store(0, std::memory_order_relaxed);
     }
 
 
@@ -964,12 +1665,14 @@ typedef union {
     {
         size_t       RxBufferSizeCounter = 0;
         uint32_t     ChecksumDataTemp = 0;
+        GSBP_XXX::Trace(TraceBuildPackage, 'B', 0, RxBufferSize);
 
         if (State != PackageIsOk) {
             // the package is broken -> see if we can salvage anything
 
             // check if measurment ack and if not send "repeate last package" command
-            printf("\e[1m\e[91m%s ERROR during package build:\e[0m Package is broken (State = %d)...\n", this->ID, (int)State);
+            GSBP_XXX::Log(LogSiteBuildPackage, LogError, "during package build: Package is broken (State = %d)...", (int)State);
+            GSBP_XXX::Trace(TraceBuildPackage, 'E', 0, 0);
             return;
         }
 
@@ -984,7 +1687,7 @@ typedef union {
             if (RxBuffer[RxBufferSizeCounter++] != GSBP__UART_START_BYTE) {
                 // TODO
                 Package.State = PackageIsBroken_StartByteError;
-                printf("\e[1m\e[91m%s ERROR during package build:\e[0m Startbyte does not match (0x%02X)\n", this->ID, RxBuffer[RxBufferSizeCounter-1]);
+                GSBP_XXX::Log(LogSiteBuildPackage, LogError, "during package build: Startbyte does not match (0x%02X)", RxBuffer[RxBufferSizeCounter-1]);
                 // update the statistics
                 this->StatsGSBP.NumberOfRxPackages_BrokenStructur++;
                 // update the package counter because we receive a package, even if it is invalid
@@ -1011,8 +1714,8 @@ typedef union {
             // check if CommandID is valid
 /*            if (!GSBP_XXX::ext_IsCommandIDValid((command_t)Package->CommandID)){
                 Package->State = PackageIsBroken_InvalidCommandID;
-                printf("\e[1m\e[91m%s ERROR during package build:\e[0m Invalid CommandID!!! (%02d|0x%02X|%s)\n",
-                       this->ID, Package->CommandID, Package->CommandID, GSBP_XXX::ext_GetCommandString((command_t)Package->CommandID));
+                GSBP_XXX::Log(LogSiteBuildPackage, LogError, "during package build: Invalid CommandID!!! (%02d|0x%02X|%s)",
+                       Package->CommandID, Package->CommandID, GSBP_XXX::ext_GetCommandString((command_t)Package->CommandID));
                 // update the statistics
                 this->StatsGSBP.NumberOfRxPackages_BrokenStructur++;
                 // update the package counter because we receive a package, even if it is invalid
@@ -1032,8 +1735,8 @@ typedef union {
             Package->DataSize = (size_t)RxBuffer[RxBufferSizeCounter++];
             if (Package->DataSize > GSBP__UART_MAX_PACKAGE_SIZE){
                 Package->State = PackageIsBroken_IncompleteData;
-                printf("\e[1m\e[91m%s ERROR during package build:\e[0m DataSize is to large!!! (DataSize = %d | max = %d)\n",
-                       this->ID, Package->DataSize, GSBP__UART_MAX_PACKAGE_SIZE);
+                GSBP_XXX::Log(LogSiteBuildPackage, LogError, "during package build: DataSize is to large!!! (DataSize = %d | max = %d)",
+                       Package->DataSize, GSBP__UART_MAX_PACKAGE_SIZE);
                 // update the statistics
                 this->StatsGSBP.NumberOfRxPackages_BrokenStructur++;
                 // update the package counter because we receive a package, even if it is invalid
@@ -1051,8 +1754,8 @@ typedef union {
                 // the receive buffer is smaller as it should be -> ERROR
                 // TODO
                 Package.State = PackageIsBroken_IncompleteData;
-                printf("\e[1m\e[91m%s ERROR during package build:\e[0m RxBufferSize is to small!!! (ByteSize - ByteSizeCounter = %d)\n",
-                       this->ID, ((int)RxBufferSize - (int) RxBufferSizeCounter) );
+                GSBP_XXX::Log(LogSiteBuildPackage, LogError, "during package build: RxBufferSize is to small!!! (ByteSize - ByteSizeCounter = %d)",
+                       ((int)RxBufferSize - (int) RxBufferSizeCounter) );
                 // update the statistics
                 this->StatsGSBP.NumberOfRxPackages_BrokenStructur++;
                 break;
@@ -1063,8 +1766,8 @@ typedef union {
                     // there is a payload defined -> ERROR
                     // TODO
                     Package.State = PackageIsBroken_IncompleteData;
-                    printf("\e[1m\e[91m%s ERROR during package build:\e[0m RxBufferSize is to small and there should be data!!! (ByteSize - ByteSizeCounter = %d)\n",
-                           this->ID, ((int)RxBufferSize - (int) RxBufferSizeCounter) );
+                    GSBP_XXX::Log(LogSiteBuildPackage, LogError, "during package build: RxBufferSize is to small and there should be data!!! (ByteSize - ByteSizeCounter = %d)",
+                           ((int)RxBufferSize - (int) RxBufferSizeCounter) );
                     // update the statistics
                     this->StatsGSBP.NumberOfRxPackages_BrokenStructur++;
                     break;
@@ -1073,8 +1776,8 @@ typedef union {
                     if (RxBuffer[RxBufferSizeCounter] != GSBP__UART_END_BYTE){
                         // the last byte is not the UART end byte
                         Package.State = PackageIsBroken_EndByteError;
-                        printf("\e[1m\e[91m%s ERROR during package build:\e[0m The last byte for package %u (local: %u) is not the expected End byte! -> package is discarded\n   BufferCounter: %lu; BufferSize: %lu; Endbyte package: 0x%02X;  Endbyte Buffer: 0x%02X\n",
-                               this->ID, Package.CommandID, (unsigned int)Package.RequestID, (long unsigned int)RxBufferSizeCounter, (long unsigned int)RxBufferSize, RxBuffer[RxBufferSizeCounter], RxBuffer[RxBufferSize]);
+                        GSBP_XXX::Log(LogSiteBuildPackage, LogError, "during package build: The last byte for package %u (local: %u) is not the expected End byte! -> package is discarded\n   BufferCounter: %lu; BufferSize: %lu; Endbyte package: 0x%02X;  Endbyte Buffer: 0x%02X",
+                               Package.CommandID, (unsigned int)Package.RequestID, (long unsigned int)RxBufferSizeCounter, (long unsigned int)RxBufferSize, RxBuffer[RxBufferSizeCounter], RxBuffer[RxBufferSize]);
                         // update the statistics
                         this->StatsGSBP.NumberOfRxPackages_BrokenStructur++;
                         break;
@@ -1091,8 +1794,8 @@ typedef union {
                     // size does not match -> ERROR
                     // TODO
                     Package.State = PackageIsBroken_IncompleteData;
-                    printf("\e[1m\e[91m%s ERROR during package build:\e[0m RxBuffer to small ??? (ByteSize = %d / ByteSizeCounter+DataSize+UART_Tail = %d) (DataSize = %d)\n",
-                           this->ID, (int)RxBufferSize, (int)((RxBufferSizeCounter + Package.DataSize + GSBP__UART_PACKAGE_TAIL_SIZE)), (int)Package.DataSize );
+                    GSBP_XXX::Log(LogSiteBuildPackage, LogError, "during package build: RxBuffer to small ??? (ByteSize = %d / ByteSizeCounter+DataSize+UART_Tail = %d) (DataSize = %d)",
+                           (int)RxBufferSize, (int)((RxBufferSizeCounter + Package.DataSize + GSBP__UART_PACKAGE_TAIL_SIZE)), (int)Package.DataSize );
                     // update the statistics
                     this->StatsGSBP.NumberOfRxPackages_BrokenStructur++;
                     break;
@@ -1100,7 +1803,9 @@ typedef union {
                 {
                     // the size match -> copy the data
                     memcpy(Package.Data, &RxBuffer[RxBufferSizeCounter], Package.DataSize);
-                	Package.Data[Package.DataSize] = 0x00; // make sure strings are properly terminated
+                    if (Package.DataSize < gsbp_RxMaxUserDataSize){
+                    	Package.Data[Package.DataSize] = 0x00; // make sure strings are properly terminated
+                    }
                     // get the data checksum
                     // TODO
                     RxBufferSizeCounter += Package.DataSize;
@@ -1113,8 +1818,8 @@ typedef union {
                         // size does not macht -> ERROR
                         // TODO
                         Package.State = PackageIsBroken_EndByteError;
-                        printf("\e[1m\e[91m%s ERROR during package build:\e[0m The last byte for package %u (local: %u) is not the expected End byte! -> package is discarded\n   BufferCounter: %u; BufferSize: %u; Endbyte package: 0x%02X;  Endbyte Buffer: 0x%02X\n",
-                               this->ID, (uint32_t)Package.CommandID, (uint32_t)Package.RequestID, (uint32_t)RxBufferSizeCounter, (uint32_t)RxBufferSize, RxBuffer[RxBufferSizeCounter], RxBuffer[RxBufferSize]);
+                        GSBP_XXX::Log(LogSiteBuildPackage, LogError, "during package build: The last byte for package %u (local: %u) is not the expected End byte! -> package is discarded\n   BufferCounter: %u; BufferSize: %u; Endbyte package: 0x%02X;  Endbyte Buffer: 0x%02X",
+                               (uint32_t)Package.CommandID, (uint32_t)Package.RequestID, (uint32_t)RxBufferSizeCounter, (uint32_t)RxBufferSize, RxBuffer[RxBufferSizeCounter], RxBuffer[RxBufferSize]);
                         // update the statistics
                         this->StatsGSBP.NumberOfRxPackages_BrokenStructur++;
                         break;
@@ -1128,16 +1833,22 @@ typedef union {
         } while(false);
 
         // debug output
-        #if GSBP__DEBUG_RECEIVING_COMMANDS
+        if (GSBP_XXX::IsDebugEnabled(DebugReceivingCommands)){
         	GSBP_XXX::PrintPackage(&Package);
-        #endif
+        }
 
         // add the package for the RequestResponce queue
         if (Package.State == PackageIsOk) {
         	this->StatsGSBP.NumberOfRxPackages++;
-        	GSBP_XXX::AddResponse(&Package);
+        	GSBP_XXX::Trace(TraceBuildPackage, 'E', 0, Package.CommandID);
+        	// subscribed packages (e.g. measurement data) bypass the request/response buffer
+        	if (!GSBP_XXX::DeliverToSubscribers(&Package)){
+        		GSBP_XXX::AddResponse(&Package);
+        	}
         } else {
-        	GSBP_XXX::PrintPackage(&Package);
+        	GSBP_XXX::Trace(TraceBuildPackage, 'E', 0, Package.CommandID);
+        	GSBP_XXX::Log(LogSiteBuildPackage, LogError, "during package build: Package ID %d|0x%02X (local request ID: %u) is discarded (State = %d)",
+        			Package.CommandID, (uint8_t)Package.CommandID, (uint32_t)Package.RequestID, (int)Package.State);
         }
     }
 
@@ -1148,91 +1859,101 @@ typedef union {
     	 * Check queue / Add response to queue
     	 */
     	// lock the queue
-        boost::mutex::scoped_lock lock(this->RequestResponseLock_mutex);
+        GSBP_XXX::Trace(TraceAddResponse, 'B', 0, Response->CommandID);
+        GSBP_XXX::Trace(TraceAddResponseLock, 'B', 0, 0);
+        measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
+        GSBP_XXX::Trace(TraceAddResponseLock, 'E', 0, 0);
 
-        // check if there is a request for this response in the buffer and add it
+        // check if there is a request for this response and add it
+        // -> the local request ID addresses the request directly; 0 and 255 (measurement data) are never requested
         bool RequestFound = false;
-        boost::circular_buffer<RequestResponse_t>::iterator Request = this->RequestResponseBuffer.begin();
-        do {
-        	// search for the last request with the same local request ID
-        	for (Request = this->RequestResponseBuffer.begin();
-        			Request != this->RequestResponseBuffer.end(); Request++){
-        		// is the local request ID identical?
-        		if (Request->RequestIdLocal == Response->RequestID){
-        			// this is the last package received, with this local request ID
-        			RequestFound = true;
-        			break;
+        RequestResponse_t* Request = NULL;
+        if (Response->RequestID != 0 && Response->RequestID <= gsbp_MaxRequestIdLocal &&
+        		this->RequestTable[Response->RequestID].RequestIdLocal == Response->RequestID){
+        	RequestFound = true;
+        	Request = &this->RequestTable[Response->RequestID];
+        	// did this request already have an ACK?
+        	if (!Request->ResponseReceived && Request->SendTimeNs != 0){
+        		GSBP_XXX::RecordLatency(Request->Cmd.CommandID, GSBP_XXX::GetMonotonicTimeNs() - Request->SendTimeNs);
+        	}
+        	GSBP_XXX::Trace(TraceRequest, (Request->ResponseReceived || Request->WaitTimedOut) ? 'n' : 'e', Request->RequestIdGlobal, Response->CommandID);
+        	if (Request->ResponseReceived){
+        		// yes -> add a new dummy request
+        		if (this->DuplicateResponseBuffer.full()){
+        			// the oldest dummy request is dropped
+        			if (this->DuplicateResponseBuffer.back().RequestIdLocal != 0){
+        				// ... and was never claimed
+        				this->UnclaimedRequestResponces--;
+        			}
+        			GSBP_XXX::FreeRequestPayloads(&this->DuplicateResponseBuffer.back());
         		}
+        		this->DuplicateResponseBuffer.push_front(*Request);
+        		Request = &this->DuplicateResponseBuffer.front();
+        		Request->IsDummyCopy = true;
+        		Request->WaitForResponce = false;
+        		Request->WaitTimedOut = false;
+        		// the payloads belong to the original request
+        		Request->Cmd.Data = NULL;
+        		Request->Cmd.DataSize = 0;
+        		Request->Ack.Data = NULL;
+        		Request->ErrorDescription = NULL;
+        		++this->UnclaimedRequestResponces;
         	}
-        	if (RequestFound){
-        		// did this request already have an ACK?
-        		if (Request->ResponseReceived){
-        			// yes -> add a new dummy request
-        			RequestResponse_t DummyRequest = *Request;
-        			DummyRequest.IsDummyCopy = true;
-        			DummyRequest.ResponseReceived = false;
-        			DummyRequest.WaitForResponce = false;
-        			DummyRequest.WaitTimedOut = false;
-        			DummyRequest.Error = false;
-        			lock.unlock();
-        			GSBP_XXX::AddRequest(DummyRequest);
-        			lock.lock();
-        			continue;
-        		} else {
-        			// no -> the response was expected -> add the response to the request
-        			Request->ResponseReceived = true;
-        			Request->Ack = *Response;
-        			Request->Error = false;
-        			Request->ErrorCode = 0;
-#if GSBP__DEBUG_RECEIVING_COMMANDS
-        			Request->AckTime = boost::posix_time::microsec_clock::local_time();
-#endif
-        			break;
+        	// the response was expected -> add the response to the request
+        	Request->ResponseReceived = true;
+        	GSBP_XXX::FreePayload(Request->Ack.Data, Request->Ack.DataSize);
+        	Request->Ack.CommandID = Response->CommandID;
+        	Request->Ack.State = Response->State;
+        	Request->Ack.RequestID = Response->RequestID;
+        	Request->Ack.DataSize = Response->DataSize;
+        	Request->Ack.Data = GSBP_XXX::AllocatePayload(Response->Data, Response->DataSize);
+        	Request->Error = false;
+        	Request->ErrorCode = 0;
+        	if (GSBP_XXX::IsDebugEnabled(DebugReceivingCommands)){
+        		debugTimes_t* Times = &this->RequestDebugTimes[Response->RequestID];
+        		if (Times->RequestIdGlobal == Request->RequestIdGlobal && Times->AckTime.is_not_a_date_time()){
+        			Times->AckTime = boost::posix_time::microsec_clock::local_time();
         		}
         	}
-        } while (RequestFound && Request->ResponseReceived);
+        }
 
         bool RemoveRequest = false;
-        // check if this response is a message
+        // check if this response is a message -> the messages are printed by RunPackageHandlers()
         if (Response->CommandID == this->ExtConfig.MessageACK_ID){
           	gsbp_ACK_messageACK_t* data = (gsbp_ACK_messageACK_t*)Response->Data;
           	switch (data->msgType){
           	case MsgDebug:
           		RemoveRequest = true;
-          		GSBP_XXX::PackageHandler_Debug(Response);
-          		break;
-          	case MsgInfo:
-          		GSBP_XXX::PackageHandler_Debug(Response);
           		break;
           	case MsgError:
           	case MsgCriticalError:
-          		GSBP_XXX::PackageHandler_Error(Response);
           		if (RequestFound){
           			Request->Error = true;
           			Request->ErrorCode = data->errorCode;
-          			memset(Request->ErrorDescription, 0, gsbp_ErrorStringSize);
-          			memcpy(Request->ErrorDescription, data->msg, strlen((const char*)data->msg));
+          			if (Request->ErrorDescription != NULL){
+          				GSBP_XXX::FreePayload((uint8_t*)Request->ErrorDescription, strlen(Request->ErrorDescription) +1);
+          			}
+          			// the message is not necessarily terminated -> limit it to the received data and the error string size
+          			uint32_t MsgLength = (Response->DataSize > 4) ? strnlen((const char*)data->msg, std::min(Response->DataSize -4, gsbp_ErrorStringSize -1)) : 0;
+          			Request->ErrorDescription = (char*)GSBP_XXX::AllocatePayload(data->msg, MsgLength +1);
+          			Request->ErrorDescription[MsgLength] = 0x00;
           		}
           		break;
-          	case MsgWarning:
-          		GSBP_XXX::PackageHandler_Warning(Response);
-          		break;
           	default:
-          		 printf("\e[1m\e[91m%s ERROR during package post-processing:\e[0m MSG Invalid -> type %d, state %d, error %d\n   -> %s\n\n",
-          				this->ID, data->msgType, data->state, data->errorCode, data->msg);
+          		break;
           	}
         }
 
-        // call the external function to see if this package should be handled by the external implementation
+        // the external package handler is called after the lock is released (see below)
         uint64_t RequestIDextern = 0; // 0 = no response to a CMD
         if (RequestFound){
         	RequestIDextern = Request->RequestIdGlobal;
         }
-        if (GSBP_XXX::ExtPackageHandler(Response, RequestIDextern)){
-        	RemoveRequest = true;
-        }
 
     	// post-processing
+        std::function<void(asyncResponse_t*)> AsyncCallback;
+        asyncResponse_t  AsyncResultBuffer;
+        asyncResponse_t* AsyncResult = NULL;
     	if (RequestFound){
 			if (Request->WaitForResponce){
 				// the response is waited for
@@ -1242,27 +1963,198 @@ typedef union {
 			    }
 			}
 
+			// complete an asynchronous request -> the callback is called without the lock
+			asyncRequest_t* Async = &this->AsyncRequests[Response->RequestID];
+			if (!RemoveRequest && Async->RequestIdGlobal != 0 && Async->RequestIdGlobal == Request->RequestIdGlobal &&
+					(Async->AckId == 0 || Async->AckId == Response->CommandID || Request->Error)){
+				AsyncCallback.swap(Async->Callback);
+				Async->RequestIdGlobal = 0;
+				this->NumberOfAsyncRequests--;
+				AsyncResult = &AsyncResultBuffer;
+				*AsyncResult = asyncResponse_t();
+				AsyncResult->RequestID = Request->RequestIdGlobal;
+				AsyncResult->ResponseReceived = true;
+				AsyncResult->ErrorCode = (Request->Error) ? Request->ErrorCode : (uint16_t)NoError;
+				GSBP_XXX::CopyResponse(Request, &AsyncResult->Ack);
+				RemoveRequest = true;
+			}
+
 			if(RemoveRequest){
-				Request->RequestIdLocal  = 0;
-				Request->RequestIdGlobal = 0;
-				this->UnclaimedRequestResponces--;
+				GSBP_XXX::ClaimRequest(Request);
+			}
+			// wake up the threads waiting in GetResponse for this local request ID
+			this->ResponseCounter[Response->RequestID].fetch_add(1, std::memory_order_release);
+			this->ResponseCondition[Response->RequestID].notify_all();
+			if (this->AnyResponseWaiters > 0){
+				this->AnyResponseCondition.notify_all();
 			}
-			return Request->RequestIdGlobal;
     	} else {
-#if GSBP__DEBUG_REQUEST_AND_RESPONSE_BUFFER
-    		std::cout << this->ID << " AddResponce: Unrequested response received!!!" << std::endl;
-    		GSBP_XXX::PrintPackage(Response);
-#endif
+    		if (GSBP_XXX::IsDebugEnabled(DebugRequestResponseBuffer)){
+    			std::cout << this->ID << " AddResponce: Unrequested response received!!!" << std::endl;
+    			GSBP_XXX::PrintPackage(Response);
+    		}
+    	}
+    	lock.unlock();
+
+    	// call the asynchronous callback and the package handlers without the lock
+    	if (AsyncResult != NULL){
+    		AsyncCallback(AsyncResult);
+    	}
+    	GSBP_XXX::DispatchPackageHandlers(Response, RequestIDextern);
+
+    	GSBP_XXX::Trace(TraceAddResponse, 'E', RequestIDextern, Response->CommandID);
+    	return RequestIDextern;
+    }
+
+    /*
+     * hands the package to the package handlers -> in this thread or in the handler thread for this CMD/ACK ID
+     * -> all packages with the same CMD/ACK ID are handled by the same thread, so their order is kept
+     */
+    void GSBP_XXX::DispatchPackageHandlers(rxPackage_t* Package, uint64_t RequestId)
+    {
+    	if (this->HandlerWorkers.empty()){
+    		GSBP_XXX::RunPackageHandlers(Package, RequestId);
+    		return;
+    	}
+    	handlerWorker_t* Worker = this->HandlerWorkers[Package->CommandID % this->HandlerWorkers.size()];
+    	boost::mutex::scoped_lock lock(Worker->Queue_mutex);
+    	if (Worker->Queue.size() >= gsbp_HandlerQueueSize){
+    		this->StatsGSBP.HandlerQueueFull++;
+    	}
+    	while (Worker->Queue.size() >= gsbp_HandlerQueueSize){
+    		// the handlers are to slow -> wait instead of dropping packages
+    		Worker->QueueCondition.wait(lock);
+    	}
+    	handlerJob_t* Job;
+    	if (!Worker->FreeJobs.empty()){
+    		Job = Worker->FreeJobs.back();
+    		Worker->FreeJobs.pop_back();
+    	} else {
+    		Job = new handlerJob_t;
+    	}
+    	// copy only the used part of the package
+    	memcpy(&Job->Package, Package, offsetof(rxPackage_t, Data) + Package->DataSize);
+    	Job->RequestId = RequestId;
+    	Worker->Queue.push_back(Job);
+    	this->StatsGSBP.HandlerQueueDepth++;
+    	GSBP_XXX::Trace(TraceHandlerQueue, 'i', RequestId, (uint32_t)Worker->Queue.size());
+    	lock.unlock();
+    	Worker->QueueCondition.notify_all();
+    }
+
+    /*
+     * calls the package handlers (message output and the external package handler)
+     * -> if the external handler handled the response, the request is removed from the request/response buffer
+     */
+    void GSBP_XXX::RunPackageHandlers(rxPackage_t* Package, uint64_t RequestId)
+    {
+    	uint64_t StartNs = GSBP_XXX::GetMonotonicTimeNs();
+    	GSBP_XXX::Trace(TracePackageHandlers, 'B', RequestId, Package->CommandID);
+        // check if this response is a message
+        if (Package->CommandID == this->ExtConfig.MessageACK_ID){
+          	gsbp_ACK_messageACK_t* data = (gsbp_ACK_messageACK_t*)Package->Data;
+          	switch (data->msgType){
+          	case MsgDebug:
+          	case MsgInfo:
+          		GSBP_XXX::PackageHandler_Debug(Package);
+          		break;
+          	case MsgError:
+          	case MsgCriticalError:
+          		GSBP_XXX::PackageHandler_Error(Package);
+          		break;
+          	case MsgWarning:
+          		GSBP_XXX::PackageHandler_Warning(Package);
+          		break;
+          	default:
+          		 GSBP_XXX::Log(LogSiteMessageError, LogError, "during package post-processing: MSG Invalid -> type %d, state %d, error %d\n   -> %s",
+          				data->msgType, data->state, data->errorCode, data->msg);
+          	}
+        }
+
+        // call the external function to see if this package should be handled by the external implementation
+        if (GSBP_XXX::ExtPackageHandler(Package, RequestId) && RequestId != InvalidRequestID){
+        	// yes -> remove the response, if it was not claimed meanwhile
+        	measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
+        	uint32_t NumberOfOpenRequests;
+        	RequestResponse_t* Response = GSBP_XXX::FindResponse(RequestId, 0, false, &NumberOfOpenRequests);
+        	if (Response != NULL){
+        		GSBP_XXX::ClaimRequest(Response);
+        	}
+        }
+        uint64_t HandlerNs = GSBP_XXX::GetMonotonicTimeNs() - StartNs;
+        this->StatsGSBP.HandlerCalls.fetch_add(1, std::memory_order_relaxed);
+        this->StatsGSBP.HandlerTimeNs.fetch_add(HandlerNs, std::memory_order_relaxed);
+        UpdateMaximum(this->StatsGSBP.HandlerTimeNsMax, HandlerNs);
+        GSBP_XXX::Trace(TracePackageHandlers, 'E', RequestId, Package->CommandID);
+    }
+
+    /*
+     * handler thread -> handles the queued packages of its CMD/ACK IDs until it is stopped and the queue is empty
+     */
+    void GSBP_XXX::HandlerWorker(handlerWorker_t* Worker)
+    {
+    	boost::mutex::scoped_lock lock(Worker->Queue_mutex);
+    	while (true){
+    		while (Worker->Queue.empty() && Worker->Run){
+    			Worker->QueueCondition.wait(lock);
+    		}
+    		if (Worker->Queue.empty()){
+    			break;
+    		}
+    		handlerJob_t* Job = Worker->Queue.front();
+    		Worker->Queue.pop_front();
+    		this->StatsGSBP.HandlerQueueDepth--;
+    		lock.unlock();
+
+    		GSBP_XXX::RunPackageHandlers(&Job->Package, Job->RequestId);
+
+    		lock.lock();
+    		Worker->FreeJobs.push_back(Job);
+    		Worker->QueueCondition.notify_all();
     	}
+    }
+
+    /*
+     * starts/stops the handler threads -> see gsbpConfiguration_t::NumberOfHandlerThreads
+     */
+    void GSBP_XXX::StartHandlerWorkers(void)
+    {
+    	for (uint32_t i=0; i<this->ExtConfig.NumberOfHandlerThreads; i++){
+    		handlerWorker_t* Worker = new handlerWorker_t;
+    		Worker->Run = true;
+    		Worker->Thread = new boost::thread(&GSBP_XXX::HandlerWorker, this, Worker);
+    		this->HandlerWorkers.push_back(Worker);
+    	}
+    }
 
-    	return 0;
+    void GSBP_XXX::StopHandlerWorkers(void)
+    {
+    	for (auto Item = this->HandlerWorkers.begin(); Item != this->HandlerWorkers.end(); ++Item){
+    		handlerWorker_t* Worker = *Item;
+    		boost::mutex::scoped_lock lock(Worker->Queue_mutex);
+    		Worker->Run = false;
+    		lock.unlock();
+    		Worker->QueueCondition.notify_all();
+    		// the queued packages are handled before the thread stops
+    		Worker->Thread->join();
+    		delete Worker->Thread;
+    		for (auto Job = Worker->FreeJobs.begin(); Job != Worker->FreeJobs.end(); ++Job){
+    			delete *Job;
+    		}
+    		delete Worker;
+    	}
+    	this->HandlerWorkers.clear();
     }
 
 
     bool  GSBP_XXX::ExtPackageHandler(rxPackage_t* Package, uint64_t RequestId)
     {
-    	if (this->ExtConfig.PackageHandler != NULL){
-    		return this->ExtConfig.PackageHandler(Package, RequestId);
+    	// the handler of this CMD/ACK ID or the default handler
+    	std::shared_ptr<const handlerTable_t> Table = std::atomic_load(&this->HandlerTable);
+    	if (Package->CommandID < gsbp_CommandIdTableSize && Table->Handler[Package->CommandID] != NULL){
+    		return Table->Handler[Package->CommandID](Package, RequestId);
+    	} else if (Table->DefaultHandler != NULL){
+    		return Table->DefaultHandler(Package, RequestId);
     	} else {
     		return false;
     	}
@@ -1272,11 +2164,12 @@ typedef union {
     	if (Package->DataSize > 0){
     		// print Message
     		// make sure this qualifies as a string
-    		Package->Data[Package->DataSize] = 0x00;
-    		Package->Data[Package->DataSize+1] = 0x00;
+    		uint32_t End = std::min<uint32_t>(Package->DataSize, gsbp_RxMaxUserDataSize -2); // the payload can fill Data[] completely
+    		Package->Data[End] = 0x00;
+    		Package->Data[End+1] = 0x00;
     		gsbp_ACK_messageACK_t* data = (gsbp_ACK_messageACK_t*)Package->Data;
-            printf("%s: Debug Package received (S:%d; EC:%d)\n   Message: %s\n\n",
-            		this->ID, data->state, data->errorCode, data->msg);
+            GSBP_XXX::Log(LogSiteMessageDebug, (data->msgType == MsgInfo) ? LogInfo : LogDebug, "Debug Package received (S:%d; EC:%d)\n   Message: %s",
+            		data->state, data->errorCode, data->msg);
         }
     }
 
@@ -1287,11 +2180,12 @@ typedef union {
     		if (Package->DataSize > 0){
     			// print Message
     			// make sure this qualifies as a string
-    			Package->Data[Package->DataSize] = 0x00;
-    			Package->Data[Package->DataSize+1] = 0x00;
+    			uint32_t End = std::min<uint32_t>(Package->DataSize, gsbp_RxMaxUserDataSize -2); // the payload can fill Data[] completely
+    			Package->Data[End] = 0x00;
+    			Package->Data[End+1] = 0x00;
     			gsbp_ACK_messageACK_t* P = (gsbp_ACK_messageACK_t*)Package->Data;
-    			printf("%s: WARNING received (S:%d; EC:%d)\n   Message: %s\n\n",
-    					this->ID, P->state, P->errorCode, P->msg);
+    			GSBP_XXX::Log(LogSiteMessageWarning, LogWarning, "Warning package received (S:%d; EC:%d)\n   Message: %s",
+    					P->state, P->errorCode, P->msg);
     		}
     	}
     }
@@ -1300,22 +2194,24 @@ typedef union {
     	if (this->ExtConfig.DisplayErrors){
     		if (Package->DataSize > 0) {
     			// make sure this qualifies as a string
-    			Package->Data[Package->DataSize] = 0x00;
-    			Package->Data[Package->DataSize+1] = 0x00;
+    			uint32_t End = std::min<uint32_t>(Package->DataSize, gsbp_RxMaxUserDataSize -2); // the payload can fill Data[] completely
+    			Package->Data[End] = 0x00;
+    			Package->Data[End+1] = 0x00;
     			gsbp_ACK_messageACK_t* P = (gsbp_ACK_messageACK_t*)Package->Data;
 
     			// check the error id
     			if (P->errorCode == NoError){
     				// no error id set
-    				printf("\e[1m\e[91m%s: Error package received\e[0m but there was not ErrorCode!\n   -> %s\n\n", this->ID, P->msg);
+    				GSBP_XXX::Log(LogSiteMessageError, LogError, "Error package received but there was not ErrorCode!\n   -> %s", P->msg);
     				return NoError;
     			}
 
-    			// the error id is valid
-    			printf("\e[1m\e[91m%s: Error package received\e[0m after sending ID %d|0x%02X!\n   -> ErrorCode: \e[1m\e[91m%s\e[0m (ID: %d (0x%02X))\n",
-    					this->ID, (uint16_t)this->RequestResponseBuffer[0].Cmd.CommandID, (uint8_t)this->RequestResponseBuffer[0].Cmd.CommandID, GSBP_XXX::GetErrorString(P->errorCode), (uint8_t)P->errorCode, (uint8_t)P->errorCode);
-    			printf("   -> Back trace: State=%d;\n", P->state);
-    			printf("   -> Error MSG: \"\e[4m%s\e[24m\"\n\n", P->msg);
+    			// the error id is valid -> get the command, which caused the error (the handler may run in another thread)
+    			measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
+    			uint16_t CommandID = this->RequestTable[(Package->RequestID != 0) ? Package->RequestID : GSBP_XXX::GetCurrentRequestIdLocal()].Cmd.CommandID;
+    			lock.unlock();
+    			GSBP_XXX::Log(LogSiteMessageError, LogError, "Error package received after sending ID %d|0x%02X!\n   -> ErrorCode: %s (ID: %d (0x%02X))\n   -> Back trace: State=%d;\n   -> Error MSG: \"%s\"",
+    					CommandID, (uint8_t)CommandID, GSBP_XXX::GetErrorString(P->errorCode), (uint8_t)P->errorCode, (uint8_t)P->errorCode, P->state, P->msg);
     			return P->errorCode;
     		}
     	}
@@ -1346,19 +2242,12 @@ typedef union {
 
 
     /*
-     * returns the next 8bit local request ID
+     * returns the next global request ID
      */
-    uint8_t GSBP_XXX::GetNextRequestIdLocal(void)
+    uint64_t GSBP_XXX::GetNextRequestIdGlobal(void)
     {
-        ++this->StatsGSBP.LocalTxRequestID;
-        ++this->StatsGSBP.GlobalTxRequestID;
-
-        if (this->StatsGSBP.LocalTxRequestID == 0 ||
-        	this->StatsGSBP.LocalTxRequestID == 255){
-        	// 255 and 0 are invalid as new local request IDs
-        	this->StatsGSBP.LocalTxRequestID = 1;
-        }
-        return this->StatsGSBP.LocalTxRequestID;
+    	// atomic -> every sending thread gets its own request ID; 0 is never used
+        return this->TxRequestIdGlobal.fetch_add(1) +1;
     }
 
     /*
@@ -1366,7 +2255,7 @@ typedef union {
      */
     uint8_t GSBP_XXX::GetCurrentRequestIdLocal(void)
     {
-        return this->StatsGSBP.LocalTxRequestID;
+        return GSBP_XXX::GetRequestIdLocal(this->TxRequestIdGlobal.load());
     }
 
     /*
@@ -1374,95 +2263,1802 @@ typedef union {
      */
     uint64_t GSBP_XXX::GetCurrentRequestIdGlobal(void)
     {
-    	return this->StatsGSBP.GlobalTxRequestID;
+    	return this->TxRequestIdGlobal.load();
     }
 
-
-    /* ### #########################################################################
-     * Debug / Info functions
-     * ### #########################################################################
+    /*
+     * returns the local request ID used for a global request ID
+     * -> the local IDs cycle through 1..254, so the global ID is the local ID plus a generation counter
      */
-
-    void GSBP_XXX::DoPrintNodeInfo(gsbp_ACK_nodeInfo_t* NodeInfo)
+    uint8_t GSBP_XXX::GetRequestIdLocal(uint64_t RequestIdGlobal)
     {
-    	std::cout << this->ID << " Device Information:" << std::endl;
-    	std::cout << "   Board ID: " << NodeInfo->boardID << std::endl;
-    	std::cout << "   Device Class: " << NodeInfo->deviceClass << std::endl;
-    	std::cout << "   Serial Number: " << NodeInfo->serialNumber << std::endl;
-    	std::cout << "   Version GSBP: [" << (uint32_t)NodeInfo->versionProtocol[0] << "][" << (uint32_t)NodeInfo->versionProtocol[1] << "]" << std::endl;
-    	std::cout << "   Version Firmware: [" << (uint32_t)NodeInfo->versionFirmware[0] << "][" << (uint32_t)NodeInfo->versionFirmware[1] << "]" << std::endl;
-    	if (strlen((const char*)NodeInfo->msg) > 0){
-    		std::cout << "   Description: " << NodeInfo->msg << std::endl;
+    	if (RequestIdGlobal == InvalidRequestID){
+    		return InvalidRequestID;
     	}
-    	std::cout << std::endl;
+    	return (uint8_t)(((RequestIdGlobal -1) % gsbp_MaxRequestIdLocal) +1);
     }
 
-    void GSBP_XXX::DoPrintPackageContent(txPackage_t* Package, uint8_t RequestIdLocal)
+    /*
+     * marks a request as claimed -> the response was returned or handled; call with RequestResponseLock_mutex locked
+     */
+    void GSBP_XXX::ClaimRequest(RequestResponse_t* Request)
     {
-        std::cout << "        -> ID number Local: " << (uint32_t)RequestIdLocal << std::endl;
-        if ( Package->DataSize > 0 ) {
-            std::cout << "        -> Data:" << std::endl << "           ";
-            for(uint32_t i=0,j=0; i<Package->DataSize; i++, j++){
-                printf("0x%02X ", Package->Data[i]);
-                if (j==GSBP__DEBUG__PP_N_DATA_BYTES_PER_LINE){
-                    printf("\n           ");
-                    j=0;
-                }
-            }
-            printf("\n");
-        }
+    	Request->RequestIdLocal  = 0;
+    	Request->RequestIdGlobal = 0;
+    	this->UnclaimedRequestResponces--;
     }
 
-    void GSBP_XXX::DoPrintPackageContent(rxPackage_t* Package)
+    /*
+     * returns a buffer of the payload pool holding a copy of Data; NULL if there is no data
+     * -> call with RequestResponseLock_mutex locked
+     */
+    uint8_t* GSBP_XXX::AllocatePayload(const void* Data, uint32_t DataSize)
     {
-        std::cout << "        -> ID number Local: " << (uint32_t)Package->RequestID << std::endl;
-        if ( Package->DataSize > 0 ) {
-            std::cout << "        -> Data:" << std::endl << "           ";
-        	for(uint32_t i=0,j=0; i<Package->DataSize; i++, j++){
-                printf("0x%02X ", Package->Data[i]);
-                if (j==GSBP__DEBUG__PP_N_DATA_BYTES_PER_LINE){
-                    printf("\n           ");
-                    j=0;
-                }
-            }
-            printf("\n");
-        }
+    	if (DataSize == 0){
+    		return NULL;
+    	}
+    	uint32_t SizeClass = 0;
+    	while (gsbp_PayloadPoolSizes[SizeClass] < DataSize){
+    		SizeClass++;
+    	}
+    	uint8_t* Buffer;
+    	if (!this->PayloadPool[SizeClass].empty()){
+    		Buffer = this->PayloadPool[SizeClass].back();
+    		this->PayloadPool[SizeClass].pop_back();
+    	} else {
+    		// the pool for this size is empty -> grow it
+    		Buffer = new uint8_t[gsbp_PayloadPoolSizes[SizeClass]];
+    		this->PayloadPoolBuffers.push_back(Buffer);
+    	}
+    	memcpy(Buffer, Data, DataSize);
+    	return Buffer;
     }
 
-    void GSBP_XXX::DoPrintPackage(rxPackage_t* Package, bool IsACK)
+    /*
+     * returns a buffer to the payload pool -> call with RequestResponseLock_mutex locked
+     */
+    void GSBP_XXX::FreePayload(uint8_t* Data, uint32_t DataSize)
     {
-    	if (GSBP__DEBUG_RECEIVING_COMMANDS_EXEPT_MEAS_ACKS && (Package->CommandID == this->ExtConfig.ApplicationDataACK_ID)){
+    	if (Data == NULL || DataSize == 0){
     		return;
     	}
+    	uint32_t SizeClass = 0;
+    	while (gsbp_PayloadPoolSizes[SizeClass] < DataSize){
+    		SizeClass++;
+    	}
+    	this->PayloadPool[SizeClass].push_back(Data);
+    }
 
-        char CTyp[50], CTypfull[50], CState[100], COptions[100], CChecksumData[50], CColor[50];
-        // prepare what to print
-        if (IsACK){
-            switch (Package->State){
-                case PackageIsOk:                        sprintf(CState, "Ok"); break;
-                case PackageIsBroken:                    sprintf(CState, "Broken"); break;
-                case PackageIsBroken_EndByteError:       sprintf(CState, "Broken, because the end byte did not match"); break;
-                case PackageIsBroken_IncompleteData:     sprintf(CState, "Broken, because the Data was incomplete"); break;
-                case PackageIsBroken_IncompleteTimout:   sprintf(CState, "Broken, because not all bytes were transmitted in time"); break;
-                default:                                 sprintf(CState, "Unknown state!");
-            }
-            sprintf(CTyp, "ACK");
-            sprintf(CTypfull, "ACK -> State: %s", CState);
-        } else {
-        	sprintf(CTyp, "CMD");
-        	sprintf(CTypfull, "CMD");
-        }
+    /*
+     * returns all payloads of a request/response element to the payload pool -> call with RequestResponseLock_mutex locked
+     */
+    void GSBP_XXX::FreeRequestPayloads(RequestResponse_t* Request)
+    {
+    	GSBP_XXX::FreePayload(Request->Cmd.Data, Request->Cmd.DataSize);
+    	GSBP_XXX::FreePayload(Request->Ack.Data, Request->Ack.DataSize);
+    	if (Request->ErrorDescription != NULL){
+    		GSBP_XXX::FreePayload((uint8_t*)Request->ErrorDescription, strlen(Request->ErrorDescription) +1);
+    	}
+    	Request->Cmd.Data = NULL;
+    	Request->Ack.Data = NULL;
+    	Request->ErrorDescription = NULL;
+    }
 
-        COptions[0] = 0x00;
-        #if GSBP__ACTIVATE_DESTINATION_FEATURE || GSBP__ACTIVATE_SOURCE_DESTINATION_FEATURE
-        sprintf(&COptions[strlen(COptions)], "   Destination: %d\n", Package->Destination);
-        #endif
-        #if GSBP__ACTIVATE_SOURCE_FEATURE || GSBP__ACTIVATE_SOURCE_DESTINATION_FEATURE
-        sprintf(&COptions[strlen(COptions)], "   Source: %d\n", Package->Source);
-        #endif
-        #if GSBP__ACTIVATE_CONTROL_BYTE_FEATURE
-        sprintf(&COptions[strlen(COptions)], "   Control Byte: 0x%02X\n", Package->Control);
-        #endif
+    /*
+     * returns the oldest valid response for a request (or its dummy copies); NULL if there is none
+     * -> call with RequestResponseLock_mutex locked
+     */
+    GSBP_XXX::RequestResponse_t* GSBP_XXX::FindResponse(uint64_t RequestId, uint16_t AckId, bool WaitForResponce, uint32_t* NumberOfOpenRequests)
+    {
+    	RequestResponse_t* Request = &this->RequestTable[GSBP_XXX::GetRequestIdLocal(RequestId)];
+    	RequestResponse_t* Response = NULL;
+    	*NumberOfOpenRequests = 0;
+    	if (Request->RequestIdGlobal == RequestId){
+    		// this is the request
+    		(*NumberOfOpenRequests)++;
+    		Request->WaitForResponce = WaitForResponce;
+    		// is the response valid?
+    		if (Request->ResponseReceived && (AckId == 0 || Request->Ack.CommandID == AckId)){
+    			Response = Request;
+    		}
+    	}
+    	for (auto Item = this->DuplicateResponseBuffer.rbegin();
+    			Item != this->DuplicateResponseBuffer.rend(); ++Item){
+    		if (Item->RequestIdGlobal == RequestId){
+    			(*NumberOfOpenRequests)++;
+    			Item->WaitForResponce = WaitForResponce;
+    			if (Response == NULL && Item->ResponseReceived && (AckId == 0 || Item->Ack.CommandID == AckId)){
+    				Response = &(*Item);
+    			}
+    		}
+    	}
+    	return Response;
+    }
+
+    /*
+     * marks a request (and its dummy copies) as timed out -> responses received later are removed by AddResponse
+     * -> returns the number of open requests; call with RequestResponseLock_mutex locked
+     */
+    uint32_t GSBP_XXX::MarkResponseTimeout(uint64_t RequestId)
+    {
+    	uint32_t NumberOfOpenRequests = 0;
+    	RequestResponse_t* Request = &this->RequestTable[GSBP_XXX::GetRequestIdLocal(RequestId)];
+    	if (Request->RequestIdGlobal == RequestId){
+    		// this is the request
+    		if (!Request->ResponseReceived && !Request->WaitTimedOut){
+    			GSBP_XXX::Trace(TraceRequest, 'e', RequestId, 0);
+    		}
+    		Request->WaitForResponce = true;
+    		Request->WaitTimedOut = true;
+    		NumberOfOpenRequests++;
+    	}
+    	for (auto Item = this->DuplicateResponseBuffer.begin();
+    			Item != this->DuplicateResponseBuffer.end(); ++Item){
+    		if (Item->RequestIdGlobal == RequestId){
+    			Item->WaitForResponce = true;
+    			Item->WaitTimedOut = true;
+    			NumberOfOpenRequests++;
+    		}
+    	}
+    	this->StatsGSBP.NumberOfRxPackages_Missing++;
+    	return NumberOfOpenRequests;
+    }
+
+    /*
+     * builds the byte stream of a package -> returns the package size
+     */
+    uint32_t GSBP_XXX::EncodePackage(txPackage_t* P, uint8_t RequestIdLocal, uint8_t* Buffer)
+    {
+    	uint32_t BufferSize = 0;
+        // SET HEADER
+        Buffer[BufferSize++] = GSBP__UART_START_BYTE;
+        #if GSBP__ACTIVATE_DESTINATION_FEATURE
+        Buffer[BufferSize++] = __MakeUChar(Command->Destination);
+        #endif
+        #if GSBP__ACTIVATE_SOURCE_FEATURE
+        Buffer[BufferSize++] = __MakeUChar(Command->Source);
+        #endif
+        #if GSBP__ACTIVATE_SOURCE_DESTINATION_FEATURE
+        Buffer[BufferSize++] = //TODO
+        #endif
+        #if GSBP__ACTIVATE_16BIT_CMD_FEATURE
+        Buffer[BufferSize++] = __MakeUChar((Command->CommandID >> 8));
+        #endif
+        Buffer[BufferSize++] = __MakeUChar(P->CommandID);
+        #if GSBP__ACTIVATE_CONTROL_FEATURE
+        Buffer[BufferSize++] = __MakeUChar(Command->Control);
+        #endif
+        Buffer[BufferSize++] = __MakeUChar(RequestIdLocal);
+        #if GSBP__ACTIVATE_16BIT_PACKAGE_LENGHT_FEATURE
+        Buffer[BufferSize++] = __MakeUChar(P->DataSize);
+        #endif
+        Buffer[BufferSize++] = __MakeUChar((P->DataSize >>8));
+
+#if GSBP__USE_CHECKSUMS
+        // header checksum
+        uint8_t	ChecksumHeaderTemp;
+        ChecksumHeaderTemp = GSBP__UART_HEADER_CHECKSUM_START;
+        for(uint32_t i=1; i<BufferSize; i++){
+            ChecksumHeaderTemp ^= Buffer[i];
+            //TODO Checksumme ist nicht gut -> lieber one's sum ....
+            //http://betterembsw.blogspot.de/2010/05/which-error-detection-code-should-you.html
+        }
+        Buffer[BufferSize++] = ChecksumHeaderTemp;
+        Command->ChecksumHeader = ChecksumHeaderTemp;
+#endif
+        if (P->DataSize > 0){
+            // SET DATA
+            memcpy( &Buffer[BufferSize], P->Data, P->DataSize);
+            BufferSize += P->DataSize;
+
+#if GSBP__USE_CHECKSUMS
+            // SET Checksum Data
+            Buffer[BufferSize++] = 0x00;      // TODO Checksum
+            Buffer[BufferSize++] = 0x00;      // TODO Checksum
+            Buffer[BufferSize++] = 0x00;      // TODO Checksum
+            Buffer[BufferSize++] = 0x00;      // TODO Checksum
+#endif
+ //           Command->ChecksumData = 0x00;
+        }
+        // SET TAIL
+        Buffer[BufferSize++] = GSBP__UART_END_BYTE;
+        return BufferSize;
+    }
+
+    /*
+     * adds a package to the transmit queue and returns after it was written
+     * -> the thread, which gets TxWrite_mutex first, writes all queued packages with one writev() call
+     */
+    bool GSBP_XXX::TransmitFrame(txFrame_t* Frame)
+    {
+    	Frame->Done = false;
+    	Frame->WriteOk = false;
+    	// push the package to the queue
+    	Frame->Next = this->TxQueue.load(std::memory_order_relaxed);
+    	while (!this->TxQueue.compare_exchange_weak(Frame->Next, Frame, std::memory_order_release, std::memory_order_relaxed)){
+    		// retry
+    	}
+    	this->StatsGSBP.TxQueueDepth.fetch_add(1, std::memory_order_relaxed);
+
+    	// write the queue, if no other thread did it meanwhile
+    	boost::mutex::scoped_lock lock(this->TxWrite_mutex);
+    	if (!Frame->Done){
+    		GSBP_XXX::WriteTxQueue();
+    	}
+    	return Frame->WriteOk;
+    }
+
+    /*
+     * writes all queued packages in the order they were queued -> call with TxWrite_mutex locked
+     */
+    void GSBP_XXX::WriteTxQueue(void)
+    {
+    	// take all queued packages and restore the order
+    	txFrame_t* Queue = this->TxQueue.exchange(NULL, std::memory_order_acquire);
+    	txFrame_t* Frame = NULL;
+    	while (Queue != NULL){
+    		txFrame_t* Next = Queue->Next;
+    		Queue->Next = Frame;
+    		Frame = Queue;
+    		Queue = Next;
+    	}
+
+    	struct iovec IoVec[gsbp_TxMaxPackagesPerWrite];
+    	while (Frame != NULL){
+    		txFrame_t* FirstFrame = Frame;
+    		uint32_t NumberOfFrames = 0;
+    		uint64_t NumberOfBytes = 0;
+    		while (Frame != NULL && NumberOfFrames < gsbp_TxMaxPackagesPerWrite){
+    			IoVec[NumberOfFrames].iov_base = Frame->Buffer;
+    			IoVec[NumberOfFrames].iov_len = Frame->Size;
+    			NumberOfBytes += Frame->Size;
+    			NumberOfFrames++;
+    			Frame = Frame->Next;
+    		}
+    		GSBP_XXX::Trace(TraceWrite, 'B', 0, (uint32_t)NumberOfBytes);
+    		uint32_t FramesWritten = GSBP_XXX::WriteFrames(IoVec, NumberOfFrames);
+    		GSBP_XXX::Trace(TraceWrite, 'E', 0, FramesWritten);
+    		// the frames belong to the sending threads -> read Next before the thread can continue
+    		uint32_t i = 0;
+    		for (txFrame_t* F = FirstFrame; F != Frame; i++){
+    			txFrame_t* Next = F->Next;
+    			if (i < FramesWritten){
+    				this->StatsGSBP.NumberOfTxPackages.fetch_add(1, std::memory_order_relaxed);
+    				this->StatsGSBP.NumberOfTxBytes.fetch_add(F->Size, std::memory_order_relaxed);
+    			}
+    			// only the frames after the error failed -> the device received the frames before it
+    			F->WriteOk = (i < FramesWritten);
+    			this->StatsGSBP.TxQueueDepth.fetch_sub(1, std::memory_order_relaxed);
+    			F->Done = true;
+    			F = Next;
+    		}
+    	}
+    }
+
+    /*
+     * writes the packages with as few writev() calls as possible -> the device is opened non-blocking
+     * returns the number of frames written completely; a frame, which was started, is always completed (or the device failed)
+     * -> a half written frame would desynchronise the package decoder of the device
+     */
+    uint32_t GSBP_XXX::WriteFrames(struct iovec* IoVec, uint32_t NumberOfFrames)
+    {
+    	uint32_t FirstFrame = 0;
+    	bool     FrameStarted = false;	// some bytes of IoVec[FirstFrame] are written
+    	while (FirstFrame < NumberOfFrames){
+    		ssize_t BytesWritten = writev(this->fd, &IoVec[FirstFrame], NumberOfFrames - FirstFrame);
+    		if (BytesWritten < 0){
+    			if (errno == EINTR){
+    				continue;
+    			}
+    			if (errno == EAGAIN || errno == EWOULDBLOCK){
+    				// the output buffer is full -> wait until the device can take more data
+    				struct pollfd Poll = {this->fd, POLLOUT, 0};
+    				int Ready = poll(&Poll, 1, gsbp_PackageReadTimoutUs /1000);
+    				if (Ready > 0 && !(Poll.revents & (POLLERR | POLLHUP | POLLNVAL))){
+    					continue;
+    				}
+    				if (Ready == 0 && FrameStarted && !this->DeviceHungUp){
+    					// never leave a half written frame -> keep waiting, the device is still there
+    					continue;
+    				}
+    				if (Ready == 0){
+    					errno = EAGAIN;
+    				}
+    			}
+    			GSBP_XXX::Log(LogSiteWrite, LogError, "Can't write to %s: %s (%d)", this->DeviceFileName, strerror(errno), errno);
+    			return FirstFrame;
+    		}
+    		// wire capture -> the bytes written by this call
+    		if (this->CaptureActive.load(std::memory_order_relaxed) && BytesWritten > 0){
+    			struct iovec CaptureIoVec[gsbp_TxMaxPackagesPerWrite];
+    			uint32_t NumberOfIoVec = 0;
+    			size_t   BytesLeft = BytesWritten;
+    			for (uint32_t i=FirstFrame; i<NumberOfFrames && BytesLeft > 0; i++){
+    				CaptureIoVec[NumberOfIoVec].iov_base = IoVec[i].iov_base;
+    				CaptureIoVec[NumberOfIoVec].iov_len = std::min(BytesLeft, IoVec[i].iov_len);
+    				BytesLeft -= CaptureIoVec[NumberOfIoVec].iov_len;
+    				NumberOfIoVec++;
+    			}
+    			GSBP_XXX::CaptureData(CaptureOutbound, CaptureIoVec, NumberOfIoVec);
+    		}
+    		// skip the written data
+    		while (FirstFrame < NumberOfFrames && (size_t)BytesWritten >= IoVec[FirstFrame].iov_len){
+    			BytesWritten -= IoVec[FirstFrame].iov_len;
+    			FirstFrame++;
+    			FrameStarted = false;
+    		}
+    		if (FirstFrame < NumberOfFrames && BytesWritten > 0){
+    			IoVec[FirstFrame].iov_base = (uint8_t*)IoVec[FirstFrame].iov_base + BytesWritten;
+    			IoVec[FirstFrame].iov_len -= BytesWritten;
+    			FrameStarted = true;
+    		}
+    	}
+    	return FirstFrame;
+    }
+
+    /*
+     * starts capturing all bytes read from and written to the device into a pcapng file
+     * -> link type gsbp_CaptureLinkType (USER0), one packet per read()/writev() call, the direction is stored in epb_flags
+     * -> the device I/O only copies the bytes into a ring buffer; a writer thread writes the file
+     */
+    bool GSBP_XXX::StartCapture(const char* FileName, uint16_t* ErrorCode)
+    {
+    	*ErrorCode = NoError;
+    	boost::mutex::scoped_lock lock(this->Capture_mutex);
+    	if (this->Capture_thread != NULL){
+    		GSBP_XXX::Log(LogSiteCapture, LogError, "A capture is already running!");
+    		*ErrorCode = GSBP_CaptureFailed;
+    		return false;
+    	}
+    	this->fdCapture = open(FileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    	if (this->fdCapture < 0){
+    		GSBP_XXX::Log(LogSiteCapture, LogError, "Can't open the capture file %s: %s (%d)", FileName, strerror(errno), errno);
+    		*ErrorCode = GSBP_CaptureFailed;
+    		return false;
+    	}
+
+    	// section header and interface description
+    	uint8_t Block[512];
+    	uint32_t Size = 0, Value32;
+    	uint16_t Value16;
+    	Value32 = gsbp_PcapngSectionHeaderBlock;	memcpy(&Block[Size], &Value32, 4); Size += 8;
+    	Value32 = 0x1A2B3C4D;						memcpy(&Block[Size], &Value32, 4); Size += 4; // byte order magic
+    	Value16 = 1;								memcpy(&Block[Size], &Value16, 2); Size += 2; // version 1.0
+    	Value16 = 0;								memcpy(&Block[Size], &Value16, 2); Size += 2;
+    	int64_t SectionLength = -1;					memcpy(&Block[Size], &SectionLength, 8); Size += 8;
+    	Size += GSBP_XXX::BuildCaptureOption(&Block[Size], 4, "GSBP", 4); // shb_userappl
+    	Size += GSBP_XXX::BuildCaptureOption(&Block[Size], 0, NULL, 0);
+    	Size += 4;
+    	memcpy(&Block[4], &Size, 4);
+    	memcpy(&Block[Size -4], &Size, 4);
+    	uint32_t BlockStart = Size;
+    	Value32 = gsbp_PcapngInterfaceDescriptionBlock;	memcpy(&Block[Size], &Value32, 4); Size += 8;
+    	Value16 = gsbp_CaptureLinkType;				memcpy(&Block[Size], &Value16, 2); Size += 2;
+    	Value16 = 0;								memcpy(&Block[Size], &Value16, 2); Size += 2;
+    	Value32 = 0;								memcpy(&Block[Size], &Value32, 4); Size += 4; // no snap length
+    	Size += GSBP_XXX::BuildCaptureOption(&Block[Size], 2, this->DeviceFileName, (uint16_t)strnlen(this->DeviceFileName, sizeof(this->DeviceFileName))); // if_name
+    	uint8_t TimeResolution = 9;
+    	Size += GSBP_XXX::BuildCaptureOption(&Block[Size], 9, &TimeResolution, 1); // if_tsresol -> ns
+    	Size += GSBP_XXX::BuildCaptureOption(&Block[Size], 0, NULL, 0);
+    	Size += 4;
+    	Value32 = Size -BlockStart;
+    	memcpy(&Block[BlockStart +4], &Value32, 4);
+    	memcpy(&Block[Size -4], &Value32, 4);
+    	if (!GSBP_XXX::WriteCaptureFile(Block, Size)){
+    		close(this->fdCapture);
+    		this->fdCapture = -1;
+    		*ErrorCode = GSBP_CaptureFailed;
+    		return false;
+    	}
+
+    	// the timestamps are taken from the monotonic clock and shifted to the wall clock time at the start of the capture
+    	struct timespec Monotonic, Realtime;
+    	clock_gettime(CLOCK_MONOTONIC, &Monotonic);
+    	clock_gettime(CLOCK_REALTIME, &Realtime);
+    	this->CaptureClockOffsetNs = ((int64_t)Realtime.tv_sec - Monotonic.tv_sec) *1000000000 + (Realtime.tv_nsec - Monotonic.tv_nsec);
+
+    	for (uint32_t i=0; i<2; i++){
+    		this->CaptureRing[i].Buffer = new uint8_t[gsbp_CaptureRingSize];
+    		this->CaptureRing[i].Head = 0;
+    		this->CaptureRing[i].Tail = 0;
+    		this->CaptureRing[i].ChunksCaptured = 0;
+    		this->CaptureRing[i].BytesCaptured = 0;
+    		this->CaptureRing[i].ChunksDropped = 0;
+    	}
+    	this->RunCaptureThread = true;
+    	this->Capture_thread = new boost::thread(&GSBP_XXX::CaptureWriter, this);
+    	this->CaptureActive = true;
+    	return true;
+    }
+
+    /*
+     * stops the capture, writes the remaining bytes and closes the capture file; Statistics can be NULL
+     */
+    bool GSBP_XXX::StopCapture(captureStatistics_t* Statistics, uint16_t* ErrorCode)
+    {
+    	*ErrorCode = NoError;
+    	boost::mutex::scoped_lock lock(this->Capture_mutex);
+    	if (this->Capture_thread == NULL){
+    		*ErrorCode = GSBP_CaptureFailed;
+    		return false;
+    	}
+    	// no new chunks -> wait for the producers, which are still copying into the rings
+    	this->CaptureActive = false;
+    	while (this->CaptureUsers.load() > 0){
+    		boost::this_thread::yield();
+    	}
+    	this->RunCaptureThread = false;
+    	this->Capture_thread->join();
+    	delete this->Capture_thread;
+    	this->Capture_thread = NULL;
+
+    	captureStatistics_t Stats = {0, 0, 0};
+    	for (uint32_t i=0; i<2; i++){
+    		Stats.ChunksCaptured += this->CaptureRing[i].ChunksCaptured;
+    		Stats.BytesCaptured  += this->CaptureRing[i].BytesCaptured;
+    		Stats.ChunksDropped  += this->CaptureRing[i].ChunksDropped.load();
+    		delete[] this->CaptureRing[i].Buffer;
+    		this->CaptureRing[i].Buffer = NULL;
+    	}
+
+    	// interface statistics -> received (captured + dropped) and dropped chunks
+    	uint8_t Block[128];
+    	uint32_t Size = 0, Value32;
+    	struct timespec Now;
+    	clock_gettime(CLOCK_MONOTONIC, &Now);
+    	int64_t TimestampNs = (int64_t)Now.tv_sec *1000000000 + Now.tv_nsec + this->CaptureClockOffsetNs;
+    	Value32 = gsbp_PcapngInterfaceStatisticsBlock;	memcpy(&Block[Size], &Value32, 4); Size += 8;
+    	Value32 = 0;								memcpy(&Block[Size], &Value32, 4); Size += 4; // interface
+    	Value32 = (uint32_t)(TimestampNs >> 32);	memcpy(&Block[Size], &Value32, 4); Size += 4;
+    	Value32 = (uint32_t)TimestampNs;			memcpy(&Block[Size], &Value32, 4); Size += 4;
+    	uint64_t Received = Stats.ChunksCaptured + Stats.ChunksDropped;
+    	Size += GSBP_XXX::BuildCaptureOption(&Block[Size], 4, &Received, 8); // isb_ifrecv
+    	Size += GSBP_XXX::BuildCaptureOption(&Block[Size], 5, &Stats.ChunksDropped, 8); // isb_ifdrop
+    	Size += GSBP_XXX::BuildCaptureOption(&Block[Size], 0, NULL, 0);
+    	Size += 4;
+    	memcpy(&Block[4], &Size, 4);
+    	memcpy(&Block[Size -4], &Size, 4);
+    	bool WriteOk = GSBP_XXX::WriteCaptureFile(Block, Size);
+    	if (close(this->fdCapture) != 0){
+    		GSBP_XXX::Log(LogSiteCapture, LogError, "Can't close the capture file: %s (%d)", strerror(errno), errno);
+    		WriteOk = false;
+    	}
+    	this->fdCapture = -1;
+
+    	if (Statistics != NULL){
+    		*Statistics = Stats;
+    	}
+    	if (!WriteOk){
+    		*ErrorCode = GSBP_CaptureFailed;
+    	}
+    	return WriteOk;
+    }
+
+    /*
+     * copies a chunk of bytes read from/written to the device into the capture ring -> never waits, drops the chunk if it does not fit
+     * -> one producer per direction: the receiver (inbound) and the thread holding TxWrite_mutex (outbound)
+     */
+    void GSBP_XXX::CaptureData(captureDirection_t Direction, const struct iovec* IoVec, uint32_t NumberOfIoVec)
+    {
+    	this->CaptureUsers.fetch_add(1);
+    	if (this->CaptureActive.load()){
+    		captureRing_t* Ring = &this->CaptureRing[Direction];
+    		struct timespec Now;
+    		clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    		uint32_t DataSize = 0;
+    		for (uint32_t i=0; i<NumberOfIoVec; i++){
+    			DataSize += IoVec[i].iov_len;
+    		}
+    		uint32_t RecordSize = (sizeof(captureRecordHeader_t) + DataSize + 15) & ~15u;
+    		uint64_t Head = Ring->Head.load(std::memory_order_relaxed);
+    		uint32_t Index = Head & (gsbp_CaptureRingSize -1);
+    		uint32_t Skip = (gsbp_CaptureRingSize - Index < RecordSize) ? gsbp_CaptureRingSize - Index : 0;
+    		if (Head + Skip + RecordSize - Ring->Tail.load(std::memory_order_acquire) > gsbp_CaptureRingSize){
+    			Ring->ChunksDropped.fetch_add(1, std::memory_order_relaxed);
+    		} else {
+    			captureRecordHeader_t* Record = (captureRecordHeader_t*)&Ring->Buffer[Index];
+    			if (Skip > 0){
+    				// the record does not fit at the end of the ring -> continue at the beginning
+    				Record->Size = gsbp_CaptureWrapMarker;
+    				Record = (captureRecordHeader_t*)&Ring->Buffer[0];
+    			}
+    			Record->TimestampNs = (int64_t)Now.tv_sec *1000000000 + Now.tv_nsec;
+    			Record->Size = DataSize;
+    			uint8_t* Data = (uint8_t*)(Record +1);
+    			for (uint32_t i=0; i<NumberOfIoVec; i++){
+    				memcpy(Data, IoVec[i].iov_base, IoVec[i].iov_len);
+    				Data += IoVec[i].iov_len;
+    			}
+    			Ring->ChunksCaptured++;
+    			Ring->BytesCaptured += DataSize;
+    			Ring->Head.store(Head + Skip + RecordSize, std::memory_order_release);
+    		}
+    	}
+    	this->CaptureUsers.fetch_sub(1);
+    }
+
+    /*
+     * capture writer thread -> takes the records of both rings in timestamp order and writes them as pcapng packets
+     */
+    void GSBP_XXX::CaptureWriter(void)
+    {
+    	std::vector<uint8_t> WriteBuffer(gsbp_CaptureWriteBufferSize);
+    	uint32_t WriteSize = 0;
+    	bool WriteOk = true;
+
+    	while (true){
+    		bool Running = this->RunCaptureThread.load();
+    		bool Idle = true;
+    		while (true){
+    			// the oldest record of both rings
+    			captureRecordHeader_t* Next = NULL;
+    			uint32_t Direction = 0;
+    			for (uint32_t i=0; i<2; i++){
+    				captureRing_t* Ring = &this->CaptureRing[i];
+    				uint64_t Tail = Ring->Tail.load(std::memory_order_relaxed);
+    				if (Tail == Ring->Head.load(std::memory_order_acquire)){
+    					continue;
+    				}
+    				captureRecordHeader_t* Record = (captureRecordHeader_t*)&Ring->Buffer[Tail & (gsbp_CaptureRingSize -1)];
+    				if (Record->Size == gsbp_CaptureWrapMarker){
+    					Tail += gsbp_CaptureRingSize - (Tail & (gsbp_CaptureRingSize -1));
+    					Ring->Tail.store(Tail, std::memory_order_release);
+    					Record = (captureRecordHeader_t*)&Ring->Buffer[0];
+    				}
+    				if (Next == NULL || Record->TimestampNs < Next->TimestampNs){
+    					Next = Record;
+    					Direction = i;
+    				}
+    			}
+    			if (Next == NULL){
+    				break;
+    			}
+    			Idle = false;
+
+    			// pcapng packet -> write the collected packets first, if it does not fit
+    			uint32_t BlockSize = 28 + ((Next->Size + 3) & ~3u) + 16;
+    			if (WriteSize + BlockSize > WriteBuffer.size()){
+    				if (WriteOk && WriteSize > 0){
+    					WriteOk = GSBP_XXX::WriteCaptureFile(WriteBuffer.data(), WriteSize);
+    				}
+    				WriteSize = 0;
+    				if (BlockSize > WriteBuffer.size()){
+    					WriteBuffer.resize(BlockSize);
+    				}
+    			}
+    			WriteSize += GSBP_XXX::BuildCaptureBlock(&WriteBuffer[WriteSize], (captureDirection_t)Direction,
+    					Next->TimestampNs + this->CaptureClockOffsetNs, (uint8_t*)(Next +1), Next->Size);
+
+    			captureRing_t* Ring = &this->CaptureRing[Direction];
+    			Ring->Tail.store(Ring->Tail.load(std::memory_order_relaxed) + ((sizeof(captureRecordHeader_t) + Next->Size + 15) & ~15u), std::memory_order_release);
+    		}
+
+    		if (WriteSize > 0 && (Idle || !Running)){
+    			if (WriteOk){
+    				WriteOk = GSBP_XXX::WriteCaptureFile(WriteBuffer.data(), WriteSize);
+    			}
+    			WriteSize = 0;
+    		}
+    		// stop only after the rings were emptied
+    		if (!Running){
+    			break;
+    		}
+    		if (Idle){
+    			boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    		}
+    	}
+    }
+
+    /*
+     * builds a pcapng enhanced packet block -> returns the block size
+     */
+    uint32_t GSBP_XXX::BuildCaptureBlock(uint8_t* Buffer, captureDirection_t Direction, int64_t TimestampNs, const uint8_t* Data, uint32_t DataSize)
+    {
+    	uint32_t Size = 0, Value32;
+    	Value32 = gsbp_PcapngEnhancedPacketBlock;	memcpy(&Buffer[Size], &Value32, 4); Size += 8;
+    	Value32 = 0;								memcpy(&Buffer[Size], &Value32, 4); Size += 4; // interface
+    	Value32 = (uint32_t)((uint64_t)TimestampNs >> 32);	memcpy(&Buffer[Size], &Value32, 4); Size += 4;
+    	Value32 = (uint32_t)TimestampNs;			memcpy(&Buffer[Size], &Value32, 4); Size += 4;
+    	memcpy(&Buffer[Size], &DataSize, 4); Size += 4;	// captured length
+    	memcpy(&Buffer[Size], &DataSize, 4); Size += 4;	// original length
+    	memcpy(&Buffer[Size], Data, DataSize);
+    	memset(&Buffer[Size + DataSize], 0, ((DataSize + 3) & ~3u) - DataSize);
+    	Size += (DataSize + 3) & ~3u;
+    	Value32 = (Direction == CaptureInbound) ? 1 : 2;	// epb_flags -> inbound/outbound
+    	Size += GSBP_XXX::BuildCaptureOption(&Buffer[Size], 2, &Value32, 4);
+    	Size += GSBP_XXX::BuildCaptureOption(&Buffer[Size], 0, NULL, 0);
+    	Size += 4;
+    	memcpy(&Buffer[4], &Size, 4);
+    	memcpy(&Buffer[Size -4], &Size, 4);
+    	return Size;
+    }
+
+    /*
+     * builds a pcapng option (code, length, value padded to 32 bit) -> returns the option size
+     */
+    uint32_t GSBP_XXX::BuildCaptureOption(uint8_t* Buffer, uint16_t Code, const void* Value, uint16_t Length)
+    {
+    	memcpy(&Buffer[0], &Code, 2);
+    	memcpy(&Buffer[2], &Length, 2);
+    	if (Length > 0){
+    		memcpy(&Buffer[4], Value, Length);
+    		memset(&Buffer[4 + Length], 0, ((Length + 3) & ~3u) - Length);
+    	}
+    	return 4 + ((Length + 3) & ~3u);
+    }
+
+    bool GSBP_XXX::WriteCaptureFile(const uint8_t* Data, uint32_t Size)
+    {
+    	while (Size > 0){
+    		ssize_t BytesWritten = write(this->fdCapture, Data, Size);
+    		if (BytesWritten < 0){
+    			if (errno == EINTR){
+    				continue;
+    			}
+    			GSBP_XXX::Log(LogSiteCapture, LogError, "Can't write the capture file: %s (%d)", strerror(errno), errno);
+    			return false;
+    		}
+    		Data += BytesWritten;
+    		Size -= BytesWritten;
+    	}
+    	return true;
+    }
+
+    /*
+     * replays a capture through the receive path (decoder -> AddResponse -> package handlers) without a device
+     * -> pcapng files written by StartCapture(): only the inbound packets are replayed; any other file is replayed as raw received bytes
+     * -> RealTime: the packets are fed with the timing of the capture; otherwise as fast as possible
+     * -> only while not connected to a device; the handler threads are started for the replay; Statistics can be NULL
+     */
+    bool GSBP_XXX::ReplayCapture(const char* FileName, bool RealTime, replayStatistics_t* Statistics, uint16_t* ErrorCode)
+    {
+    	*ErrorCode = NoError;
+    	if (this->DeviceConnected){
+    		GSBP_XXX::Log(LogSiteCapture, LogError, "Can't replay a capture while connected to a device!");
+    		*ErrorCode = GSBP_ReplayFailed;
+    		return false;
+    	}
+    	int fdReplay = open(FileName, O_RDONLY);
+    	if (fdReplay < 0){
+    		GSBP_XXX::Log(LogSiteCapture, LogError, "Can't open the capture file %s: %s (%d)", FileName, strerror(errno), errno);
+    		*ErrorCode = GSBP_ReplayFailed;
+    		return false;
+    	}
+    	struct stat FileStat;
+    	if (fstat(fdReplay, &FileStat) != 0 || FileStat.st_size == 0){
+    		GSBP_XXX::Log(LogSiteCapture, LogError, "The capture file %s is empty or can't be read!", FileName);
+    		close(fdReplay);
+    		*ErrorCode = GSBP_ReplayFailed;
+    		return false;
+    	}
+    	size_t FileSize = (size_t)FileStat.st_size;
+    	const uint8_t* File = (const uint8_t*)mmap(NULL, FileSize, PROT_READ, MAP_PRIVATE, fdReplay, 0);
+    	close(fdReplay);
+    	if (File == MAP_FAILED){
+    		GSBP_XXX::Log(LogSiteCapture, LogError, "Can't map the capture file %s: %s (%d)", FileName, strerror(errno), errno);
+    		*ErrorCode = GSBP_ReplayFailed;
+    		return false;
+    	}
+    	madvise((void*)File, FileSize, MADV_SEQUENTIAL);
+
+    	replayStatistics_t Stats = {0, 0, 0, 0.0, 0.0, 0.0};
+    	bool ReplayOk = true;
+    	uint32_t Value32;
+    	memcpy(&Value32, File, (FileSize >= 4) ? 4 : 0);
+    	bool IsPcapng = (FileSize >= 12 && Value32 == gsbp_PcapngSectionHeaderBlock);
+
+    	GSBP_XXX::StartHandlerWorkers();
+    	measuredLock_t lock(this->ReadPackage_mutex, this->ReadPackageLockStats);
+    	GSBP_XXX::ResetRxDecoder(false);
+    	boost::posix_time::ptime StartTime = boost::posix_time::microsec_clock::universal_time();
+
+    	if (IsPcapng){
+    		double   NsPerTick = 1000.0;			// if_tsresol default -> us
+    		bool     FirstPacket = true;
+    		uint64_t FirstTimestamp = 0;
+    		size_t   Offset = 0;
+    		while (Offset + 12 <= FileSize){
+    			uint32_t BlockType, BlockSize;
+    			memcpy(&BlockType, &File[Offset], 4);
+    			memcpy(&BlockSize, &File[Offset +4], 4);
+    			if (BlockSize < 12 || (BlockSize & 3) != 0 || Offset + BlockSize > FileSize){
+    				// truncated capture (e.g. not stopped) -> replay what we have
+    				GSBP_XXX::Log(LogSiteCapture, LogWarning, "Capture file %s is truncated or broken at offset %zu!", FileName, Offset);
+    				break;
+    			}
+    			const uint8_t* Block = &File[Offset];
+    			Offset += BlockSize;
+
+    			if (BlockType == gsbp_PcapngSectionHeaderBlock){
+    				memcpy(&Value32, &Block[8], 4);
+    				if (Value32 != 0x1A2B3C4D){
+    					GSBP_XXX::Log(LogSiteCapture, LogError, "Capture file %s has a different byte order!", FileName);
+    					ReplayOk = false;
+    					break;
+    				}
+    			} else if (BlockType == gsbp_PcapngInterfaceDescriptionBlock && BlockSize >= 20){
+    				uint16_t LinkType;
+    				memcpy(&LinkType, &Block[8], 2);
+    				if (LinkType != gsbp_CaptureLinkType){
+    					GSBP_XXX::Log(LogSiteCapture, LogWarning, "Capture file %s has the link type %u -> the packets are replayed as GSBP bytes", FileName, LinkType);
+    				}
+    				// look for if_tsresol
+    				uint32_t OptionOffset = 16;
+    				while (OptionOffset + 4 <= BlockSize -4){
+    					uint16_t Code, Length;
+    					memcpy(&Code, &Block[OptionOffset], 2);
+    					memcpy(&Length, &Block[OptionOffset +2], 2);
+    					if (Code == 0 || OptionOffset + 4 + Length > BlockSize -4){
+    						break;
+    					}
+    					if (Code == 9 && Length == 1){
+    						uint8_t Resolution = Block[OptionOffset +4];
+    						NsPerTick = (Resolution & 0x80) ? 1e9 / (double)(1ull << (Resolution & 0x3F)) : 1e9 / pow(10.0, Resolution);
+    					}
+    					OptionOffset += 4 + ((Length + 3) & ~3u);
+    				}
+    			} else if (BlockType == gsbp_PcapngEnhancedPacketBlock && BlockSize >= 32){
+    				uint32_t TimestampHigh, TimestampLow, DataSize;
+    				memcpy(&TimestampHigh, &Block[12], 4);
+    				memcpy(&TimestampLow, &Block[16], 4);
+    				memcpy(&DataSize, &Block[20], 4);
+    				if (28 + ((DataSize + 3) & ~3u) + 4 > BlockSize){
+    					continue;
+    				}
+    				// direction -> epb_flags; packets without the flag are counted as received
+    				uint32_t Flags = 1;
+    				uint32_t OptionOffset = 28 + ((DataSize + 3) & ~3u);
+    				while (OptionOffset + 4 <= BlockSize -4){
+    					uint16_t Code, Length;
+    					memcpy(&Code, &Block[OptionOffset], 2);
+    					memcpy(&Length, &Block[OptionOffset +2], 2);
+    					if (Code == 0 || OptionOffset + 4 + Length > BlockSize -4){
+    						break;
+    					}
+    					if (Code == 2 && Length == 4){
+    						memcpy(&Flags, &Block[OptionOffset +4], 4);
+    					}
+    					OptionOffset += 4 + ((Length + 3) & ~3u);
+    				}
+    				if ((Flags & 0x3) == 2){
+    					continue;
+    				}
+    				// keep the timing of the capture -> relative to the first packet
+    				uint64_t Timestamp = ((uint64_t)TimestampHigh << 32) | TimestampLow;
+    				if (FirstPacket){
+    					FirstTimestamp = Timestamp;
+    					FirstPacket = false;
+    				}
+    				if (RealTime){
+    					boost::posix_time::ptime PacketTime = StartTime + boost::posix_time::microseconds((int64_t)((double)(Timestamp - FirstTimestamp) * NsPerTick / 1000.0));
+    					boost::posix_time::time_duration Wait = PacketTime - boost::posix_time::microsec_clock::universal_time();
+    					if (Wait.is_positive()){
+    						boost::this_thread::sleep(Wait);
+    					}
+    				}
+    				Stats.PackagesDecoded += GSBP_XXX::DecodeRxChunk(&Block[28], DataSize);
+    				Stats.ChunksReplayed++;
+    				Stats.BytesReplayed += DataSize;
+    			}
+    			// other blocks (e.g. interface statistics) are skipped
+    		}
+    	} else {
+    		// raw bytes -> fed in chunks of the size the receiver reads
+    		for (size_t Offset = 0; Offset < FileSize; Offset += sizeof(this->RxChunk)){
+    			uint32_t ChunkSize = (FileSize - Offset > sizeof(this->RxChunk)) ? sizeof(this->RxChunk) : (uint32_t)(FileSize - Offset);
+    			Stats.PackagesDecoded += GSBP_XXX::DecodeRxChunk(&File[Offset], ChunkSize);
+    			Stats.ChunksReplayed++;
+    			Stats.BytesReplayed += ChunkSize;
+    		}
+    	}
+    	// end of the capture -> same as a receive timeout; an incomplete package is build as broken package
+    	if (this->RxDecoder.Head != this->RxDecoder.Tail){
+    		GSBP_XXX::ResetRxDecoder(true);
+    	}
+    	lock.unlock();
+    	// the queued packages are handled before the handler threads stop
+    	GSBP_XXX::StopHandlerWorkers();
+    	munmap((void*)File, FileSize);
+
+    	Stats.Seconds = (double)(boost::posix_time::microsec_clock::universal_time() - StartTime).total_microseconds() / 1e6;
+    	if (Stats.Seconds > 0.0){
+    		Stats.PackagesPerSecond  = (double)Stats.PackagesDecoded / Stats.Seconds;
+    		Stats.MegaBytesPerSecond = (double)Stats.BytesReplayed / Stats.Seconds / 1e6;
+    	}
+    	if (Statistics != NULL){
+    		*Statistics = Stats;
+    	}
+    	if (!ReplayOk){
+    		*ErrorCode = GSBP_ReplayFailed;
+    	}
+    	return ReplayOk;
+    }
+
+    /*
+     * measures the wait and hold times of RequestResponseLock_mutex and ReadPackage_mutex
+     * -> disabled, every lock costs one additional atomic load; enabled, two clock reads
+     */
+    void GSBP_XXX::EnableLockStatistics(bool Enable)
+    {
+    	this->RequestResponseLockStats.Enabled = Enable;
+    	this->ReadPackageLockStats.Enabled = Enable;
+    }
+
+    void GSBP_XXX::GetLockStatistics(lockStatistics_t* RequestResponseLock, lockStatistics_t* ReadPackageLock, bool Reset)
+    {
+    	lockCounter_t* Counters[2] = {&this->RequestResponseLockStats, &this->ReadPackageLockStats};
+    	lockStatistics_t* Statistics[2] = {RequestResponseLock, ReadPackageLock};
+    	for (uint32_t i=0; i<2; i++){
+    		lockCounter_t* C = Counters[i];
+    		if (Statistics[i] != NULL){
+    			Statistics[i]->Acquisitions = C->Acquisitions.load();
+    			Statistics[i]->Contended = C->Contended.load();
+    			Statistics[i]->WaitNs = C->WaitNs.load();
+    			Statistics[i]->WaitNsMax = C->WaitNsMax.load();
+    			Statistics[i]->HoldNs = C->HoldNs.load();
+    			Statistics[i]->HoldNsMax = C->HoldNsMax.load();
+    		}
+    		if (Reset){
+    			C->Acquisitions = 0;
+    			C->Contended = 0;
+    			C->WaitNs = 0;
+    			C->WaitNsMax = 0;
+    			C->HoldNs = 0;
+    			C->HoldNsMax = 0;
+    		}
+    	}
+    }
+
+    GSBP_XXX::measuredLock_t::measuredLock_t(boost::mutex& Mutex, lockCounter_t& Counter)
+      : boost::unique_lock<boost::mutex>(Mutex, boost::defer_lock), Counter(Counter), LockedAt(0)
+    {
+    	measuredLock_t::lock();
+    }
+
+    GSBP_XXX::measuredLock_t::measuredLock_t(boost::mutex& Mutex, lockCounter_t& Counter, boost::defer_lock_t)
+      : boost::unique_lock<boost::mutex>(Mutex, boost::defer_lock), Counter(Counter), LockedAt(0)
+    {
+    }
+
+    GSBP_XXX::measuredLock_t::~measuredLock_t(void)
+    {
+    	if (this->owns_lock()){
+    		measuredLock_t::unlock();
+    	}
+    }
+
+    void GSBP_XXX::measuredLock_t::lock(void)
+    {
+    	if (!this->Counter.Enabled.load(std::memory_order_relaxed)){
+    		boost::unique_lock<boost::mutex>::lock();
+    		this->LockedAt = 0;
+    		return;
+    	}
+    	if (boost::unique_lock<boost::mutex>::try_lock()){
+    		this->LockedAt = GSBP_XXX::GetMonotonicTimeNs();
+    	} else {
+    		// another thread holds the lock
+    		uint64_t WaitStart = GSBP_XXX::GetMonotonicTimeNs();
+    		boost::unique_lock<boost::mutex>::lock();
+    		this->LockedAt = GSBP_XXX::GetMonotonicTimeNs();
+    		uint64_t WaitNs = this->LockedAt - WaitStart;
+    		this->Counter.Contended.fetch_add(1, std::memory_order_relaxed);
+    		this->Counter.WaitNs.fetch_add(WaitNs, std::memory_order_relaxed);
+    		UpdateMaximum(this->Counter.WaitNsMax, WaitNs);
+    	}
+    	this->Counter.Acquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void GSBP_XXX::measuredLock_t::unlock(void)
+    {
+    	measuredLock_t::AddHoldTime();
+    	boost::unique_lock<boost::mutex>::unlock();
+    }
+
+    void GSBP_XXX::measuredLock_t::AddHoldTime(void)
+    {
+    	if (this->LockedAt != 0){
+    		uint64_t HoldNs = GSBP_XXX::GetMonotonicTimeNs() - this->LockedAt;
+    		this->Counter.HoldNs.fetch_add(HoldNs, std::memory_order_relaxed);
+    		UpdateMaximum(this->Counter.HoldNsMax, HoldNs);
+    		this->LockedAt = 0;
+    	}
+    }
+
+    uint64_t GSBP_XXX::GetMonotonicTimeNs(void)
+    {
+    	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /*
+     * round-trip latency histograms -> recorded by AddResponse for the first response of every request
+     */
+    uint32_t GSBP_XXX::GetLatencyBucket(uint64_t LatencyNs)
+    {
+    	const uint64_t SubBuckets = 1ULL << gsbp_LatencySubBucketBits;
+    	if (LatencyNs < SubBuckets){
+    		return (uint32_t)LatencyNs;
+    	}
+    	uint32_t Exponent = 63 - __builtin_clzll(LatencyNs);
+    	if (Exponent > gsbp_LatencyMaxExponent){
+    		return gsbp_LatencyBuckets -1;
+    	}
+    	uint32_t SubBucket = (uint32_t)((LatencyNs >> (Exponent - gsbp_LatencySubBucketBits)) - SubBuckets);
+    	return (Exponent - gsbp_LatencySubBucketBits +1) *SubBuckets + SubBucket;
+    }
+
+    // the largest latency counted in the bucket
+    uint64_t GSBP_XXX::GetLatencyBucketValue(uint32_t Bucket)
+    {
+    	const uint64_t SubBuckets = 1ULL << gsbp_LatencySubBucketBits;
+    	if (Bucket < SubBuckets){
+    		return Bucket;
+    	}
+    	uint32_t Exponent = Bucket /SubBuckets + gsbp_LatencySubBucketBits -1;
+    	uint64_t SubBucket = Bucket % SubBuckets;
+    	return ((SubBuckets + SubBucket +1) << (Exponent - gsbp_LatencySubBucketBits)) -1;
+    }
+
+    /*
+     * -> call with RequestResponseLock_mutex locked (the histogram of a CMD ID is allocated once)
+     */
+    void GSBP_XXX::RecordLatency(uint16_t CommandID, uint64_t LatencyNs)
+    {
+    	if (CommandID >= gsbp_CommandIdTableSize){
+    		return;
+    	}
+    	latencyHistogram_t* H = this->LatencyHistograms[CommandID].load(std::memory_order_acquire);
+    	if (H == NULL){
+    		H = new latencyHistogram_t();
+    		H->Count = 0;
+    		H->SumNs = 0;
+    		H->MinNs = UINT64_MAX;
+    		H->MaxNs = 0;
+    		for (uint32_t i=0; i<gsbp_LatencyBuckets; i++){
+    			H->Buckets[i] = 0;
+    		}
+    		this->LatencyHistograms[CommandID].store(H, std::memory_order_release);
+    	}
+    	H->Buckets[GSBP_XXX::GetLatencyBucket(LatencyNs)].fetch_add(1, std::memory_order_relaxed);
+    	H->Count.fetch_add(1, std::memory_order_relaxed);
+    	H->SumNs.fetch_add(LatencyNs, std::memory_order_relaxed);
+    	if (LatencyNs < H->MinNs.load(std::memory_order_relaxed)){
+    		H->MinNs.store(LatencyNs, std::memory_order_relaxed);
+    	}
+    	if (LatencyNs > H->MaxNs.load(std::memory_order_relaxed)){
+    		H->MaxNs.store(LatencyNs, std::memory_order_relaxed);
+    	}
+    }
+
+    /*
+     * round-trip latency of a CMD ID -> returns false if no response to this command was received yet
+     * -> works without a lock; the snapshot can miss the responses received meanwhile
+     */
+    bool GSBP_XXX::GetLatencySnapshot(uint16_t CommandID, latencySnapshot_t* Snapshot)
+    {
+    	*Snapshot = latencySnapshot_t();
+    	Snapshot->CommandID = CommandID;
+    	if (CommandID >= gsbp_CommandIdTableSize){
+    		return false;
+    	}
+    	latencyHistogram_t* H = this->LatencyHistograms[CommandID].load(std::memory_order_acquire);
+    	if (H == NULL){
+    		return false;
+    	}
+    	std::vector<uint64_t> Buckets(gsbp_LatencyBuckets);
+    	uint64_t Count = 0;
+    	for (uint32_t i=0; i<gsbp_LatencyBuckets; i++){
+    		Buckets[i] = H->Buckets[i].load(std::memory_order_relaxed);
+    		Count += Buckets[i];
+    	}
+    	if (Count == 0){
+    		return false;
+    	}
+    	Snapshot->Count = Count;
+    	Snapshot->MinNs = H->MinNs.load(std::memory_order_relaxed);
+    	Snapshot->MaxNs = H->MaxNs.load(std::memory_order_relaxed);
+    	Snapshot->MeanNs = (double)H->SumNs.load(std::memory_order_relaxed) /H->Count.load(std::memory_order_relaxed);
+    	const double Percentiles[4] = {0.5, 0.9, 0.99, 0.999};
+    	uint64_t* Results[4] = {&Snapshot->P50Ns, &Snapshot->P90Ns, &Snapshot->P99Ns, &Snapshot->P999Ns};
+    	uint64_t Sum = 0;
+    	uint32_t p = 0;
+    	for (uint32_t i=0; i<gsbp_LatencyBuckets && p<4; i++){
+    		Sum += Buckets[i];
+    		while (p < 4 && Sum >= (uint64_t)ceil(Percentiles[p] *Count)){
+    			// not above the maximum, as the bucket can be wider than the measured values
+    			*Results[p] = std::min(GSBP_XXX::GetLatencyBucketValue(i), Snapshot->MaxNs);
+    			p++;
+    		}
+    	}
+    	return true;
+    }
+
+    /*
+     * the round-trip latency of all CMD IDs, to which a response was received
+     */
+    std::vector<GSBP_XXX::latencySnapshot_t> GSBP_XXX::GetLatencySnapshots(void)
+    {
+    	std::vector<latencySnapshot_t> Snapshots;
+    	latencySnapshot_t Snapshot;
+    	for (uint32_t i=0; i<gsbp_CommandIdTableSize; i++){
+    		if (GSBP_XXX::GetLatencySnapshot((uint16_t)i, &Snapshot)){
+    			Snapshots.push_back(Snapshot);
+    		}
+    	}
+    	return Snapshots;
+    }
+
+    void GSBP_XXX::ResetLatencyHistograms(void)
+    {
+    	measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
+    	for (uint32_t i=0; i<gsbp_CommandIdTableSize; i++){
+    		latencyHistogram_t* H = this->LatencyHistograms[i].load(std::memory_order_relaxed);
+    		if (H != NULL){
+    			H->Count = 0;
+    			H->SumNs = 0;
+    			H->MinNs = UINT64_MAX;
+    			H->MaxNs = 0;
+    			for (uint32_t b=0; b<gsbp_LatencyBuckets; b++){
+    				H->Buckets[b] = 0;
+    			}
+    		}
+    	}
+    }
+
+    /*
+     * counters and gauges of the interface -> the counters are read without a lock,
+     * the gauges of the request/response buffer with RequestResponseLock_mutex locked
+     */
+    void GSBP_XXX::GetMetrics(metrics_t* Metrics)
+    {
+    	*Metrics = metrics_t();
+    	Metrics->UptimeSeconds = (boost::posix_time::microsec_clock::local_time() - this->StatsGSBP.StartTime).total_microseconds() /1e6;
+    	Metrics->RxPackages                = this->StatsGSBP.NumberOfRxPackages.load(std::memory_order_relaxed);
+    	Metrics->RxBytes                   = this->StatsGSBP.NumberOfRxBytes.load(std::memory_order_relaxed);
+    	Metrics->RxPackagesMissing         = this->StatsGSBP.NumberOfRxPackages_Missing.load(std::memory_order_relaxed);
+    	Metrics->RxPackagesBrokenChecksum  = this->StatsGSBP.NumberOfRxPackages_BrokenChecksum.load(std::memory_order_relaxed);
+    	Metrics->RxPackagesBrokenStructure = this->StatsGSBP.NumberOfRxPackages_BrokenStructur.load(std::memory_order_relaxed);
+    	Metrics->RxBytesDiscarded          = this->StatsGSBP.BytesDiscarded.load(std::memory_order_relaxed);
+    	Metrics->TxPackages                = this->StatsGSBP.NumberOfTxPackages.load(std::memory_order_relaxed);
+    	Metrics->TxBytes                   = this->StatsGSBP.NumberOfTxBytes.load(std::memory_order_relaxed);
+    	Metrics->HandlerCalls              = this->StatsGSBP.HandlerCalls.load(std::memory_order_relaxed);
+    	Metrics->HandlerTimeNs             = this->StatsGSBP.HandlerTimeNs.load(std::memory_order_relaxed);
+    	Metrics->HandlerTimeNsMax          = this->StatsGSBP.HandlerTimeNsMax.load(std::memory_order_relaxed);
+    	Metrics->HandlerQueueFull          = this->StatsGSBP.HandlerQueueFull.load(std::memory_order_relaxed);
+    	Metrics->HandlerQueueDepth         = this->StatsGSBP.HandlerQueueDepth.load(std::memory_order_relaxed);
+    	Metrics->TxQueueDepth              = this->StatsGSBP.TxQueueDepth.load(std::memory_order_relaxed);
+    	Metrics->RxRingLevel               = this->StatsGSBP.RxRingLevel.load(std::memory_order_relaxed);
+    	Metrics->LogBacklog                = (uint32_t)(this->LogHead.load(std::memory_order_relaxed) - this->LogTail.load(std::memory_order_relaxed));
+    	Metrics->AsyncRequests             = this->NumberOfAsyncRequests.load(std::memory_order_relaxed);
+
+    	measuredLock_t lock(this->RequestResponseLock_mutex, this->RequestResponseLockStats);
+    	for (uint32_t i=0; i<gsbp_RequestTableSize; i++){
+    		RequestResponse_t* Request = &this->RequestTable[i];
+    		if (Request->RequestIdLocal != 0 && !Request->ResponseReceived && !Request->WaitTimedOut){
+    			Metrics->RequestsInFlight++;
+    		}
+    	}
+    	Metrics->UnclaimedRequestResponces = this->UnclaimedRequestResponces;
+    	Metrics->DuplicateResponses = (uint32_t)this->DuplicateResponseBuffer.size();
+    }
+
+    /*
+     * the metrics in the Prometheus text format (version 0.0.4); the labels identify the interface by its ID
+     */
+    std::string GSBP_XXX::GetMetricsText(void)
+    {
+    	metrics_t M;
+    	GSBP_XXX::GetMetrics(&M);
+    	std::ostringstream T;
+    	std::string Label = std::string("device=\"") + this->ID + "\"";
+    	auto Header = [&](const char* Name, const char* Type, const char* Help){
+    		T << "# HELP gsbp_" << Name << " " << Help << "\n";
+    		T << "# TYPE gsbp_" << Name << " " << Type << "\n";
+    	};
+    	auto Sample = [&](const char* Name, const char* Labels, double Value){
+    		T << "gsbp_" << Name << "{" << Label << Labels << "} " << Value << "\n";
+    	};
+    	auto Metric = [&](const char* Name, const char* Type, const char* Help, double Value){
+    		Header(Name, Type, Help);
+    		Sample(Name, "", Value);
+    	};
+    	T.precision(15);
+    	Metric("uptime_seconds",             "gauge",   "Time since the interface was created.", M.UptimeSeconds);
+    	Metric("rx_packages_total",          "counter", "Packages received.", M.RxPackages);
+    	Metric("rx_bytes_total",             "counter", "Bytes received.", M.RxBytes);
+    	Metric("rx_packages_missing_total",  "counter", "Requests without a response.", M.RxPackagesMissing);
+    	Header("rx_packages_broken_total",   "counter", "Broken packages, by reason.");
+    	Sample("rx_packages_broken_total",   ",reason=\"checksum\"", M.RxPackagesBrokenChecksum);
+    	Sample("rx_packages_broken_total",   ",reason=\"structure\"", M.RxPackagesBrokenStructure);
+    	Metric("rx_bytes_discarded_total",   "counter", "Received bytes, which were not part of a valid package.", M.RxBytesDiscarded);
+    	Metric("tx_packages_total",          "counter", "Packages send.", M.TxPackages);
+    	Metric("tx_bytes_total",             "counter", "Bytes send.", M.TxBytes);
+    	Metric("handler_calls_total",        "counter", "Packages handed to the package handlers.", M.HandlerCalls);
+    	Metric("handler_seconds_total",      "counter", "Time spend in the package handlers.", M.HandlerTimeNs /1e9);
+    	Metric("handler_seconds_max",        "gauge",   "Longest call of the package handlers.", M.HandlerTimeNsMax /1e9);
+    	Metric("handler_queue_full_total",   "counter", "Packages, which had to wait for a handler thread.", M.HandlerQueueFull);
+    	Metric("handler_queue_depth",        "gauge",   "Packages waiting for a handler thread.", M.HandlerQueueDepth);
+    	Metric("tx_queue_depth",             "gauge",   "Packages queued by the sending threads, but not yet written.", M.TxQueueDepth);
+    	Metric("rx_ring_bytes",              "gauge",   "Bytes in the decoder ring, which are not yet part of a complete package.", M.RxRingLevel);
+    	Metric("log_backlog",                "gauge",   "Log records waiting for the log thread.", M.LogBacklog);
+    	Metric("requests_in_flight",         "gauge",   "Requests send, which did not receive a response yet.", M.RequestsInFlight);
+    	Metric("unclaimed_responses",        "gauge",   "Requests and responses, which were not claimed yet.", M.UnclaimedRequestResponces);
+    	Metric("duplicate_responses",        "gauge",   "Entries in the duplicate response buffer.", M.DuplicateResponses);
+    	Metric("async_requests",             "gauge",   "Open asynchronous requests.", M.AsyncRequests);
+
+    	// round-trip latency as summary
+    	std::vector<latencySnapshot_t> Latencies = GSBP_XXX::GetLatencySnapshots();
+    	if (!Latencies.empty()){
+    		T << "# HELP gsbp_round_trip_seconds Time from sending a command to its first response.\n";
+    		T << "# TYPE gsbp_round_trip_seconds summary\n";
+    	}
+    	for (auto L = Latencies.begin(); L != Latencies.end(); ++L){
+    		std::string CommandLabel = Label + ",command=\"" + std::to_string(L->CommandID) + "\"";
+    		const char* Quantiles[4] = {"0.5", "0.9", "0.99", "0.999"};
+    		uint64_t    Values[4]    = {L->P50Ns, L->P90Ns, L->P99Ns, L->P999Ns};
+    		for (uint32_t i=0; i<4; i++){
+    			T << "gsbp_round_trip_seconds{" << CommandLabel << ",quantile=\"" << Quantiles[i] << "\"} " << Values[i] /1e9 << "\n";
+    		}
+    		T << "gsbp_round_trip_seconds_sum{" << CommandLabel << "} " << L->MeanNs *L->Count /1e9 << "\n";
+    		T << "gsbp_round_trip_seconds_count{" << CommandLabel << "} " << L->Count << "\n";
+    	}
+    	return T.str();
+    }
+
+    /*
+     * writes the metrics in the Prometheus text format to a file (e.g. for the textfile collector of the node exporter)
+     * -> the file is replaced atomically, so a reader never sees a partial file
+     */
+    bool GSBP_XXX::WriteMetrics(const char* FileName, uint16_t* ErrorCode)
+    {
+    	*ErrorCode = NoError;
+    	std::string Text = GSBP_XXX::GetMetricsText();
+    	std::string TempFileName = std::string(FileName) + ".tmp";
+    	int fdFile = open(TempFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    	if (fdFile < 0){
+    		printf("\e[1m\e[91m%s ERROR:\e[0m Can't open the metrics file %s: %s (%d)\n", this->ID, TempFileName.c_str(), strerror(errno), errno);
+    		*ErrorCode = GSBP_MetricsFailed;
+    		return false;
+    	}
+    	size_t Written = 0;
+    	while (Written < Text.size()){
+    		ssize_t BytesWritten = write(fdFile, Text.data() + Written, Text.size() - Written);
+    		if (BytesWritten < 0){
+    			if (errno == EINTR){
+    				continue;
+    			}
+    			printf("\e[1m\e[91m%s ERROR:\e[0m Can't write the metrics file %s: %s (%d)\n", this->ID, TempFileName.c_str(), strerror(errno), errno);
+    			close(fdFile);
+    			unlink(TempFileName.c_str());
+    			*ErrorCode = GSBP_MetricsFailed;
+    			return false;
+    		}
+    		Written += BytesWritten;
+    	}
+    	close(fdFile);
+    	if (rename(TempFileName.c_str(), FileName) < 0){
+    		printf("\e[1m\e[91m%s ERROR:\e[0m Can't replace the metrics file %s: %s (%d)\n", this->ID, FileName, strerror(errno), errno);
+    		unlink(TempFileName.c_str());
+    		*ErrorCode = GSBP_MetricsFailed;
+    		return false;
+    	}
+    	return true;
+    }
+
+    /*
+     * serves the metrics on a Unix domain socket -> every connection gets the metrics in the Prometheus text format
+     * and is closed; a HTTP request (e.g. curl --unix-socket) gets a HTTP response
+     */
+    bool GSBP_XXX::StartMetricsSocket(const char* SocketPath, uint16_t* ErrorCode)
+    {
+    	*ErrorCode = NoError;
+    	boost::mutex::scoped_lock lock(this->Metrics_mutex);
+    	if (this->Metrics_thread != NULL){
+    		printf("\e[1m\e[91m%s ERROR:\e[0m The metrics socket is already running!\n", this->ID);
+    		*ErrorCode = GSBP_MetricsFailed;
+    		return false;
+    	}
+    	struct sockaddr_un Address;
+    	memset(&Address, 0, sizeof(Address));
+    	Address.sun_family = AF_UNIX;
+    	if (strlen(SocketPath) >= sizeof(Address.sun_path)){
+    		printf("\e[1m\e[91m%s ERROR:\e[0m The metrics socket path %s is too long!\n", this->ID, SocketPath);
+    		*ErrorCode = GSBP_MetricsFailed;
+    		return false;
+    	}
+    	strcpy(Address.sun_path, SocketPath);
+    	this->fdMetrics = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    	if (this->fdMetrics < 0){
+    		printf("\e[1m\e[91m%s ERROR:\e[0m Can't create the metrics socket: %s (%d)\n", this->ID, strerror(errno), errno);
+    		*ErrorCode = GSBP_MetricsFailed;
+    		return false;
+    	}
+    	// a socket file left by a previous run
+    	unlink(SocketPath);
+    	if (bind(this->fdMetrics, (struct sockaddr*)&Address, sizeof(Address)) < 0 || listen(this->fdMetrics, gsbp_MetricsSocketBacklog) < 0){
+    		printf("\e[1m\e[91m%s ERROR:\e[0m Can't listen on the metrics socket %s: %s (%d)\n", this->ID, SocketPath, strerror(errno), errno);
+    		close(this->fdMetrics);
+    		this->fdMetrics = -1;
+    		*ErrorCode = GSBP_MetricsFailed;
+    		return false;
+    	}
+    	strcpy(this->MetricsSocketPath, SocketPath);
+    	this->RunMetricsThread = true;
+    	this->Metrics_thread = new boost::thread(&GSBP_XXX::MetricsServer, this);
+    	return true;
+    }
+
+    bool GSBP_XXX::StopMetricsSocket(uint16_t* ErrorCode)
+    {
+    	*ErrorCode = NoError;
+    	boost::mutex::scoped_lock lock(this->Metrics_mutex);
+    	if (this->Metrics_thread == NULL){
+    		*ErrorCode = GSBP_MetricsFailed;
+    		return false;
+    	}
+    	this->RunMetricsThread = false;
+    	this->Metrics_thread->join();
+    	delete this->Metrics_thread;
+    	this->Metrics_thread = NULL;
+    	close(this->fdMetrics);
+    	this->fdMetrics = -1;
+    	unlink(this->MetricsSocketPath);
+    	memset(this->MetricsSocketPath, 0, sizeof(this->MetricsSocketPath));
+    	return true;
+    }
+
+    /*
+     * metrics socket thread -> answers one connection after the other until StopMetricsSocket() is called
+     */
+    void GSBP_XXX::MetricsServer(void)
+    {
+    	while (this->RunMetricsThread.load()){
+    		struct pollfd Poll = {this->fdMetrics, POLLIN, 0};
+    		if (poll(&Poll, 1, gsbp_PackageReadTimoutUs /1000) <= 0){
+    			continue;
+    		}
+    		int fdClient = accept4(this->fdMetrics, NULL, NULL, SOCK_CLOEXEC);
+    		if (fdClient < 0){
+    			continue;
+    		}
+    		// a client, which does not read the answer, must not block the thread
+    		struct timeval SendTimeout = {1, 0};
+    		setsockopt(fdClient, SOL_SOCKET, SO_SNDTIMEO, &SendTimeout, sizeof(SendTimeout));
+    		// a HTTP client sends its request first; a plain client (e.g. socat) sends nothing
+    		char Request[16] = {0};
+    		struct pollfd ClientPoll = {fdClient, POLLIN, 0};
+    		if (poll(&ClientPoll, 1, gsbp_MetricsRequestTimeoutMs) > 0){
+    			ssize_t Received = recv(fdClient, Request, sizeof(Request) -1, MSG_DONTWAIT);
+    			if (Received < 0){
+    				Request[0] = 0;
+    			}
+    		}
+    		std::string Text = GSBP_XXX::GetMetricsText();
+    		if (strncmp(Request, "GET ", 4) == 0){
+    			Text = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(Text.size()) + "\r\n\r\n" + Text;
+    		}
+    		size_t Written = 0;
+    		while (Written < Text.size()){
+    			ssize_t BytesWritten = send(fdClient, Text.data() + Written, Text.size() - Written, MSG_NOSIGNAL);
+    			if (BytesWritten < 0){
+    				if (errno == EINTR){
+    					continue;
+    				}
+    				break;
+    			}
+    			Written += BytesWritten;
+    		}
+    		close(fdClient);
+    	}
+    }
+
+    /*
+     * debug categories (debugCategory_t, or'ed) -> take effect immediately; a disabled category costs one relaxed load
+     */
+    void GSBP_XXX::SetDebugCategories(uint32_t Categories)
+    {
+    	this->DebugCategories.store(Categories, std::memory_order_relaxed);
+    }
+
+    void GSBP_XXX::EnableDebugCategory(debugCategory_t Category, bool Enable)
+    {
+    	if (Enable){
+    		this->DebugCategories.fetch_or(Category, std::memory_order_relaxed);
+    	} else {
+    		this->DebugCategories.fetch_and(~(uint32_t)Category, std::memory_order_relaxed);
+    	}
+    }
+
+    uint32_t GSBP_XXX::GetDebugCategories(void)
+    {
+    	return this->DebugCategories.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * log messages -> the sink is called by the log thread (or the thread logging, if the interface is not connected),
+     * never with a lock of the interface held; NULL prints the messages to stdout
+     */
+    void GSBP_XXX::SetLogSink(logSink_t Sink)
+    {
+    	boost::mutex::scoped_lock lock(this->LogSink_mutex);
+    	GSBP_XXX::DrainLogRing();
+    	this->LogSink = Sink;
+    }
+
+    void GSBP_XXX::SetLogLevel(logSeverity_t MinimumSeverity)
+    {
+    	this->LogLevel.store(MinimumSeverity, std::memory_order_relaxed);
+    }
+
+    /*
+     * maximum number of messages per second for every log site -> the suppressed messages are counted
+     * in the next record of the site
+     */
+    void GSBP_XXX::SetLogRateLimit(uint32_t MessagesPerSecond)
+    {
+    	this->LogRateLimit.store(MessagesPerSecond, std::memory_order_relaxed);
+    }
+
+    /*
+     * hands all buffered log records to the sink
+     */
+    void GSBP_XXX::FlushLog(void)
+    {
+    	boost::mutex::scoped_lock lock(this->LogSink_mutex);
+    	GSBP_XXX::DrainLogRing();
+    }
+
+    void GSBP_XXX::GetLogStatistics(logStatistics_t* Statistics, bool Reset)
+    {
+    	Statistics->Logged = this->LogLogged.load();
+    	Statistics->RateLimited = this->LogRateLimited.load();
+    	Statistics->Dropped = this->LogDropped.load();
+    	if (Reset){
+    		this->LogLogged = 0;
+    		this->LogRateLimited = 0;
+    		this->LogDropped = 0;
+    	}
+    }
+
+    /*
+     * logs a message -> the severity filter and the rate limit are checked before the message is formatted;
+     * with the log thread running, the record is written to a slot of the log ring (no I/O, no lock)
+     */
+    void GSBP_XXX::Log(logSite_t Site, logSeverity_t Severity, const char* Format, ...)
+    {
+    	if ((uint32_t)Severity < this->LogLevel.load(std::memory_order_relaxed)){
+    		return;
+    	}
+    	// rate limit -> one second windows per log site
+    	logSiteState_t* S = &this->LogSites[Site];
+    	uint64_t Now = GSBP_XXX::GetMonotonicTimeNs();
+    	uint64_t WindowStart = S->WindowStartNs.load(std::memory_order_relaxed);
+    	if (Now - WindowStart >= 1000000000ULL && S->WindowStartNs.compare_exchange_strong(WindowStart, Now, std::memory_order_relaxed)){
+    		S->Count.store(0, std::memory_order_relaxed);
+    	}
+    	if (S->Count.fetch_add(1, std::memory_order_relaxed) >= this->LogRateLimit.load(std::memory_order_relaxed)){
+    		S->Suppressed.fetch_add(1, std::memory_order_relaxed);
+    		this->LogRateLimited.fetch_add(1, std::memory_order_relaxed);
+    		return;
+    	}
+
+    	logRecord_t  DirectRecord;
+    	logRecord_t* Record = &DirectRecord;
+    	logSlot_t*   Slot = NULL;
+    	uint64_t     Position = 0;
+    	if (this->RunLogThread.load(std::memory_order_acquire)){
+    		// claim a slot of the ring
+    		Position = this->LogHead.load(std::memory_order_relaxed);
+    		while (true){
+    			Slot = &this->LogRing[Position & (gsbp_LogRingSize -1)];
+    			int64_t Difference = (int64_t)(Slot->Sequence.load(std::memory_order_acquire) - Position);
+    			if (Difference == 0){
+    				if (this->LogHead.compare_exchange_weak(Position, Position +1, std::memory_order_relaxed)){
+    					break;
+    				}
+    			} else if (Difference < 0){
+    				// the ring is full -> the message is reported as suppressed with the next record of this site
+    				S->Suppressed.fetch_add(1, std::memory_order_relaxed);
+    				this->LogDropped.fetch_add(1, std::memory_order_relaxed);
+    				return;
+    			} else {
+    				Position = this->LogHead.load(std::memory_order_relaxed);
+    			}
+    		}
+    		Record = &Slot->Record;
+    	}
+    	struct timespec Realtime;
+    	clock_gettime(CLOCK_REALTIME, &Realtime);
+    	Record->TimeNs = (uint64_t)Realtime.tv_sec *1000000000 + Realtime.tv_nsec;
+    	Record->Severity = Severity;
+    	Record->Site = Site;
+    	Record->Suppressed = S->Suppressed.exchange(0, std::memory_order_relaxed);
+    	va_list Arguments;
+    	va_start(Arguments, Format);
+    	vsnprintf(Record->Message, sizeof(Record->Message), Format, Arguments);
+    	va_end(Arguments);
+
+    	if (Slot != NULL){
+    		// publish the record
+    		Slot->Sequence.store(Position +1, std::memory_order_release);
+    	} else {
+    		boost::mutex::scoped_lock lock(this->LogSink_mutex);
+    		if (this->LogSink){
+    			this->LogSink(Record);
+    		} else {
+    			GSBP_XXX::PrintLogRecord(Record);
+    			fflush(stdout);
+    		}
+    		this->LogLogged.fetch_add(1, std::memory_order_relaxed);
+    	}
+    }
+
+    /*
+     * hands the published records to the sink in the logged order -> call with LogSink_mutex locked
+     * returns the number of records
+     */
+    uint32_t GSBP_XXX::DrainLogRing(void)
+    {
+    	uint32_t NumberOfRecords = 0;
+    	while (true){
+    		logSlot_t* Slot = &this->LogRing[this->LogTail & (gsbp_LogRingSize -1)];
+    		if (Slot->Sequence.load(std::memory_order_acquire) != this->LogTail +1){
+    			// empty or not yet published
+    			break;
+    		}
+    		if (this->LogSink){
+    			this->LogSink(&Slot->Record);
+    		} else {
+    			GSBP_XXX::PrintLogRecord(&Slot->Record);
+    		}
+    		// release the slot for the next round
+    		Slot->Sequence.store(this->LogTail + gsbp_LogRingSize, std::memory_order_release);
+    		this->LogTail++;
+    		NumberOfRecords++;
+    	}
+    	if (NumberOfRecords > 0){
+    		this->LogLogged.fetch_add(NumberOfRecords, std::memory_order_relaxed);
+    		if (!this->LogSink){
+    			fflush(stdout);
+    		}
+    	}
+    	return NumberOfRecords;
+    }
+
+    /*
+     * default sink -> prints the record like the interface did before the log ring existed
+     */
+    void GSBP_XXX::PrintLogRecord(const logRecord_t* Record)
+    {
+    	switch (Record->Severity){
+    	case LogError:
+    		printf("\e[1m\e[91m%s ERROR:\e[0m %s\n", this->ID, Record->Message);
+    		break;
+    	case LogWarning:
+    		printf("\e[1m%s WARNING:\e[0m %s\n", this->ID, Record->Message);
+    		break;
+    	default:
+    		printf("%s: %s\n", this->ID, Record->Message);
+    		break;
+    	}
+    	if (Record->Suppressed > 0){
+    		printf("   -> %u similar messages were suppressed\n", Record->Suppressed);
+    	}
+    }
+
+    /*
+     * log thread -> writes the log ring every gsbp_LogFlushIntervalMs until StopLogThread() is called
+     */
+    void GSBP_XXX::LogWriter(void)
+    {
+    	boost::mutex::scoped_lock lock(this->LogThread_mutex);
+    	while (this->RunLogThread.load()){
+    		this->LogCondition.timed_wait(lock, boost::posix_time::milliseconds(gsbp_LogFlushIntervalMs));
+    		lock.unlock();
+    		GSBP_XXX::FlushLog();
+    		lock.lock();
+    	}
+    }
+
+    void GSBP_XXX::StartLogThread(void)
+    {
+    	if (this->Log_thread != NULL){
+    		return;
+    	}
+    	this->RunLogThread = true;
+    	this->Log_thread = new boost::thread(&GSBP_XXX::LogWriter, this);
+    }
+
+    /*
+     * stops the log thread and writes the remaining records -> the interface logs directly to the sink afterwards
+     */
+    void GSBP_XXX::StopLogThread(void)
+    {
+    	if (this->Log_thread == NULL){
+    		return;
+    	}
+    	{
+    		boost::mutex::scoped_lock lock(this->LogThread_mutex);
+    		this->RunLogThread = false;
+    	}
+    	this->LogCondition.notify_all();
+    	this->Log_thread->join();
+    	delete this->Log_thread;
+    	this->Log_thread = NULL;
+    	GSBP_XXX::FlushLog();
+    }
+
+    /*
+     * starts recording the packet lifecycle trace points -> every thread writes into its own ring of gsbp_TraceRingSize events
+     */
+    bool GSBP_XXX::StartTrace(uint16_t* ErrorCode)
+    {
+    	*ErrorCode = NoError;
+    	boost::mutex::scoped_lock lock(this->Trace_mutex);
+    	if (this->TraceActive.load()){
+    		*ErrorCode = GSBP_TraceFailed;
+    		return false;
+    	}
+    	// a new session -> the rings cached by the threads for an earlier trace are not used again
+    	this->TraceSession = ++GSBP_XXX::TraceSessions;
+    	this->TraceActive = true;
+    	return true;
+    }
+
+    /*
+     * stops the trace and writes the recorded events as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev);
+     * FileName and Statistics can be NULL -> the events are discarded
+     */
+    bool GSBP_XXX::StopTrace(const char* FileName, traceStatistics_t* Statistics, uint16_t* ErrorCode)
+    {
+    	*ErrorCode = NoError;
+    	boost::mutex::scoped_lock lock(this->Trace_mutex);
+    	if (!this->TraceActive.load()){
+    		*ErrorCode = GSBP_TraceFailed;
+    		return false;
+    	}
+    	// no new events -> wait for the threads, which are still writing into their rings
+    	this->TraceActive = false;
+    	while (this->TraceUsers.load() > 0){
+    		boost::this_thread::yield();
+    	}
+
+    	bool WriteOk = true;
+    	traceStatistics_t Stats = {0, 0, (uint32_t)this->TraceRings.size()};
+    	if (FileName != NULL){
+    		WriteOk = GSBP_XXX::WriteTrace(FileName, &Stats);
+    	}
+    	for (auto Ring = this->TraceRings.begin(); Ring != this->TraceRings.end(); ++Ring){
+    		delete *Ring;
+    	}
+    	this->TraceRings.clear();
+
+    	if (Statistics != NULL){
+    		*Statistics = Stats;
+    	}
+    	if (!WriteOk){
+    		*ErrorCode = GSBP_TraceFailed;
+    	}
+    	return WriteOk;
+    }
+
+    /*
+     * writes one event into the ring of the calling thread -> never waits, overwrites the oldest event of the ring
+     */
+    void GSBP_XXX::RecordTrace(tracePoint_t Point, char Phase, uint64_t Id, uint32_t Arg)
+    {
+    	this->TraceUsers.fetch_add(1);
+    	if (this->TraceActive.load()){
+    		traceRing_t* Ring = GSBP_XXX::GetTraceRing(Point);
+    		uint64_t Head = Ring->Head.load(std::memory_order_relaxed);
+    		traceEvent_t* Event = &Ring->Events[Head & (gsbp_TraceRingSize -1)];
+    		Event->TimeNs = GSBP_XXX::GetMonotonicTimeNs();
+    		Event->Id = Id;
+    		Event->Arg = Arg;
+    		Event->Point = (uint8_t)Point;
+    		Event->Phase = Phase;
+    		Ring->Head.store(Head +1, std::memory_order_release);
+    	}
+    	this->TraceUsers.fetch_sub(1);
+    }
+
+    /*
+     * returns the ring of the calling thread for the current trace session -> registers a new ring on the first event
+     */
+    GSBP_XXX::traceRing_t* GSBP_XXX::GetTraceRing(tracePoint_t Point)
+    {
+    	uint64_t Session = this->TraceSession.load(std::memory_order_relaxed);
+    	for (uint32_t i=0; i<gsbp_TraceRingsPerThread; i++){
+    		if (GSBP_XXX::TraceThreadCache[i].Session == Session){
+    			return GSBP_XXX::TraceThreadCache[i].Ring;
+    		}
+    	}
+
+    	traceRing_t* Ring = new traceRing_t;
+    	Ring->Head = 0;
+    	Ring->ThreadId = (pid_t)syscall(SYS_gettid);
+    	switch (Point){
+    		case TraceSelect:
+    		case TraceRead:
+    		case TraceBuildPackage:
+    		case TraceAddResponse:
+    		case TraceAddResponseLock:
+    		case TraceHandlerQueue:
+    			Ring->Role = "receiver";
+    			break;
+    		case TracePackageHandlers:
+    			Ring->Role = "handler";
+    			break;
+    		default:
+    			Ring->Role = "requester";
+    			break;
+    	}
+    	{
+    		// not Trace_mutex -> StopTrace() holds it while waiting for TraceUsers
+    		boost::mutex::scoped_lock lock(this->TraceRings_mutex);
+    		this->TraceRings.push_back(Ring);
+    	}
+    	traceThreadCache_t* Cache = &GSBP_XXX::TraceThreadCache[GSBP_XXX::TraceThreadCacheNext];
+    	GSBP_XXX::TraceThreadCacheNext = (GSBP_XXX::TraceThreadCacheNext +1) % gsbp_TraceRingsPerThread;
+    	Cache->Session = Session;
+    	Cache->Ring = Ring;
+    	return Ring;
+    }
+
+    /*
+     * writes the trace rings in the Chrome trace event format -> call with Trace_mutex locked and no active trace
+     */
+    bool GSBP_XXX::WriteTrace(const char* FileName, traceStatistics_t* Statistics)
+    {
+    	FILE* File = fopen(FileName, "w");
+    	if (File == NULL){
+    		return false;
+    	}
+    	int Pid = (int)getpid();
+    	fprintf(File, "{\"traceEvents\":[\n");
+    	fprintf(File, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"GSBP %s\"}}", Pid, this->ID);
+    	for (auto It = this->TraceRings.begin(); It != this->TraceRings.end(); ++It){
+    		traceRing_t* Ring = *It;
+    		fprintf(File, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+    				Pid, (int)Ring->ThreadId, Ring->Role, (int)Ring->ThreadId);
+
+    		uint64_t Head = Ring->Head.load(std::memory_order_acquire);
+    		uint64_t Start = 0;
+    		if (Head > gsbp_TraceRingSize){
+    			Start = Head - gsbp_TraceRingSize;
+    			Statistics->EventsOverwritten += Start;
+    		}
+    		for (uint64_t i=Start; i<Head; i++){
+    			const traceEvent_t* Event = &Ring->Events[i & (gsbp_TraceRingSize -1)];
+    			const char* Name = TracePointNames[Event->Point].Name;
+    			const char* ArgName = TracePointNames[Event->Point].ArgName;
+    			fprintf(File, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+    					Name, Event->Phase, Event->TimeNs /1000.0, Pid, (int)Ring->ThreadId);
+    			switch (Event->Phase){
+    				case 'b':
+    				case 'n':
+    				case 'e':
+    					// async events -> one track per request ID
+    					fprintf(File, ",\"cat\":\"request\",\"id\":\"0x%lx\"", Event->Id);
+    					break;
+    				case 'i':
+    					fprintf(File, ",\"s\":\"t\"");
+    					break;
+    			}
+    			fprintf(File, ",\"args\":{\"request\":%lu", Event->Id);
+    			if (ArgName != NULL){
+    				fprintf(File, ",\"%s\":%u", ArgName, Event->Arg);
+    			}
+    			fprintf(File, "}}");
+    			Statistics->Events++;
+    		}
+    	}
+    	fprintf(File, "\n],\"displayTimeUnit\":\"ns\"}\n");
+    	bool WriteOk = !ferror(File);
+    	if (fclose(File) != 0){
+    		WriteOk = false;
+    	}
+    	return WriteOk;
+    }
+
+    /*
+     * copies the response of a request/response element to an rxPackage_t -> call with RequestResponseLock_mutex locked
+     */
+    void GSBP_XXX::CopyResponse(RequestResponse_t* Request, rxPackage_t* ACK)
+    {
+    	ACK->CommandID = Request->Ack.CommandID;
+    	ACK->State = Request->Ack.State;
+    	ACK->RequestID = Request->Ack.RequestID;
+    	ACK->DataSize = Request->Ack.DataSize;
+    	if (Request->Ack.DataSize > 0){
+    		memcpy(ACK->Data, Request->Ack.Data, Request->Ack.DataSize);
+    	}
+    	if (Request->Ack.DataSize < gsbp_RxMaxUserDataSize){
+    		ACK->Data[Request->Ack.DataSize] = 0x00; // make sure strings are properly terminated
+    	}
+    }
+
+
+    /* ### #########################################################################
+     * Debug / Info functions
+     * ### #########################################################################
+     */
+
+    void GSBP_XXX::DoPrintNodeInfo(gsbp_ACK_nodeInfo_t* NodeInfo)
+    {
+    	std::cout << this->ID << " Device Information:" << std::endl;
+    	std::cout << "   Board ID: " << NodeInfo->boardID << std::endl;
+    	std::cout << "   Device Class: " << NodeInfo->deviceClass << std::endl;
+    	std::cout << "   Serial Number: " << NodeInfo->serialNumber << std::endl;
+    	std::cout << "   Version GSBP: [" << (uint32_t)NodeInfo->versionProtocol[0] << "][" << (uint32_t)NodeInfo->versionProtocol[1] << "]" << std::endl;
+    	std::cout << "   Version Firmware: [" << (uint32_t)NodeInfo->versionFirmware[0] << "][" << (uint32_t)NodeInfo->versionFirmware[1] << "]" << std::endl;
+    	if (strlen((const char*)NodeInfo->msg) > 0){
+    		std::cout << "   Description: " << NodeInfo->msg << std::endl;
+    	}
+    	std::cout << std::endl;
+    }
+
+    void GSBP_XXX::DoPrintPackageContent(txPackage_t* Package, uint8_t RequestIdLocal)
+    {
+    	GSBP_XXX::DoPrintPackageContent(RequestIdLocal, Package->Data, Package->DataSize);
+    }
+
+    void GSBP_XXX::DoPrintPackageContent(rxPackage_t* Package)
+    {
+    	GSBP_XXX::DoPrintPackageContent(Package->RequestID, Package->Data, Package->DataSize);
+    }
+
+    void GSBP_XXX::DoPrintPackageContent(uint8_t RequestIdLocal, uint8_t* Data, uint32_t DataSize)
+    {
+        std::cout << "        -> ID number Local: " << (uint32_t)RequestIdLocal << std::endl;
+        if ( DataSize > 0 && Data != NULL ) {
+            std::cout << "        -> Data:" << std::endl << "           ";
+            for(uint32_t i=0,j=0; i<DataSize; i++, j++){
+                printf("0x%02X ", Data[i]);
+                if (j==GSBP__DEBUG__PP_N_DATA_BYTES_PER_LINE){
+                    printf("\n           ");
+                    j=0;
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    void GSBP_XXX::DoPrintPackage(rxPackage_t* Package, bool IsACK)
+    {
+    	if (GSBP_XXX::IsDebugEnabled(DebugReceivingExceptMeasurementAcks) && (Package->CommandID == this->ExtConfig.ApplicationDataACK_ID)){
+    		return;
+    	}
+
+        char CTyp[50], CTypfull[50], CState[100], COptions[100], CChecksumData[50], CColor[50];
+        // prepare what to print
+        if (IsACK){
+            switch (Package->State){
+                case PackageIsOk:                        sprintf(CState, "Ok"); break;
+                case PackageIsBroken:                    sprintf(CState, "Broken"); break;
+                case PackageIsBroken_EndByteError:       sprintf(CState, "Broken, because the end byte did not match"); break;
+                case PackageIsBroken_IncompleteData:     sprintf(CState, "Broken, because the Data was incomplete"); break;
+                case PackageIsBroken_IncompleteTimout:   sprintf(CState, "Broken, because not all bytes were transmitted in time"); break;
+                default:                                 sprintf(CState, "Unknown state!");
+            }
+            sprintf(CTyp, "ACK");
+            sprintf(CTypfull, "ACK -> State: %s", CState);
+        } else {
+        	sprintf(CTyp, "CMD");
+        	sprintf(CTypfull, "CMD");
+        }
+
+        COptions[0] = 0x00;
+        #if GSBP__ACTIVATE_DESTINATION_FEATURE || GSBP__ACTIVATE_SOURCE_DESTINATION_FEATURE
+        sprintf(&COptions[strlen(COptions)], "   Destination: %d\n", Package->Destination);
+        #endif
+        #if GSBP__ACTIVATE_SOURCE_FEATURE || GSBP__ACTIVATE_SOURCE_DESTINATION_FEATURE
+        sprintf(&COptions[strlen(COptions)], "   Source: %d\n", Package->Source);
+        #endif
+        #if GSBP__ACTIVATE_CONTROL_BYTE_FEATURE
+        sprintf(&COptions[strlen(COptions)], "   Control Byte: 0x%02X\n", Package->Control);
+        #endif
         // TODO Checksum
         sprintf(CChecksumData, "TODO");
 
@@ -1501,51 +4097,53 @@ typedef union {
     void GSBP_XXX::DoPrintRequestResponse(RequestResponse_t* Request, bool AddOnlyAck, bool PrintPackageContent)
     {
     	boost::posix_time::time_duration CompletionPeriod;
+    	// the debug timestamps are only valid, if they were recorded for this request
+    	debugTimes_t* Times = &this->RequestDebugTimes[Request->RequestIdLocal_Debug];
+    	if (Times->RequestIdGlobal != Request->RequestIdGlobal_Debug){
+    		Times = NULL;
+    	}
     	if (!AddOnlyAck){
     		std::cout << "  -> Request " << Request->RequestIdGlobal_Debug << " (local: " << (uint32_t)Request->RequestIdLocal << ")";
     		if (Request->ResponseReceived){
-#if GSBP__DEBUG_SENDING_COMMANDS
-#if GSBP__DEBUG_RECEIVING_COMMANDS
-    			CompletionPeriod = Request->AckTime - Request->CmdTime;
-    			std::cout << " --> completed after " << CompletionPeriod.total_milliseconds() << "ms";
-#endif
-#endif
+    			if (Times != NULL && !Times->CmdTime.is_not_a_date_time() && !Times->AckTime.is_not_a_date_time()){
+    				CompletionPeriod = Times->AckTime - Times->CmdTime;
+    				std::cout << " --> completed after " << CompletionPeriod.total_milliseconds() << "ms";
+    			}
     			std::cout << std::endl;
     		} else {
     			std::cout << std::endl;
     		}
 
     		std::cout << "      -> CMD: " << GSBP_XXX::GetCmdString(Request->Cmd.CommandID) << " (" << Request->Cmd.CommandID << ") -> data size: " << Request->Cmd.DataSize;
-#if GSBP__DEBUG_SENDING_COMMANDS
-    		std::cout << "  -> Send at: " << boost::posix_time::to_simple_string(Request->CmdTime);
-#endif
+    		if (Times != NULL && !Times->CmdTime.is_not_a_date_time()){
+    			std::cout << "  -> Send at: " << boost::posix_time::to_simple_string(Times->CmdTime);
+    		}
     		std::cout << std::endl;
     		if (PrintPackageContent){
-    			GSBP_XXX::DoPrintPackageContent(&Request->Cmd, Request->RequestIdLocal_Debug);
+    			GSBP_XXX::DoPrintPackageContent(Request->RequestIdLocal_Debug, Request->Cmd.Data, Request->Cmd.DataSize);
     		}
     	}
 
     	if (Request->ResponseReceived){
         	std::cout << "      -> ACK: " << GSBP_XXX::GetCmdString(Request->Ack.CommandID) << " (" << Request->Ack.CommandID << ") -> data size: " << Request->Ack.DataSize;
-#if GSBP__DEBUG_RECEIVING_COMMANDS
-        	std::cout << "  -> Send at: " << boost::posix_time::to_simple_string(Request->AckTime);
-#endif
+        	if (Times != NULL && !Times->AckTime.is_not_a_date_time()){
+        		std::cout << "  -> Send at: " << boost::posix_time::to_simple_string(Times->AckTime);
+        	}
         	std::cout << std::endl;
     		if (PrintPackageContent){
-    			GSBP_XXX::DoPrintPackageContent(&Request->Ack);
+    			GSBP_XXX::DoPrintPackageContent(Request->Ack.RequestID, Request->Ack.Data, Request->Ack.DataSize);
     		}
     	} else {
     		std::cout << "      -> ACK was not received!";
-    		if (Request->WaitForResponce)
-#if GSBP__DEBUG_RECEIVING_COMMANDS
-    		std::cout << " -> It was waited " << Request->AckWaitTimeout << "ms for the response.";
-#endif
+    		if (Request->WaitForResponce && Times != NULL && Times->AckWaitTimeout != 0){
+    			std::cout << " -> It was waited " << Times->AckWaitTimeout << "ms for the response.";
+    		}
     		std::cout << std::endl;
     	}
 
     	if (Request->Error){
     		std::cout << "        -> An ERROR occurred: \e[1m\e[91mErrorCode\e[0m=" << Request->ErrorCode << std::endl;
-    		std::cout << "           MSG: '" << Request->ErrorDescription << "'" << std::endl;
+    		std::cout << "           MSG: '" << ((Request->ErrorDescription != NULL) ? Request->ErrorDescription : "") << "'" << std::endl;
     	}
     }
 
@@ -0,0 +1,70 @@
+/*
+ * # GSBP MCU Simulator -> Main Program #
+ *   the main program of the GSBP_DevDummy MCU example,
+ *   built for a Linux host
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    main.h -> header file of the simulator main program
+ *   Version: 1 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32l4xx_hal.h"
+
+// state machine of the GSBP_DevDummy example (see GSBP_DevDummy__MCU_L432_USB/Core/Inc/main.h)
+typedef enum {
+	preInit				= 0,
+	doInit				= 1,
+	postInit			= 2,
+	startMeasurement 	= 3,
+	measurementActive	= 4,
+	stopMeasurement		= 5,
+	doDeInit			= 6
+} mcuStates_t;
+
+extern uint8_t mcuState;
+
+void Error_Handler(void);
+
+// GPIO ports of the debug pins and the LED -> not simulated
+extern GPIO_TypeDef SimGPIOA, SimGPIOB;
+#define D1_Pin GPIO_PIN_3
+#define D1_GPIO_Port (&SimGPIOA)
+#define D2_Pin GPIO_PIN_4
+#define D2_GPIO_Port (&SimGPIOA)
+#define D3_Pin GPIO_PIN_5
+#define D3_GPIO_Port (&SimGPIOA)
+#define LD3_Pin GPIO_PIN_3
+#define LD3_GPIO_Port (&SimGPIOB)
+
+#define LED_PERIOD_MS			400
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MAIN_H */
@@ -0,0 +1,92 @@
+/*
+ * # GSBP MCU Simulator -> HAL Shim #
+ *   the parts of the STM32 HAL used by the GSBP MCU module and the
+ *   GSBP_DevDummy example, implemented for a Linux host
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    stm32l4xx_hal.h -> header file of the HAL shim (replaces the STM32 HAL)
+ *   Version: 1 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SIM_STM32L4XX_HAL_H_
+#define SIM_STM32L4XX_HAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// compiler abstraction (cmsis_gcc.h)
+#ifndef __packed
+  #define __packed						__attribute__((packed))
+#endif
+#ifndef __weak
+  #define __weak						__attribute__((weak))
+#endif
+#define UNUSED(X)						(void)X
+
+typedef enum {
+	HAL_OK       = 0x00U,
+	HAL_ERROR    = 0x01U,
+	HAL_BUSY     = 0x02U,
+	HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+// UART -> only the fields used by GSBP_Basic.c; the debug UART writes to stderr
+#define HAL_UART_ERROR_NONE				0x00000000U
+#define HAL_UART_ERROR_ORE				0x00000008U
+#define HAL_UART_STATE_READY			0x00000020U
+#define HAL_UART_STATE_BUSY_RX			0x00000022U
+
+typedef struct {
+	int                 fd;				// file descriptor used by HAL_UART_Transmit(); -1 = discard
+	uint16_t            RxXferSize;
+	volatile uint16_t   RxXferCount;
+	volatile uint32_t   gState;
+	volatile uint32_t   ErrorCode;
+} UART_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+
+// GPIO -> the debug pins and the LED are not simulated
+typedef struct {
+	uint32_t ODR;
+} GPIO_TypeDef;
+#define GPIO_PIN_3						((uint16_t)0x0008)
+#define GPIO_PIN_4						((uint16_t)0x0010)
+#define GPIO_PIN_5						((uint16_t)0x0020)
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+// SysTick -> milliseconds of the monotonic clock; HAL_GetTickUs() is a simulator extension
+void     HAL_Init(void);
+uint32_t HAL_GetTick(void);
+uint64_t HAL_GetTickUs(void);
+void     HAL_Delay(uint32_t Delay);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_STM32L4XX_HAL_H_ */
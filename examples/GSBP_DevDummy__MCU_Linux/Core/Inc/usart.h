@@ -0,0 +1,47 @@
+/*
+ * # GSBP MCU Simulator -> UART Shim #
+ *   the UART handles of the GSBP_DevDummy example,
+ *   implemented for a Linux host
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    usart.h -> header file of the UART shim
+ *   Version: 1 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SIM_USART_H_
+#define SIM_USART_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+// debug UART -> stderr (see main.c)
+extern UART_HandleTypeDef huart2;
+
+void MX_USART2_UART_Init(bool Verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_USART_H_ */
@@ -0,0 +1,70 @@
+/*
+ * # GSBP MCU Simulator -> USB CDC Shim #
+ *   the USB CDC device interface used by the GSBP MCU module,
+ *   implemented with a pseudo-terminal on a Linux host
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    usbd_cdc_if.h -> header file of the USB CDC shim (the virtual COM port is a PTY)
+ *   Version: 1 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SIM_USBD_CDC_IF_H_
+#define SIM_USBD_CDC_IF_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32l4xx_hal.h"
+
+#define USBD_OK							0U
+#define USBD_BUSY						1U
+#define USBD_FAIL						3U
+
+#define CDC_SIM_PACKET_SIZE				64		// bytes per USB OUT transfer (full speed bulk endpoint)
+
+// USB device -> the OUT endpoint buffer and the PTY master
+typedef struct {
+	uint8_t  *RxBuffer;					// set with USBD_CDC_SetRxBuffer()
+	bool      RxReady;					// set with USBD_CDC_ReceivePacket()
+	int       fd;						// PTY master; -1 = not opened
+	uint64_t  BytesReceived;
+	uint64_t  BytesTransmitted;
+} USBD_HandleTypeDef;
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+// USB device library / CDC interface functions used by the GSBP MCU module
+uint8_t USBD_CDC_SetRxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff);
+uint8_t USBD_CDC_ReceivePacket(USBD_HandleTypeDef *pdev);
+uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len);
+uint8_t CDC_GSBP_WaitUntilReadyToSend(uint32_t timeout);
+
+// simulator functions
+const char* MX_USB_DEVICE_Init(const char *LinkName);
+void        MX_USB_DEVICE_DeInit(const char *LinkName);
+bool        CDC_Sim_Poll(uint32_t TimeoutUs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_USBD_CDC_IF_H_ */
@@ -0,0 +1,254 @@
+/*
+ * # GSBP MCU Simulator -> Main Program #
+ *   the main program of the GSBP_DevDummy MCU example,
+ *   built for a Linux host
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    main.c -> source file of the simulator main program
+ *   Version: 1 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include "main.h"
+#include "usart.h"
+#include "usbd_cdc_if.h"
+#include "GSBP_Basic_Config.h"
+#include "GSBP_Basic.h"
+
+uint8_t mcuState;
+GPIO_TypeDef SimGPIOA, SimGPIOB;
+
+static volatile sig_atomic_t doStop = 0;
+
+static void StopSimulator(int Signal)
+{
+	UNUSED(Signal);
+	doStop = 1;
+}
+
+static void PrintUsage(const char *Program)
+{
+	printf("Usage: %s [-l <link>] [-p <data period in us>] [-n <values per package>] [-c <callback period in ms>] [-v]\n", Program);
+	printf("   -l  creates the symbolic link <link> to the PTY (e.g. /tmp/ttyGSBP)\n");
+	printf("   -p  overrides the data period of the InitCMD; 0 = as fast as the PC reads\n");
+	printf("   -n  overrides the number of values per ApplicationDataACK (max. %d)\n", GSBP_MEASURMENT_DATA_SIZE_MAX);
+	printf("   -c  GSBP callback period (default %d ms)\n", GSBP_SETUP__CALLBACK_PERIOD_IN_MS);
+	printf("   -v  prints the GSBP debug messages (debug level %d) to stderr\n", GSBP_SETUP__DEBUG_LEVEL);
+}
+
+/*
+ * the main loop of GSBP_DevDummy__MCU_L432_USB/Core/Src/main.c; the USB interrupts are replaced by CDC_Sim_Poll()
+ */
+int main(int argc, char *argv[])
+{
+	const char *LinkName = NULL;
+	int64_t  overridePeriodUs = -1;
+	int32_t  overrideDataSize = -1;
+	uint32_t callbackPeriodMS = GSBP_SETUP__CALLBACK_PERIOD_IN_MS;
+	bool     verbose = false;
+	int opt;
+	while ((opt = getopt(argc, argv, "l:p:n:c:vh")) != -1){
+		switch (opt){
+		case 'l': LinkName = optarg; break;
+		case 'p': overridePeriodUs = atoll(optarg); break;
+		case 'n': overrideDataSize = atoi(optarg); break;
+		case 'c': callbackPeriodMS = (uint32_t)atoi(optarg); break;
+		case 'v': verbose = true; break;
+		default:
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+	signal(SIGINT, StopSimulator);
+	signal(SIGTERM, StopSimulator);
+
+	/* Initialise the simulated peripherals
+	 *********************************************************************************************/
+	HAL_Init();
+	MX_USART2_UART_Init(verbose);
+	const char *DeviceName = MX_USB_DEVICE_Init(LinkName);
+	if (DeviceName == NULL){
+		return 1;
+	}
+	printf("%s\n", (LinkName != NULL) ? LinkName : DeviceName);
+	fflush(stdout);
+
+	/* Initialise variables
+	 **********************************************************************************************/
+	mcuState = preInit;
+	uint32_t ledCounter = HAL_GetTick() + LED_PERIOD_MS;
+	uint64_t dataCounterUs = 0;
+	uint64_t dataCounterPeriodUs = 0;
+	uint16_t dataSize = 0;
+	uint8_t  dataIncrement = 0;
+	int16_t  dataLastValue = 0;
+	uint64_t dataPackagesSent = 0, dataPackagesDropped = 0;
+
+	/* Initialise the communication system
+	 *********************************************************************************************/
+	GSBP_Init();
+	gCOM.NextCallbackTimer = HAL_GetTick() +callbackPeriodMS;
+	gsbpDebugMSG(3, "\n\n\nGSBP Development System started...\n##############################\n\n");
+
+	while (!doStop)
+	{
+		/*
+		 *  wait for bytes from the PC until the next timer expires -> the MCU would busy loop here
+		 */
+		uint64_t nowUs = HAL_GetTickUs();
+		uint64_t nextEventUs = (uint64_t)gCOM.NextCallbackTimer *1000;
+		if ((uint64_t)ledCounter *1000 < nextEventUs){
+			nextEventUs = (uint64_t)ledCounter *1000;
+		}
+		if (mcuState == measurementActive && dataCounterUs < nextEventUs){
+			nextEventUs = dataCounterUs;
+		}
+		if (mcuState != preInit && mcuState != postInit && mcuState != measurementActive){
+			nextEventUs = nowUs;
+		}
+		CDC_Sim_Poll((nextEventUs > nowUs) ? (uint32_t)(nextEventUs - nowUs) : 0);
+
+		/*
+		 *  run the low frequency LED code
+		 */
+		if (HAL_GetTick() >= ledCounter) {
+			ledCounter = HAL_GetTick() + LED_PERIOD_MS;
+			HAL_GPIO_TogglePin(LD3_GPIO_Port, LD3_Pin);
+		}
+
+		/*
+		 *  run the GSBP callback to check for new packages
+		 */
+		if (HAL_GetTick() >= gCOM.NextCallbackTimer) {
+			gCOM.NextCallbackTimer = HAL_GetTick() +callbackPeriodMS;
+			GSBP_CheckAndEvaluatePackages();
+		}
+
+		/*
+		 *  execute the global state machine
+		 */
+		switch (mcuState){
+		case preInit:
+			// do noting -> wait for the init command
+			break;
+
+		case doInit:{
+			// get the data of the initalisation CMD stored in gCOM.CMD
+			initCMD_t *cmd = (initCMD_t*)gCOM.CMD.Data;
+			// update the variables with the values from the CMD or the command line
+			dataCounterPeriodUs = (overridePeriodUs >= 0) ? (uint64_t)overridePeriodUs : (uint64_t)cmd->dataPeriodMS *1000;
+			dataSize = (overrideDataSize >= 0) ? (uint16_t)overrideDataSize : cmd->dataSize;
+			if (dataSize > GSBP_MEASURMENT_DATA_SIZE_MAX){
+				dataSize = GSBP_MEASURMENT_DATA_SIZE_MAX;
+			}
+			dataIncrement = cmd->increment;
+			dataLastValue = 0;
+
+			// prepare the init ACK
+			gCOM.ACK.CommandID = InitACK;
+			gCOM.ACK.RequestID = gCOM.CMD.RequestID;
+			initACK_t *ack = (initACK_t*)gCOM.ACK.Data;
+			ack->success = (dataSize != 0);
+			ack->dataPeriodMS = (uint16_t)(dataCounterPeriodUs /1000);
+			ack->dataSize = dataSize;
+			ack->increment = dataIncrement;
+			gCOM.ACK.DataSize = sizeof(initACK_t);
+			GSBP_SendPackage(gCOM.CMD.HandleOfThisCMD, &gCOM.ACK);
+
+			mcuState = postInit;
+			}
+			break;
+
+		case postInit:
+			// do noting -> wait for the start command
+			HAL_GPIO_TogglePin(LD3_GPIO_Port, LD3_Pin);
+			break;
+
+		case startMeasurement:
+			if (dataSize != 0){
+				dataCounterUs = HAL_GetTickUs() + dataCounterPeriodUs;
+				GSBP_SendUniversalACK(gCOM.CMD.HandleOfThisCMD, StartApplicationCMD, true);
+			} else {
+				// dataSize is 0 because the was no successful initialisation
+				GSBP_SendUniversalACK(gCOM.CMD.HandleOfThisCMD, StartApplicationCMD, false);
+			}
+			mcuState = measurementActive;
+			break;
+
+		case measurementActive:
+			// check if a new dummy measurement data package needs to be send
+			if (dataSize != 0 && HAL_GetTickUs() >= dataCounterUs){
+				// keep the configured rate; restart it, if the PC was more than 1 s behind
+				dataCounterUs += dataCounterPeriodUs;
+				if (HAL_GetTickUs() > dataCounterUs +1000000){
+					dataCounterUs = HAL_GetTickUs() + dataCounterPeriodUs;
+				}
+
+				gCOM.ACK.CommandID = ApplicationDataACK;
+				gCOM.ACK.RequestID = GSBP__REQUEST_ID_MEASUREMENT_DATA;
+				measurementDataACK_t *ack = (measurementDataACK_t*)gCOM.ACK.Data;
+				for (uint16_t i=0; i<dataSize; i++){
+					ack->data[i] = dataLastValue;
+					dataLastValue += dataIncrement;
+				}
+				ack->numberOfValues = dataSize;
+				gCOM.ACK.DataSize = sizeof(int16_t)*ack->numberOfValues +sizeof(uint16_t);
+				if (GSBP_SendPackage(gCOM.CMD.HandleOfThisCMD, &gCOM.ACK)){
+					dataPackagesSent++;
+				} else {
+					dataPackagesDropped++;
+				}
+			}
+			break;
+
+		case stopMeasurement:
+			GSBP_SendUniversalACK(gCOM.CMD.HandleOfThisCMD, StopApplicationCMD, true);
+			mcuState = postInit;
+			break;
+
+		case doDeInit:
+			dataSize = 0;
+			GSBP_SendUniversalACK(gCOM.CMD.HandleOfThisCMD, DeInitCMD, true);
+			mcuState = preInit;
+			break;
+
+		default:
+			mcuState = preInit;
+		}
+	}
+
+	printf("Simulator statistics:\n");
+	printf("   Bytes received = %llu, bytes send = %llu\n",
+			(unsigned long long)hUsbDeviceFS.BytesReceived, (unsigned long long)hUsbDeviceFS.BytesTransmitted);
+	printf("   Measurement data packages send = %llu (dropped: %llu)\n",
+			(unsigned long long)dataPackagesSent, (unsigned long long)dataPackagesDropped);
+	MX_USB_DEVICE_DeInit(LinkName);
+	return 0;
+}
+
+void Error_Handler(void)
+{
+}
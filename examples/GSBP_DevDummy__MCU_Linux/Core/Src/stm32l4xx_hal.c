@@ -0,0 +1,106 @@
+/*
+ * # GSBP MCU Simulator -> HAL Shim #
+ *   the parts of the STM32 HAL used by the GSBP MCU module and the
+ *   GSBP_DevDummy example, implemented for a Linux host
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    stm32l4xx_hal.c -> source file of the HAL shim (replaces the STM32 HAL)
+ *   Version: 1 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include "stm32l4xx_hal.h"
+
+static uint64_t StartTimeUs = 0;
+
+static uint64_t GetMonotonicUs(void)
+{
+	struct timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (uint64_t)Now.tv_sec *1000000 + Now.tv_nsec /1000;
+}
+
+/*
+ * SysTick -> the tick starts at 0 with HAL_Init(), like on the MCU
+ */
+void HAL_Init(void)
+{
+	StartTimeUs = GetMonotonicUs();
+}
+
+uint32_t HAL_GetTick(void)
+{
+	return (uint32_t)(HAL_GetTickUs() /1000);
+}
+
+uint64_t HAL_GetTickUs(void)
+{
+	return GetMonotonicUs() - StartTimeUs;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+	usleep(Delay *1000);
+}
+
+/*
+ * UART -> blocking write to the file descriptor of the handle
+ */
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	UNUSED(Timeout);
+	if (huart->fd < 0){
+		return HAL_OK;
+	}
+	while (Size > 0){
+		ssize_t BytesWritten = write(huart->fd, pData, Size);
+		if (BytesWritten < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			return HAL_ERROR;
+		}
+		pData += BytesWritten;
+		Size  -= BytesWritten;
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	// the simulator uses only the USB interface
+	UNUSED(huart);
+	UNUSED(pData);
+	UNUSED(Size);
+	UNUSED(Timeout);
+	return HAL_ERROR;
+}
+
+/*
+ * GPIO -> only the output register is kept
+ */
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	GPIOx->ODR ^= GPIO_Pin;
+}
@@ -0,0 +1,44 @@
+/*
+ * # GSBP MCU Simulator -> UART Shim #
+ *   the UART handles of the GSBP_DevDummy example,
+ *   implemented for a Linux host
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    usart.c -> source file of the UART shim
+ *   Version: 1 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include "usart.h"
+
+UART_HandleTypeDef huart2;
+
+/*
+ * USART2 is the debug UART -> the GSBP debug messages are written to stderr, if Verbose is set
+ */
+void MX_USART2_UART_Init(bool Verbose)
+{
+	huart2.fd = Verbose ? fileno(stderr) : -1;
+	huart2.RxXferSize = 0;
+	huart2.RxXferCount = 0;
+	huart2.gState = HAL_UART_STATE_READY;
+	huart2.ErrorCode = HAL_UART_ERROR_NONE;
+}
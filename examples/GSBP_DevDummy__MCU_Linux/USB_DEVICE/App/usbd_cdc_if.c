@@ -0,0 +1,204 @@
+/*
+ * # GSBP MCU Simulator -> USB CDC Shim #
+ *   the USB CDC device interface used by the GSBP MCU module,
+ *   implemented with a pseudo-terminal on a Linux host
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    usbd_cdc_if.c -> source file of the USB CDC shim (the virtual COM port is a PTY)
+ *   Version: 1 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include "usbd_cdc_if.h"
+#include "GSBP_Basic_Config.h"
+
+USBD_HandleTypeDef hUsbDeviceFS = {NULL, false, -1, 0, 0};
+static int fdSlave = -1;
+
+static void CDC_Receive_FS(uint8_t* Buf, uint32_t *Len);
+
+/*
+ * opens the PTY, which replaces the USB virtual COM port -> returns the name of the PTY slave (the device file for the PC)
+ * -> the slave is kept open, so the PTY stays usable while the PC program is not connected
+ */
+const char* MX_USB_DEVICE_Init(const char *LinkName)
+{
+	hUsbDeviceFS.fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (hUsbDeviceFS.fd < 0 || grantpt(hUsbDeviceFS.fd) != 0 || unlockpt(hUsbDeviceFS.fd) != 0){
+		printf("ERROR: Can't open a PTY: %s (%d)\n", strerror(errno), errno);
+		return NULL;
+	}
+	const char *SlaveName = ptsname(hUsbDeviceFS.fd);
+	fdSlave = open(SlaveName, O_RDWR | O_NOCTTY);
+	if (fdSlave < 0){
+		printf("ERROR: Can't open the PTY slave %s: %s (%d)\n", SlaveName, strerror(errno), errno);
+		return NULL;
+	}
+	// raw mode like a CDC device -> the PC program sets its own configuration anyway
+	struct termios Config;
+	tcgetattr(fdSlave, &Config);
+	cfmakeraw(&Config);
+	tcsetattr(fdSlave, TCSANOW, &Config);
+	fcntl(hUsbDeviceFS.fd, F_SETFL, fcntl(hUsbDeviceFS.fd, F_GETFL) | O_NONBLOCK);
+
+	if (LinkName != NULL){
+		unlink(LinkName);
+		if (symlink(SlaveName, LinkName) != 0){
+			printf("ERROR: Can't create the link %s: %s (%d)\n", LinkName, strerror(errno), errno);
+			return NULL;
+		}
+	}
+
+	// CDC_Init_FS() -> use the GSBP RxBuffer directly
+	USBD_CDC_SetRxBuffer(&hUsbDeviceFS, GSBP_USB.RxBuffer);
+	USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+	return SlaveName;
+}
+
+void MX_USB_DEVICE_DeInit(const char *LinkName)
+{
+	if (LinkName != NULL){
+		unlink(LinkName);
+	}
+	if (fdSlave >= 0){
+		close(fdSlave);
+		fdSlave = -1;
+	}
+	if (hUsbDeviceFS.fd >= 0){
+		close(hUsbDeviceFS.fd);
+		hUsbDeviceFS.fd = -1;
+	}
+}
+
+/*
+ * waits up to TimeoutUs for bytes from the PC and hands them to CDC_Receive_FS() in USB packet sized transfers
+ * -> like the USB OUT endpoint, nothing is read while no receive buffer is set up (USBD_CDC_ReceivePacket())
+ * returns true, if bytes were received
+ */
+bool CDC_Sim_Poll(uint32_t TimeoutUs)
+{
+	bool BytesReceived = false;
+	if (hUsbDeviceFS.fd < 0){
+		return false;
+	}
+	if (TimeoutUs > 0){
+		struct pollfd Fd = {hUsbDeviceFS.fd, POLLIN, 0};
+		struct timespec Timeout = {TimeoutUs /1000000, (TimeoutUs %1000000) *1000};
+		if (ppoll(&Fd, 1, &Timeout, NULL) <= 0){
+			return false;
+		}
+	}
+	while (hUsbDeviceFS.RxReady){
+		// space left in the GSBP RxBuffer
+		int32_t BytesFree = (int32_t)(&GSBP_USB.RxBuffer[GSBP_SETUP__RX_BUFFER_SIZE] - hUsbDeviceFS.RxBuffer);
+		if (BytesFree <= 0){
+			break;
+		}
+		ssize_t BytesRead = read(hUsbDeviceFS.fd, hUsbDeviceFS.RxBuffer, (BytesFree < CDC_SIM_PACKET_SIZE) ? BytesFree : CDC_SIM_PACKET_SIZE);
+		if (BytesRead <= 0){
+			break;
+		}
+		uint32_t Len = (uint32_t)BytesRead;
+		hUsbDeviceFS.BytesReceived += Len;
+		hUsbDeviceFS.RxReady = false;
+		BytesReceived = true;
+		CDC_Receive_FS(hUsbDeviceFS.RxBuffer, &Len);
+	}
+	return BytesReceived;
+}
+
+uint8_t USBD_CDC_SetRxBuffer(USBD_HandleTypeDef *pdev, uint8_t *pbuff)
+{
+	pdev->RxBuffer = pbuff;
+	return USBD_OK;
+}
+
+uint8_t USBD_CDC_ReceivePacket(USBD_HandleTypeDef *pdev)
+{
+	pdev->RxReady = true;
+	return USBD_OK;
+}
+
+/*
+ * CDC receive callback -> GSBP implementation 2 of GSBP_DevDummy__MCU_L432_USB:
+ * the GSBP RxBuffer is filled until GSBP_SaveBuffer() resets it
+ */
+static void CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
+{
+	UNUSED(Buf);
+	gsbpDebugMSG(7, "\nUSB RX: received %d bytes; IS size %d\n", *Len, GSBP_USB.RxBufferSize);
+
+	GSBP_USB.RxBufferSize += *Len;
+	GSBP_USB.State |= GSBP_HandleState__USBResetBuffer;
+	USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &GSBP_USB.RxBuffer[GSBP_USB.RxBufferSize]);
+	USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+}
+
+/*
+ * sends the buffer to the PC -> a transfer, which was started, is always completed
+ */
+uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len)
+{
+	gsbpDebugMSG(6, "USB TX: send %d bytes\n\n", Len);
+	if (hUsbDeviceFS.fd < 0){
+		return USBD_FAIL;
+	}
+	while (Len > 0){
+		ssize_t BytesWritten = write(hUsbDeviceFS.fd, Buf, Len);
+		if (BytesWritten < 0){
+			if (errno == EAGAIN){
+				struct pollfd Fd = {hUsbDeviceFS.fd, POLLOUT, 0};
+				poll(&Fd, 1, -1);
+				continue;
+			} else if (errno == EINTR){
+				continue;
+			}
+			return USBD_FAIL;
+		}
+		hUsbDeviceFS.BytesTransmitted += BytesWritten;
+		Buf += BytesWritten;
+		Len -= BytesWritten;
+	}
+	return USBD_OK;
+}
+
+/*
+ * the IN endpoint is busy while the PC does not read the PTY -> wait until the timeout (HAL_GetTick() value)
+ */
+uint8_t CDC_GSBP_WaitUntilReadyToSend(uint32_t timeout)
+{
+	struct pollfd Fd = {hUsbDeviceFS.fd, POLLOUT, 0};
+	while (poll(&Fd, 1, 0) == 0){
+		if (HAL_GetTick() >= timeout){
+			return USBD_BUSY;
+		}
+		usleep(100);
+	}
+	return USBD_OK;
+}
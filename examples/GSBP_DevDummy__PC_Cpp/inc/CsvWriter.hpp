@@ -0,0 +1,76 @@
+/*
+ * # Specific Device Interface #
+ *   C++ Interface class for the GSBP_DevDummy device,
+ *   utilizing the GSBP communication interface class.
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    CsvWriter.hpp -> Header file for the asynchronous CSV export
+ *   Version: 2 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DUMMYDEVICE_CSVWRITER_H
+#define DUMMYDEVICE_CSVWRITER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+#include "SampleRingBuffer.hpp"
+#include <boost/thread.hpp>
+
+#define CSV_SAMPLE_BUFFER_SIZE					(1 << 20)	// values buffered between the acquisition and the writer thread
+#define CSV_TEXT_BUFFER_SIZE					(1 << 20)	// bytes formatted before they are written to the file
+#define CSV_LINE_SIZE_MAX						32			// "+nnnnnnnnnn, +nnnnn\n"
+
+namespace nsDUMMYDEVICE_01 {
+
+/*
+ * writes the measurement values as CSV ("%+06d, %+5d\n" -> value number, value) on a writer thread
+ *  -> Write() only copies the values into a ring buffer and never waits for the disk
+ *  -> the writer thread formats large batches into a text buffer and writes it with one write() call
+ */
+class CsvWriter {
+public:
+	CsvWriter(void);
+	~CsvWriter(void);
+
+	bool	Open(const char *FileName);
+	uint32_t Write(const int16_t *Data, uint32_t NumberOfValues);
+	bool	Close(void);
+	uint64_t GetNumberOfDroppedValues(void);
+
+private:
+	int      fdFile;
+	SampleRingBuffer<int16_t> Samples;
+	char    *TextBuffer;
+	uint64_t LineNumber;					// writer thread
+	std::atomic<bool> Run;
+	std::atomic<bool> WriteError;
+	boost::thread WriterThread;
+
+	void	WriteLines(void);
+	bool	WriteText(size_t Size);
+};
+
+} // namespace
+
+#endif /* DUMMYDEVICE_CSVWRITER_H */
@@ -0,0 +1,185 @@
+/*
+ * # Specific Device Interface #
+ *   C++ Interface class for the GSBP_DevDummy device,
+ *   utilizing the GSBP communication interface class.
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    DataRecorder.hpp -> Header file for the binary measurement recording (writer and reader)
+ *   Version: 2 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DUMMYDEVICE_DATARECORDER_H
+#define DUMMYDEVICE_DATARECORDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <deque>
+#include <atomic>
+
+#include "GSBP_DevDummy.hpp"
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+using namespace ns_GSBP_DD_01;
+
+/*
+ * recording file layout (little endian):
+ *   recordingHeader_t                       -> written on Open(), updated on Close()
+ *   chunk 0: recordingChunkHeader_t + samples
+ *   chunk 1: ...
+ *   recordingIndexEntry_t[IndexEntries]     -> written on Close(); every IndexInterval-th chunk
+ * A recording, which was not closed (IndexOffset == 0), can still be read; the index is rebuilt from the chunk headers.
+ */
+#define RECORDING_MAGIC							"GSBPREC"
+#define RECORDING_VERSION						1
+#define RECORDING_CHUNK_MAGIC					0x4B4E4843	// "CHNK"
+#define RECORDING_CHUNK_SIZE_DEFAULT			16384		// samples per chunk
+#define RECORDING_INDEX_INTERVAL				16			// chunks per index entry
+#define RECORDING_NODE_INFO_MSG_SIZE			128
+#define RECORDING_WRITE_BUFFERS					8			// chunks in flight to the writer thread
+
+namespace nsDUMMYDEVICE_01 {
+
+typedef enum {
+	RecordingSampleInt16 = 1,
+} recordingSampleType_t;
+
+typedef struct __packed {
+	char     magic[8];
+	uint16_t version;
+	uint16_t headerSize;
+	uint8_t  sampleType;					// recordingSampleType_t
+	uint8_t  sampleSize;					// bytes per sample
+	uint16_t indexInterval;
+	double   sampleRateHz;
+	int64_t  startTimeUs;					// unix time
+	uint64_t numberOfSamples;				// valid after Close()
+	uint64_t numberOfChunks;				// valid after Close()
+	uint64_t indexOffset;					// file offset of the index; 0 -> the recording was not closed
+	uint64_t indexEntries;
+	// device info (NodeInfo)
+	uint64_t boardID;
+	uint16_t deviceClass;
+	uint32_t serialNumber;
+	uint8_t  versionProtocol[2];
+	uint8_t  versionFirmware[2];
+	uint8_t  nodeInfoMsg[RECORDING_NODE_INFO_MSG_SIZE];
+} recordingHeader_t;
+
+typedef struct __packed {
+	uint32_t magic;							// RECORDING_CHUNK_MAGIC
+	uint32_t numberOfSamples;
+	uint64_t firstSample;					// number of the first sample in the recording
+	int64_t  timestampUs;					// unix time of the first sample
+} recordingChunkHeader_t;
+
+typedef struct __packed {
+	uint64_t firstSample;
+	int64_t  timestampUs;
+	uint64_t fileOffset;					// file offset of the chunk header
+} recordingIndexEntry_t;
+
+
+/*
+ * writes a recording -> Write() only copies the samples into the current chunk,
+ * the full chunks are written to disk by a background thread
+ */
+class DataRecorder {
+public:
+	DataRecorder(void);
+	~DataRecorder(void);
+
+	bool	Open(const char *FileName, GSBP_DD::gsbp_ACK_nodeInfo_t *NodeInfo, double SampleRateHz, uint32_t ChunkSize);
+	bool	Write(const int16_t *Data, uint32_t NumberOfValues);
+	bool	Close(void);
+	uint64_t GetNumberOfSamples(void);
+
+private:
+	struct chunkBuffer_t {
+		std::vector<uint8_t> Data;			// recordingChunkHeader_t + samples
+		uint32_t NumberOfSamples;
+	};
+	int      fdFile;
+	recordingHeader_t Header;
+	uint32_t ChunkSize;
+	uint64_t NumberOfSamples;
+	uint64_t NumberOfChunks;
+	uint64_t FileOffset;					// end of the queued chunks
+	std::atomic<bool> WriteError;			// set by the writer thread
+	std::vector<recordingIndexEntry_t> Index;
+	chunkBuffer_t *CurrentChunk;
+	// writer thread
+	boost::thread WriterThread;
+	boost::mutex Queue_mutex;
+	boost::condition_variable QueueCondition;
+	boost::condition_variable FreeCondition;
+	std::deque<chunkBuffer_t*> FullChunks;
+	std::vector<chunkBuffer_t*> FreeChunks;
+	std::vector<chunkBuffer_t*> AllChunks;
+	bool     Run;
+
+	void	StartChunk(void);
+	void	QueueChunk(void);
+	void	WriteChunks(void);
+	void	ReleaseChunks(void);
+};
+
+
+/*
+ * reads a recording -> the file is memory-mapped, the samples are used in place
+ */
+class DataRecording {
+public:
+	DataRecording(void);
+	~DataRecording(void);
+
+	bool	Open(const char *FileName);
+	void	Close(void);
+	const recordingHeader_t* GetHeader(void);
+	uint64_t GetNumberOfSamples(void);
+	uint64_t GetNumberOfChunks(void);
+	const int16_t* GetChunk(uint64_t Chunk, uint32_t *NumberOfSamples, uint64_t *FirstSample, int64_t *TimestampUs);
+	uint64_t FindChunkBySample(uint64_t Sample);
+	uint64_t FindChunkByTime(int64_t TimestampUs);
+	uint64_t ReadSamples(uint64_t FirstSample, int16_t *Data, uint64_t NumberOfValuesMax);
+
+private:
+	int      fdFile;
+	uint8_t *Map;
+	size_t   MapSize;
+	const recordingHeader_t *Header;
+	uint64_t NumberOfSamples;
+	uint64_t NumberOfChunks;
+	uint64_t DataEnd;						// end of the chunk area
+	std::vector<recordingIndexEntry_t> Index;
+
+	bool	RebuildIndex(void);
+	const recordingChunkHeader_t* GetChunkHeader(uint64_t Chunk);
+	const recordingChunkHeader_t* NextChunkHeader(const recordingChunkHeader_t *Chunk);
+	const recordingChunkHeader_t* ChunkAt(uint64_t Offset);
+};
+
+} // namespace
+
+#endif /* DUMMYDEVICE_DATARECORDER_H */
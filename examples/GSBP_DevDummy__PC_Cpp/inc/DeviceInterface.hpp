@@ -50,11 +50,14 @@
 #include <unistd.h>
 
 #include "GSBP_DevDummy.hpp"
-#include <boost/thread/mutex.hpp>
+#include "SampleRingBuffer.hpp"
 
 using namespace ns_GSBP_DD_01;
 #define DUMMYDEVICE_STATUS_MSG_SIZE_MAX			1024
 #define DUMMYDEVICE_PAYLOAD_SIZE_MAX			512
+#define DUMMYDEVICE_DATA_BUFFER_SIZE			65536	// measurement values buffered between the receiver and GetData()
+
+const uint32_t GSBP_DeviceClass__GSBPdevel		= 1;
 
 /*
  * DummyDevice name space
@@ -134,6 +137,7 @@ typedef struct __packed {
 class DummyDevice {
 public:
 	DummyDevice(const char *DeviceID, const char *SerialDeviceFile);
+	DummyDevice(const char *DeviceID, int DeviceFd);
 	~DummyDevice(void);
 
     bool    IsDeviceConnected(void);
@@ -146,6 +150,11 @@ public:
 	bool	StartMCUApplication(void);
 	bool 	StartMCUApplication(uint16_t* ErrorCode);
 	uint16_t GetData(int16_t Data[], uint16_t NumberOfValuesMax);
+	uint32_t WaitForData(uint32_t NumberOfValues, uint32_t TimeoutMs);
+	uint32_t BorrowData(const int16_t **Data, uint32_t NumberOfValuesMax);
+	bool	ReleaseData(uint32_t NumberOfValues);
+	void	SetDataOverflowPolicy(overflowPolicy_t Policy, uint32_t BlockTimeoutMs);
+	void	GetDataStatistics(ringStatistics_t *Statistics);
 	bool	StopMCUApplication(void);
 	bool 	StopMCUApplication(uint16_t* ErrorCode);
 	bool 	DeinitialiseMCU(void);
@@ -157,16 +166,18 @@ private:
 	char DeviceIDClass[100];
 	char DeviceFileName[255];
 	bool DeviceInitialised;
-	uint16_t NumberOfDataValues;
-	int16_t DataValues[50000];
-	boost::mutex DataMutex;
+	SampleRingBuffer<int16_t> DataBuffer; // written by the GSBP receiver, read by GetData()
 
 	/*
 	 * private functions
 	 */
 
+	GSBP_DD::gsbpConfiguration_t GetInterfaceConfiguration(void);
+	void		SubscribeToData(void);
+
 	// GSBP callback functions
 	bool 	 	PackageHandler(GSBP_DD::rxPackage_t *Package, uint64_t RequestID);
+	void		MeasurementDataHandler(GSBP_DD::rxPackage_t *Package);
 	const char*	GetCommandIdString(uint16_t Cmd);
 	const char*	GetErrorString(uint16_t ErrorCode);
 };
@@ -0,0 +1,142 @@
+/*
+ * # Specific Device Interface #
+ *   C++ Interface class for the GSBP_DevDummy device,
+ *   utilizing the GSBP communication interface class.
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    FakeDevice.hpp -> Header file for the in-memory fake of the GSBP_DevDummy MCU
+ *   Version: 2 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DUMMYDEVICE_FAKEDEVICE_H
+#define DUMMYDEVICE_FAKEDEVICE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include <atomic>
+
+#include "DeviceInterface.hpp"
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+/*
+ * The fake device speaks the GSBP_DevDummy protocol on one end of a socketpair(); the other end is passed to
+ * DummyDevice(ID, fd) or GSBP_DD::ConnectToDevice(fd, ...). No serial device, no MCU and no scheduler jitter of a
+ * PTY is involved -> request and data paths can be benchmarked at memory speed and with reproducible timing.
+ *
+ *   FakeDevice Fake;
+ *   Fake.SetCommandBehaviour(StatusCMD, FakeAnswer, 200);	// answer the StatusCMD after 200us
+ *   DummyDevice Device("Fake", Fake.Open());
+ */
+#define FAKEDEVICE_SERIAL_NUMBER				1904010001
+#define FAKEDEVICE_NODE_INFO_MSG				"GSBP_DevDummy FAKE DEVICE"
+#define FAKEDEVICE_RX_BUFFER_SIZE				65536
+#define FAKEDEVICE_SOCKET_BUFFER_SIZE			(1024*1024)	// bytes buffered by the transport in each direction
+
+namespace nsDUMMYDEVICE_01 {
+
+// reaction to a received command
+typedef enum {
+	FakeAnswer			= 0,	// send the response of the GSBP_DevDummy MCU
+	FakeIgnore			= 1,	// do not answer -> the request times out on the PC side
+	FakeErrorMessage	= 2,	// answer with a MessageACK (MsgError, E_CMD_NotValidNow)
+	FakeEcho			= 3,	// answer with the ID CommandID+1 and the received payload (for commands the MCU does not know)
+} fakeAction_t;
+
+// values of the ApplicationDataACK stream
+typedef enum {
+	FakeDataRamp		= 0,	// value += increment of the InitCMD (like the MCU)
+	FakeDataConstant	= 1,	// value = Parameter
+	FakeDataRandom		= 2,	// pseudo random values; Parameter is the seed -> same sequence for every run
+} fakeDataPattern_t;
+
+typedef struct {
+	uint64_t CommandsReceived;
+	uint64_t CommandsIgnored;
+	uint64_t ResponsesSent;
+	uint64_t DataPackagesSent;
+	uint64_t DataValuesSent;
+	uint64_t BytesReceived;
+	uint64_t BytesSent;
+	uint64_t FramingErrors;		// bytes skipped while searching for a start byte
+} fakeDeviceStatistics_t;
+
+
+class FakeDevice {
+public:
+	FakeDevice(void);
+	~FakeDevice(void);
+
+	int		Open(void);
+	void	Close(void);
+	void	SetCommandBehaviour(uint16_t CommandID, fakeAction_t Action, uint32_t LatencyUs);
+	void	SetDefaultLatency(uint32_t LatencyUs);
+	void	SetDataPattern(fakeDataPattern_t Pattern, int16_t Parameter);
+	void	SetDataRate(uint32_t PeriodUs, uint16_t ValuesPerPackage);
+	void	SetDataLimit(uint64_t NumberOfPackages);
+	void	GetStatistics(fakeDeviceStatistics_t *Statistics);
+
+private:
+	struct behaviour_t {
+		fakeAction_t Action;
+		uint32_t     LatencyUs;
+	};
+	int      fdDevice;						// device end of the socketpair
+	int      fdInterface;					// interface end -> handed out by Open(); closed by the GSBP interface
+	boost::thread DeviceThread;
+	std::atomic<bool> Run;					// cleared by Close() or a failed send -> stops the device thread
+	boost::mutex Config_mutex;				// everything below, which can be changed while the device runs
+	std::map<uint16_t, behaviour_t> Behaviour;
+	uint32_t DefaultLatencyUs;
+	fakeDataPattern_t DataPattern;
+	int16_t  DataParameter;
+	uint32_t DataPeriodUs;					// 0 -> use the period of the InitCMD
+	uint16_t ValuesPerPackage;				// 0 -> use the data size of the InitCMD
+	uint64_t DataLimit;						// 0 -> unlimited
+	fakeDeviceStatistics_t Statistics;
+
+	// device state; only used by the device thread
+	std::multimap<uint64_t, std::vector<uint8_t> > PendingResponses;	// due time [us] -> frame
+	uint8_t  RxBuffer[FAKEDEVICE_RX_BUFFER_SIZE];
+	uint32_t RxBufferLevel;
+	uint8_t  State;							// like mcuState of the MCU example: 0 = preInit, 2 = postInit, 4 = measurementActive
+	initCMD_t InitConfig;
+	int16_t  DataValue;
+	uint32_t RandomState;
+	uint64_t NextDataUs;
+	uint64_t DataPackagesSent;
+
+	void	DeviceLoop(void);
+	void	DecodeFrames(void);
+	void	HandleCommand(uint8_t CommandID, uint8_t RequestID, const uint8_t *Data, uint16_t DataSize);
+	void	QueueResponse(uint8_t AckID, uint8_t RequestID, const void *Data, uint16_t DataSize, uint64_t DueUs);
+	void	QueueMessage(uint8_t RequestID, uint16_t ErrorCode, const char *Message, uint64_t DueUs);
+	bool	SendBytes(const uint8_t *Data, size_t Size);
+	bool	SendData(void);
+	int16_t	NextValue(void);
+};
+
+} // namespace
+
+#endif /* DUMMYDEVICE_FAKEDEVICE_H */
@@ -37,22 +37,47 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <termios.h>
+#include <sys/uio.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <time.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
 #include <math.h>
 
 #include <functional>
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <sstream>
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+#include <coroutine>
+#define GSBP__HAS_COROUTINES								1
+#endif
 
 #include "boost/date_time/posix_time/posix_time.hpp"
 #include <boost/circular_buffer.hpp>
 //#define  BOOST_CB_ENABLE_DEBUG							1
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/thread/thread.hpp>
 
 
 // ### GSBP SETUP ###
 
-// Debug Support
+// Debug Support -> the initial debug categories; they can be changed at runtime with SetDebugCategories()
 #define GSBP__DEBUG_SENDING_COMMANDS                    	0
 #define GSBP__DEBUG_RECEIVING_COMMANDS                  	0
 #define GSBP__DEBUG_RECEIVING_COMMANDS_EXEPT_MEAS_ACKS  	0
@@ -63,6 +88,8 @@
 #define GSBP__DEBUG_REQUEST_AND_RESPONSE_BUFFER_ALL			0
 #define GSBP__DEBUG_REQUEST_AND_RESPONSE_BUFFER_PACKAGES 	0
 
+#define GSBP__UNLIKELY(Condition)							__builtin_expect(!!(Condition), 0)
+
 // Communication Payload
 const uint32_t gsbp_TxMaxUserDataSize						= 3000; // max amount of data (bytes) send in one package
 const uint32_t gsbp_RxMaxUserDataSize						= 3000; // max amount of data (bytes) received in one package
@@ -90,13 +117,44 @@ const uint32_t gsbp_AdditionalTimeOutForMcuDebuging			= 500;
 const uint32_t gsbp_PackageReadTimoutUs             		= 11000; // important timeout to detect  a if not every byte of a package is received and to check if the ReadPackage function should terminate
 
 const uint32_t gsbp_ErrorStringSize     					= 100;
-const uint32_t gsbp_RequestResponceBufferSize				= 500;
+const uint32_t gsbp_PayloadPoolSizeClasses					= 5;   // number of buffer sizes used by the payload pool (see GSBP_DevDummy.cpp)
+const uint32_t gsbp_RequestTableSize						= 256; // one entry per 8 bit local request ID
+const uint32_t gsbp_DuplicateResponseBufferSize				= 32;  // additional responses received for an already answered request
+const uint32_t gsbp_MaxRequestIdLocal						= 254; // 0 and 255 (measurement data) are never used as request ID
 
 const uint32_t gsbp_MaxGsbpHeaderSize						= 50; //max 50 byte for the package overhead
 const uint32_t gsbp_TxMaxPackageSize						= (gsbp_TxMaxUserDataSize + gsbp_MaxGsbpHeaderSize);
 const uint32_t gsbp_RxMaxPackageSize						= (gsbp_RxMaxUserDataSize + gsbp_MaxGsbpHeaderSize);
 const uint32_t gsbp_MaxErrorCodeNumber     					= 32;
 
+const uint32_t gsbp_TxMaxPackagesPerWrite					= 64;   // max amount of queued packages written with one writev() call
+
+#if GSBP__ACTIVATE_16BIT_CMD_FEATURE
+const uint32_t gsbp_CommandIdTableSize						= 65536; // one package handler entry per CMD/ACK ID
+#else
+const uint32_t gsbp_CommandIdTableSize						= 256;
+#endif
+const uint32_t gsbp_LatencySubBucketBits					= 4;    // round-trip histograms: 16 buckets per power of two -> max. 6.25 % error
+const uint32_t gsbp_LatencyMaxExponent						= 36;   // round trips longer than 2^37 ns (~137 s) are counted in the last bucket
+const uint32_t gsbp_LatencyBuckets							= (gsbp_LatencyMaxExponent - gsbp_LatencySubBucketBits + 2) << gsbp_LatencySubBucketBits;
+const uint32_t gsbp_LogRingSize								= 256;  // log records buffered for the log thread; must be a power of 2
+const uint32_t gsbp_LogMessageSize							= 512;
+const uint32_t gsbp_LogFlushIntervalMs						= 10;
+const uint32_t gsbp_DefaultLogRateLimit						= 20;   // messages per second and log site
+const uint32_t gsbp_TraceRingSize							= 16384; // trace events per thread; the oldest events are overwritten; must be a power of 2
+const uint32_t gsbp_TraceRingsPerThread						= 4;    // interfaces traced at the same time by one thread without registering a new ring
+const uint32_t gsbp_MetricsSocketBacklog					= 4;
+const uint32_t gsbp_MetricsRequestTimeoutMs					= 50;   // the metrics socket waits this long for a HTTP request line
+const uint32_t gsbp_HandlerQueueSize						= 1024; // max amount of packages queued for one package handler thread
+const uint32_t gsbp_DefaultNumberOfHandlerThreads			= 0;    // the receiver thread calls the PackageHandler; handler threads only on request
+
+const uint32_t gsbp_RxChunkSize								= 4096; // max amount of bytes read from the device with one read() call
+const uint32_t gsbp_RxRingBufferSize						= 8192; // receive ring buffer for partial packages; must be a power of two and larger than gsbp_RxMaxPackageSize
+
+const uint32_t gsbp_CaptureRingSize							= 4194304; // bytes buffered per direction between the device I/O and the capture writer; must be a power of two
+const uint32_t gsbp_CaptureWriteBufferSize					= 262144;  // pcapng blocks collected before they are written to the capture file
+const uint16_t gsbp_CaptureLinkType							= 147;     // pcapng link type of the captured bytes (LINKTYPE_USER0)
+
 namespace ns_GSBP_DD_01 {
 
     class GSBP_DD
@@ -114,17 +172,26 @@ namespace ns_GSBP_DD_01 {
 			GSBP_OpeningTheDeviceFailed			= 5,
 			GSBP_NodeInfoWasNotReceived			= 6,
 			GSBP_DeviceClassDoesNotMatch		= 7,
+			GSBP_WritingToDeviceFailed			= 8,
+			GSBP_ReceiverThreadNotRunning		= 9,
+			GSBP_InvalidSubscription			= 10,
             UnknownCMDError                     = 11,
             ChecksumMissmatchError              = 12,
             EndByteMissmatchError               = 13,
             UARTSizeMissmatchError              = 14,
+			GSBP_CaptureFailed					= 15,
+			GSBP_ReplayFailed					= 16,
+			GSBP_MetricsFailed					= 17,
+			GSBP_TraceFailed					= 18,
             GSBP_Error__CMD_NotValidNow         = 20,
             MaxGSBP_ErrorEnumIDs                = gsbp_MaxErrorCodeNumber
         };
 
         // Misc definitions
         enum misc_t {
-        	InvalidRequestID					= 0
+        	InvalidRequestID					= 0,
+        	MeasurementDataRequestID			= 255,	// local request ID of unrequested measurement data
+        	SubscribeToAnyID					= 0		// see Subscribe()
         };
 
     	// RX package -> receiving
@@ -153,7 +220,7 @@ namespace ns_GSBP_DD_01 {
             #if GSBP__ACTIVATE_SOURCE_FEATURE || GSBP__ACTIVATE_SOURCE_DESTINATION_FEATURE
             uint8_t         Source;                         // source
             #endif
-            uint32_t        DataSize;                     	// user payload size
+            uint32_t        DataSize;                       // user payload size
             unsigned char   Data[gsbp_TxMaxUserDataSize];	// user payload
         };
 
@@ -167,6 +234,147 @@ namespace ns_GSBP_DD_01 {
         	uint8_t  msg[gsbp_RxMaxUserDataSize];
         };
 
+        // wire capture statistics -> see StopCapture()
+        struct captureStatistics_t {
+        	uint64_t ChunksCaptured;			// read()/writev() calls captured
+        	uint64_t BytesCaptured;
+        	uint64_t ChunksDropped;				// not captured, as the capture writer was behind
+        };
+
+        // replay statistics -> see ReplayCapture()
+        struct replayStatistics_t {
+        	uint64_t ChunksReplayed;
+        	uint64_t BytesReplayed;
+        	uint64_t PackagesDecoded;
+        	double   Seconds;
+        	double   PackagesPerSecond;
+        	double   MegaBytesPerSecond;
+        };
+
+        // round-trip latency of one CMD ID (send of the command to its first response) -> see GetLatencySnapshot()
+        struct latencySnapshot_t {
+        	uint16_t CommandID;
+        	uint64_t Count;
+        	uint64_t MinNs;
+        	uint64_t MaxNs;
+        	double   MeanNs;
+        	uint64_t P50Ns;						// percentiles -> upper bound of the histogram bucket
+        	uint64_t P90Ns;
+        	uint64_t P99Ns;
+        	uint64_t P999Ns;
+        };
+
+        // debug categories -> see SetDebugCategories()
+        enum debugCategory_t {
+        	DebugSendingCommands				= 0x0001,	// print every package send
+        	DebugReceivingCommands				= 0x0002,	// print every package received
+        	DebugReceivingExceptMeasurementAcks	= 0x0004,	// do not print the ApplicationDataACK packages
+        	DebugMcuAndIncreaseTimeouts			= 0x0008,	// add gsbp_AdditionalTimeOutForMcuDebuging to the timeouts of requests send afterwards
+        	DebugGsbpStats						= 0x0010,	// print the statistics when the interface is destroyed
+        	DebugSerialActions					= 0x0020,	// print opening/closing the device
+        	DebugRequestResponseBuffer			= 0x0040,	// print unrequested responses and the buffer when the interface is destroyed
+        	DebugRequestResponseBufferAll		= 0x0080,	// ... with the claimed entries
+        	DebugRequestResponseBufferPackages	= 0x0100,	// ... with the package content
+        };
+
+        // log messages -> see SetLogSink()
+        enum logSeverity_t {
+        	LogDebug							= 0,
+        	LogInfo								= 1,
+        	LogWarning							= 2,
+        	LogError							= 3,
+        	LogOff								= 4,	// only for SetLogLevel()
+        };
+        enum logSite_t {
+        	LogSiteRead							= 0,	// reading the device
+        	LogSiteDecoder						= 1,	// searching the package header
+        	LogSiteBuildPackage					= 2,
+        	LogSiteMessageDebug					= 3,	// MessageACK received from the device
+        	LogSiteMessageWarning				= 4,
+        	LogSiteMessageError					= 5,
+        	LogSiteNodeInfo						= 6,
+        	LogSiteWrite						= 7,	// writing the device
+        	LogSiteCapture						= 8,	// capture and replay files
+        	NumberOfLogSites					= 9,
+        };
+        struct logRecord_t {
+        	uint64_t      TimeNs;				// wall clock
+        	logSeverity_t Severity;
+        	logSite_t     Site;
+        	uint32_t      Suppressed;			// messages of this site dropped by the rate limit or a full ring before this one
+        	char          Message[gsbp_LogMessageSize];	// without the device ID; can contain line breaks
+        };
+        typedef std::function<void(const logRecord_t*)> logSink_t;
+        struct logStatistics_t {
+        	uint64_t Logged;					// handed to the sink
+        	uint64_t RateLimited;				// dropped by the rate limit of the log site
+        	uint64_t Dropped;					// dropped, as the log ring was full
+        };
+
+        // trace statistics -> see StopTrace()
+        struct traceStatistics_t {
+        	uint64_t Events;					// written to the trace file
+        	uint64_t EventsOverwritten;			// lost, as the ring of the thread was full
+        	uint32_t Threads;
+        };
+
+        // counters and gauges of the interface -> see GetMetrics()
+        struct metrics_t {
+        	double   UptimeSeconds;
+        	uint64_t RxPackages;
+        	uint64_t RxBytes;
+        	uint64_t RxPackagesMissing;			// requests without response
+        	uint64_t RxPackagesBrokenChecksum;
+        	uint64_t RxPackagesBrokenStructure;
+        	uint64_t RxBytesDiscarded;
+        	uint64_t TxPackages;
+        	uint64_t TxBytes;
+        	uint64_t HandlerCalls;				// packages handed to the package handlers
+        	uint64_t HandlerTimeNs;				// sum of the time spend in the package handlers
+        	uint64_t HandlerTimeNsMax;
+        	uint64_t HandlerQueueFull;			// the receiver thread had to wait for a handler thread
+        	// gauges
+        	uint32_t RequestsInFlight;			// send, but no response received and not timed out
+        	uint32_t UnclaimedRequestResponces;
+        	uint32_t DuplicateResponses;		// entries in the duplicate response buffer
+        	uint32_t AsyncRequests;				// open asynchronous requests
+        	uint32_t HandlerQueueDepth;			// packages waiting for a handler thread
+        	uint32_t TxQueueDepth;				// packages queued by the sending threads, but not yet written
+        	uint32_t RxRingLevel;				// bytes in the decoder ring, which are not yet part of a complete package
+        	uint32_t LogBacklog;				// log records waiting for the log thread
+        };
+
+        // lock statistics -> see EnableLockStatistics()
+        struct lockStatistics_t {
+        	uint64_t Acquisitions;
+        	uint64_t Contended;					// acquisitions, which had to wait for another thread
+        	uint64_t WaitNs;					// sum of the wait times
+        	uint64_t WaitNsMax;
+        	uint64_t HoldNs;					// sum of the hold times; a condition wait does not count as hold time
+        	uint64_t HoldNsMax;
+        };
+
+        // pipelined request -> see SendPackagesPipelined()
+        struct pipelineRequest_t {
+        	txPackage_t* Cmd;					// package to send
+        	uint16_t     AckId;					// expected response; 0 = any response
+        	rxPackage_t* Ack;					// received response; can be NULL if the response is not needed
+        	uint64_t     RequestID;				// result: global request ID; 0 if the package was not send
+        	bool         ResponseReceived;		// result
+        	uint16_t     ErrorCode;				// result: GSBP error or the error code of a received error message
+        };
+
+        // result of an asynchronous request -> see SendPackageAsync()
+        struct asyncResponse_t {
+        	uint64_t     RequestID;				// global request ID; 0 if the package was not send
+        	bool         ResponseReceived;
+        	uint16_t     ErrorCode;				// GSBP error or the error code of a received error message
+        	rxPackage_t  Ack;
+        };
+
+        // package handler -> returns true if the package was handled and the response can be removed
+        typedef std::function<bool(GSBP_DD::rxPackage_t*, uint64_t)> packageHandler_t;
+
         // configuration and callback's, which need to be implemented by the upper device class
         struct gsbpConfiguration_t {
         	bool UpdateDeviceID;
@@ -181,21 +389,84 @@ namespace ns_GSBP_DD_01 {
         	uint16_t ApplicationDataACK_ID;
         	bool DisplayWarnings;
         	bool DisplayErrors;
+        	uint32_t ResponseSpinTimeUs;		// GetResponse busy-waits this long before it blocks; 0 = block immediately
+        	uint32_t NumberOfHandlerThreads;	// threads calling the PackageHandler; 0 = the receiver thread calls it
         };
 
         /* Public Functions */
         GSBP_DD(void);
         GSBP_DD(char* DeviceID);
         GSBP_DD(char* DeviceID, char* DeviceFileName, uint16_t DeviceClass, gsbpConfiguration_t Config);
+        GSBP_DD(char* DeviceID, int DeviceFd, uint16_t DeviceClass, gsbpConfiguration_t Config);
         ~GSBP_DD(void);
 
         bool      IsDeviceConnected(void);
         bool      ConnectToDevice(char* DeviceFileName, uint16_t DeviceClass, bool UseThreadToRead, uint16_t* ErrorCode);
+        bool      ConnectToDevice(int DeviceFd, uint16_t DeviceClass, bool UseThreadToRead, uint16_t* ErrorCode);
         bool	  UpdateConfiguration(gsbpConfiguration_t Config, uint16_t* ErrorCode);
         bool	  GetNodeInfo(gsbp_ACK_nodeInfo_t* NodeInfo, bool PrintNodeInfo, uint16_t* ErrorCode);
         uint64_t  SendPackage(txPackage_t* P, uint16_t* ErrorCode);
     	bool 	  GetResponse(uint64_t RequestId, uint16_t AckId, rxPackage_t* ACK, int MilliSecondsToWait, uint32_t* NumberOfOpenRequests, uint16_t* ErrorCode);
+    	uint64_t  SendPackageAsync(txPackage_t* P, uint16_t AckId, int MilliSecondsToWait, std::function<void(asyncResponse_t*)> Callback);
+    	std::future<asyncResponse_t> SendPackageAsync(txPackage_t* P, uint16_t AckId, int MilliSecondsToWait);
+    	bool      SendPackagesPipelined(pipelineRequest_t* Requests, uint32_t NumberOfRequests, uint32_t WindowSize, int MilliSecondsToWait, uint32_t* NumberOfFailedRequests);
+    	uint32_t  Subscribe(uint16_t CommandID, uint8_t RequestID, std::function<void(rxPackage_t*)> Sink, uint16_t* ErrorCode);
+    	bool      Unsubscribe(uint32_t SubscriptionID, uint16_t* ErrorCode);
+    	bool      SetPackageHandler(uint16_t CommandID, packageHandler_t Handler, uint16_t* ErrorCode);
+    	bool      SetPackageHandlers(std::vector< std::pair<uint16_t, packageHandler_t> > Handlers, bool RemoveOtherHandlers, uint16_t* ErrorCode);
     	bool      DisconnectFromDevice(uint16_t* ErrorCode);
+    	bool      StartCapture(const char* FileName, uint16_t* ErrorCode);
+    	bool      StopCapture(captureStatistics_t* Statistics, uint16_t* ErrorCode);
+    	bool      ReplayCapture(const char* FileName, bool RealTime, replayStatistics_t* Statistics, uint16_t* ErrorCode);
+    	bool      GetLatencySnapshot(uint16_t CommandID, latencySnapshot_t* Snapshot);
+    	std::vector<latencySnapshot_t> GetLatencySnapshots(void);
+    	void      ResetLatencyHistograms(void);
+    	void      EnableLockStatistics(bool Enable);
+    	void      SetDebugCategories(uint32_t Categories);
+    	void      EnableDebugCategory(debugCategory_t Category, bool Enable);
+    	uint32_t  GetDebugCategories(void);
+    	void      SetLogSink(logSink_t Sink);
+    	void      SetLogLevel(logSeverity_t MinimumSeverity);
+    	void      SetLogRateLimit(uint32_t MessagesPerSecond);
+    	void      FlushLog(void);
+    	void      GetLogStatistics(logStatistics_t* Statistics, bool Reset);
+    	bool      StartTrace(uint16_t* ErrorCode);
+    	bool      StopTrace(const char* FileName, traceStatistics_t* Statistics, uint16_t* ErrorCode);
+    	void      GetMetrics(metrics_t* Metrics);
+    	std::string GetMetricsText(void);
+    	bool      WriteMetrics(const char* FileName, uint16_t* ErrorCode);
+    	bool      StartMetricsSocket(const char* SocketPath, uint16_t* ErrorCode);
+    	bool      StopMetricsSocket(uint16_t* ErrorCode);
+    	void      GetLockStatistics(lockStatistics_t* RequestResponseLock, lockStatistics_t* ReadPackageLock, bool Reset);
+
+#if GSBP__HAS_COROUTINES
+    	// awaitable asynchronous request -> co_await Interface->SendPackageAwaitable(...) returns the asyncResponse_t
+    	struct responseAwaitable_t {
+    		GSBP_DD*    Interface;
+    		txPackage_t* P;
+    		uint16_t     AckId;
+    		int          MilliSecondsToWait;
+    		asyncResponse_t   Result;
+    		std::atomic<bool> Completed;		// set by the first of await_suspend() and the callback; the second one continues
+
+    		bool await_ready(void) { return false; }
+    		bool await_suspend(std::coroutine_handle<> Handle)
+    		{
+    			this->Interface->SendPackageAsync(this->P, this->AckId, this->MilliSecondsToWait, [this, Handle](asyncResponse_t* Response){
+    				this->Result = *Response;
+    				if (this->Completed.exchange(true)){
+    					Handle.resume();
+    				}
+    			});
+    			return !this->Completed.exchange(true);
+    		}
+    		asyncResponse_t await_resume(void) { return this->Result; }
+    	};
+    	responseAwaitable_t SendPackageAwaitable(txPackage_t* P, uint16_t AckId, int MilliSecondsToWait)
+    	{
+    		return responseAwaitable_t{this, P, AckId, MilliSecondsToWait, {}, {false}};
+    	}
+#endif
 
     	const char* GetGsbpErrorString(uint16_t ErrorCode);
         void      PrintPackage(txPackage_t* Package);
@@ -218,6 +489,15 @@ namespace ns_GSBP_DD_01 {
     		PackageIsOk                          = 128
     	};
 
+    	// package of a request/response element -> only the meta data, the payload is kept in the payload pool
+    	struct packageInfo_t {
+    		uint16_t CommandID;
+    		uint8_t  State;
+    		uint8_t  RequestID;
+    		uint32_t DataSize;
+    		uint8_t* Data;						// payload buffer from the payload pool; NULL if there is no payload
+    	};
+
     	// request/response element
     	struct RequestResponse_t {
             uint8_t  RequestIdLocal;      		// raw request ID (8 bit); info
@@ -228,37 +508,50 @@ namespace ns_GSBP_DD_01 {
     		bool WaitForResponce;
     		bool WaitTimedOut;
     		bool ResponseReceived;
-    		txPackage_t Cmd;
-    		rxPackage_t Ack;
+    		packageInfo_t Cmd;
+    		packageInfo_t Ack;
     		bool Error;
     		uint16_t ErrorCode;
-    		char ErrorDescription[gsbp_ErrorStringSize];
+    		char* ErrorDescription;				// buffer from the payload pool; NULL if there is no description
     		uint8_t  txChecksumHeader;          // header checksum; info
             uint32_t txChecksumData;            // data checksum; info
     		uint8_t  rxChecksumHeader;          // header checksum; info
             uint32_t rxChecksumData;            // data checksum; info
-#if GSBP__DEBUG_SENDING_COMMANDS
-            boost::posix_time::ptime CmdTime;
-#endif
-#if GSBP__DEBUG_RECEIVING_COMMANDS
-            boost::posix_time::ptime AckTime;
-            uint32_t AckWaitTimeout;
-#endif
+            uint64_t SendTimeNs;				// monotonic clock; start of the round-trip latency
     	};
 
         // transmission statistics
+        // -> atomic, as the counters are updated by the receiver, requesting and handler threads and read by GetMetrics()
         struct statsGSBP_t {
         	boost::posix_time::ptime StartTime;
-            uint64_t NumberOfRxPackages;
-            uint64_t NumberOfRxPackages_Missing;
-            uint64_t NumberOfRxPackages_BrokenStructur;
-            uint64_t NumberOfRxPackages_BrokenChecksum;
-            uint64_t BytesDiscarded;
-
-            uint8_t  LocalTxRequestID;
-            uint64_t GlobalTxRequestID;
+            std::atomic<uint64_t> NumberOfRxPackages;
+            std::atomic<uint64_t> NumberOfRxPackages_Missing;
+            std::atomic<uint64_t> NumberOfRxPackages_BrokenStructur;
+            std::atomic<uint64_t> NumberOfRxPackages_BrokenChecksum;
+            std::atomic<uint64_t> BytesDiscarded;
+            std::atomic<uint64_t> NumberOfRxBytes;
+            std::atomic<uint64_t> NumberOfTxPackages;
+            std::atomic<uint64_t> NumberOfTxBytes;
+            std::atomic<uint64_t> HandlerCalls;
+            std::atomic<uint64_t> HandlerTimeNs;
+            std::atomic<uint64_t> HandlerTimeNsMax;
+            std::atomic<uint64_t> HandlerQueueFull;
+            std::atomic<uint32_t> HandlerQueueDepth;
+            std::atomic<uint32_t> TxQueueDepth;		// packages queued, but not yet written
+            std::atomic<uint32_t> RxRingLevel;		// bytes in the decoder ring after the last chunk
         } StatsGSBP;
 
+        // round-trip latency histograms -> one per CMD ID, allocated with its first response (in AddResponse);
+        // log-linear buckets like a HDR histogram: exact below 2^gsbp_LatencySubBucketBits ns, then 2^gsbp_LatencySubBucketBits buckets per power of two
+        struct latencyHistogram_t {
+        	std::atomic<uint64_t> Count;
+        	std::atomic<uint64_t> SumNs;
+        	std::atomic<uint64_t> MinNs;
+        	std::atomic<uint64_t> MaxNs;
+        	std::atomic<uint64_t> Buckets[gsbp_LatencyBuckets];
+        };
+        std::atomic<latencyHistogram_t*> LatencyHistograms[gsbp_CommandIdTableSize];
+
 
         /* Private Variables */
         char     ID[255];
@@ -266,32 +559,296 @@ namespace ns_GSBP_DD_01 {
         uint16_t DeviceClass;
         int      fd;
         bool     DeviceConnected;
+        std::atomic<bool> DeviceHungUp;			// read() returned 0 -> the device is gone, DisconnectFromDevice() still closes the fd
         bool     RunReceiverThread;
         bool     ReceiverThreatRunning;
 
-        uint8_t  TxBuffer[gsbp_TxMaxPackageSize];
-        uint32_t TxBufferSize;
+        // transmit queue -> lock-free MPSC stack of packages to send; the thread holding TxWrite_mutex writes all queued packages
+        struct txFrame_t {
+        	uint8_t    Buffer[gsbp_TxMaxPackageSize];
+        	uint32_t   Size;
+        	txFrame_t* Next;
+        	bool       Done;                // set by the writing thread with TxWrite_mutex locked
+        	bool       WriteOk;
+        };
+        std::atomic<txFrame_t*> TxQueue;
+        boost::mutex            TxWrite_mutex;
+        std::atomic<uint64_t>   TxRequestIdGlobal;
 
         // external configuration
         gsbpConfiguration_t	ExtConfig;
 
+        // lock statistics -> collected by measuredLock_t while Enabled is set
+        struct lockCounter_t {
+        	std::atomic<bool>     Enabled;
+        	std::atomic<uint64_t> Acquisitions;
+        	std::atomic<uint64_t> Contended;
+        	std::atomic<uint64_t> WaitNs;
+        	std::atomic<uint64_t> WaitNsMax;
+        	std::atomic<uint64_t> HoldNs;
+        	std::atomic<uint64_t> HoldNsMax;
+        };
+        // boost::mutex::scoped_lock, which adds its wait and hold times to a lockCounter_t
+        class measuredLock_t : public boost::unique_lock<boost::mutex> {
+        public:
+        	measuredLock_t(boost::mutex& Mutex, lockCounter_t& Counter);
+        	measuredLock_t(boost::mutex& Mutex, lockCounter_t& Counter, boost::defer_lock_t);
+        	~measuredLock_t(void);
+        	void lock(void);
+        	void unlock(void);
+        	// the mutex is released while waiting -> the hold time ends before and starts again after the wait
+        	template<typename Condition, typename Duration>
+        	bool TimedWait(Condition& C, const Duration& D){
+        		bool Measured = (this->LockedAt != 0);
+        		measuredLock_t::AddHoldTime();
+        		bool Notified = C.timed_wait(*this, D);
+        		if (Measured){
+        			this->LockedAt = GSBP_DD::GetMonotonicTimeNs();
+        		}
+        		return Notified;
+        	}
+        private:
+        	lockCounter_t& Counter;
+        	uint64_t       LockedAt;		// 0 -> not measured
+        	void           AddHoldTime(void);
+        };
+        lockCounter_t RequestResponseLockStats;
+        lockCounter_t ReadPackageLockStats;
+
         // receiver thread
         boost::thread* Receiver_thread;
         boost::mutex   ReadPackage_mutex;
 
-        // request/response buffer
-    	boost::circular_buffer<RequestResponse_t> RequestResponseBuffer;
+        // stream decoder -> keeps partial packages between two reads
+        struct rxDecoder_t {
+        	uint8_t  Ring[gsbp_RxRingBufferSize];	// received bytes, not yet part of a complete package
+        	uint32_t Head;							// absolute write position (free running)
+        	uint32_t Tail;							// absolute read position (free running)
+        	uint32_t PackageSize;					// size of the package at Tail; 0 -> header not yet complete
+        	uint8_t  ChecksumHeader;				// header checksum of the package at Tail
+        	uint8_t  Package[gsbp_RxMaxPackageSize];// linear copy of a package wrapping around the end of the ring
+        } RxDecoder;
+        uint8_t  RxChunk[gsbp_RxChunkSize];
+
+        // request/response table -> indexed by the local request ID; the entry is valid for
+        // the global request ID (generation) stored in it
+        RequestResponse_t RequestTable[gsbp_RequestTableSize];
+        // debug timestamps of the requests -> kept out of RequestResponse_t and only written with the debug categories enabled
+        struct debugTimes_t {
+        	uint64_t                 RequestIdGlobal;
+        	boost::posix_time::ptime CmdTime;		// DebugSendingCommands
+        	boost::posix_time::ptime AckTime;		// DebugReceivingCommands; first response
+        	uint32_t                 AckWaitTimeout;	// DebugReceivingCommands; ms waited, if the response was not received
+        };
+        debugTimes_t RequestDebugTimes[gsbp_RequestTableSize];
+        std::atomic<uint32_t> DebugCategories;
+        inline bool IsDebugEnabled(uint32_t Category){
+        	return GSBP__UNLIKELY((this->DebugCategories.load(std::memory_order_relaxed) & Category) != 0);
+        }
+        // dummy copies of requests, which received more than one response
+    	boost::circular_buffer<RequestResponse_t> DuplicateResponseBuffer;
         boost::mutex RequestResponseLock_mutex;
         uint32_t     UnclaimedRequestResponces;
+        // response notification -> one condition and one counter per local request ID, signalled by AddResponse
+        boost::condition_variable ResponseCondition[gsbp_RequestTableSize];
+        std::atomic<uint32_t>     ResponseCounter[gsbp_RequestTableSize];
+        // ... and one condition for SendPackagesPipelined(), which waits for any response
+        boost::condition_variable AnyResponseCondition;
+        uint32_t                  AnyResponseWaiters;
+
+        // asynchronous requests -> completed by the receiver thread; one entry per local request ID
+        struct asyncRequest_t {
+        	uint64_t RequestIdGlobal;		// 0 = unused
+        	uint16_t AckId;
+        	std::chrono::steady_clock::time_point Deadline;
+        	std::function<void(asyncResponse_t*)> Callback;
+        };
+        asyncRequest_t        AsyncRequests[gsbp_RequestTableSize];
+        std::atomic<uint32_t> NumberOfAsyncRequests;
+
+        // subscriptions -> copy-on-write list, read by the decoder without a lock; Subscription_mutex serialises the changes
+        struct subscription_t {
+        	uint32_t SubscriptionID;
+        	uint16_t CommandID;				// SubscribeToAnyID = any CMD/ACK ID
+        	uint8_t  RequestID;				// SubscribeToAnyID = any local request ID
+        	std::function<void(rxPackage_t*)> Sink;
+        };
+        std::shared_ptr< const std::vector<subscription_t> > Subscriptions;
+        boost::mutex          Subscription_mutex;
+        uint32_t              LastSubscriptionID;
+        std::atomic<bool>     SubscriptionsActive;
+
+        // package handlers -> read-copy-update table; the receiver/handler threads use the current table without a lock,
+        // changes copy it and swap the new table in (serialised by HandlerTable_mutex)
+        struct handlerTable_t {
+        	packageHandler_t DefaultHandler;	// gsbpConfiguration_t::PackageHandler; for all CMD/ACK IDs without a handler
+        	packageHandler_t Handler[gsbp_CommandIdTableSize];
+        };
+        std::shared_ptr<const handlerTable_t> HandlerTable;
+        boost::mutex          HandlerTable_mutex;
+
+        // package handler threads -> every thread handles the packages of a fixed set of CMD/ACK IDs in the received order
+        struct handlerJob_t {
+        	rxPackage_t Package;
+        	uint64_t    RequestId;
+        };
+        struct handlerWorker_t {
+        	boost::thread*            Thread;
+        	boost::mutex              Queue_mutex;
+        	boost::condition_variable QueueCondition;
+        	std::deque<handlerJob_t*> Queue;
+        	std::vector<handlerJob_t*> FreeJobs;
+        	bool                      Run;
+        };
+        std::vector<handlerWorker_t*> HandlerWorkers;
+
+        // wire capture -> one single-producer/single-consumer byte ring per direction; the producers (receiver thread,
+        // thread holding TxWrite_mutex) never wait, chunks which do not fit are dropped; a writer thread writes the pcapng file
+        enum captureDirection_t {
+        	CaptureInbound  = 0,
+        	CaptureOutbound = 1,
+        };
+        struct captureRing_t {
+        	uint8_t*              Buffer;
+        	std::atomic<uint64_t> Head;		// producer
+        	std::atomic<uint64_t> Tail;		// capture writer
+        	uint64_t              ChunksCaptured;
+        	uint64_t              BytesCaptured;
+        	std::atomic<uint64_t> ChunksDropped;
+        };
+        captureRing_t         CaptureRing[2];
+        std::atomic<bool>     CaptureActive;
+        std::atomic<uint32_t> CaptureUsers;	// producers currently using the rings
+        std::atomic<bool>     RunCaptureThread;
+        boost::thread*        Capture_thread;
+        boost::mutex          Capture_mutex;	// StartCapture()/StopCapture()
+        int                   fdCapture;
+        int64_t               CaptureClockOffsetNs; // wall clock - monotonic clock
+
+        // logging -> the threads of the receive path only format the message into a slot of a bounded lock-free ring
+        // (multi-producer/single-consumer); the log thread hands the records to the sink. Without the log thread
+        // (not connected, replay) the sink is called directly.
+        struct logSlot_t {
+        	std::atomic<uint64_t> Sequence;		// == position -> free; == position+1 -> record ready
+        	logRecord_t           Record;
+        };
+        struct logSiteState_t {
+        	std::atomic<uint64_t> WindowStartNs;
+        	std::atomic<uint32_t> Count;		// messages in the current one second window
+        	std::atomic<uint32_t> Suppressed;
+        };
+        logSlot_t             LogRing[gsbp_LogRingSize];
+        std::atomic<uint64_t> LogHead;			// producers
+        std::atomic<uint64_t> LogTail;			// written with LogSink_mutex locked; read by GetMetrics()
+        logSiteState_t        LogSites[NumberOfLogSites];
+        std::atomic<uint32_t> LogLevel;
+        std::atomic<uint32_t> LogRateLimit;
+        std::atomic<uint64_t> LogLogged;
+        std::atomic<uint64_t> LogRateLimited;
+        std::atomic<uint64_t> LogDropped;
+        logSink_t             LogSink;
+        boost::mutex          LogSink_mutex;	// LogSink, LogTail
+        boost::thread*        Log_thread;
+        std::atomic<bool>     RunLogThread;
+        boost::mutex          LogThread_mutex;
+        boost::condition_variable LogCondition;
+
+        // packet lifecycle tracing -> every thread writes its events into its own ring (single producer, no lock);
+        // StopTrace() writes the rings in the Chrome trace event format
+        enum tracePoint_t {
+        	TraceSendPackage					= 0,	// DoSendPackage; requesting thread
+        	TraceRequest						= 1,	// async track of a request: send -> first response or timeout
+        	TraceWrite							= 2,	// writev() of the frames
+        	TraceSelect							= 3,	// waiting for received bytes
+        	TraceRead							= 4,	// read() of the received bytes
+        	TraceBuildPackage					= 5,
+        	TraceAddResponse					= 6,
+        	TraceAddResponseLock				= 7,	// waiting for RequestResponseLock_mutex in AddResponse
+        	TraceHandlerQueue					= 8,	// package queued for a handler thread
+        	TracePackageHandlers				= 9,
+        	TraceGetResponse					= 10,
+        	TraceGetResponseWakeup				= 11,	// GetResponse woken up by AddResponse or the timeout
+        	NumberOfTracePoints					= 12,
+        };
+        struct traceEvent_t {
+        	uint64_t TimeNs;					// monotonic clock
+        	uint64_t Id;						// global request ID; 0 = none
+        	uint32_t Arg;						// CMD/ACK ID, bytes, ... -> see TracePointNames
+        	uint8_t  Point;
+        	char     Phase;						// Chrome trace event phase: B, E, i, b, n, e
+        };
+        struct traceRing_t {
+        	traceEvent_t          Events[gsbp_TraceRingSize];
+        	std::atomic<uint64_t> Head;
+        	pid_t                 ThreadId;
+        	const char*           Role;
+        };
+        struct traceThreadCache_t {
+        	uint64_t     Session;
+        	traceRing_t* Ring;
+        };
+        static thread_local traceThreadCache_t TraceThreadCache[gsbp_TraceRingsPerThread];
+        static thread_local uint32_t           TraceThreadCacheNext;
+        static std::atomic<uint64_t> TraceSessions;	// unique trace session IDs of all interfaces
+        std::atomic<bool>     TraceActive;
+        std::atomic<uint32_t> TraceUsers;		// threads currently writing an event
+        std::atomic<uint64_t> TraceSession;
+        std::vector<traceRing_t*> TraceRings;
+        boost::mutex          Trace_mutex;		// StartTrace()/StopTrace()
+        boost::mutex          TraceRings_mutex;	// TraceRings, while the trace is active
+        inline void Trace(tracePoint_t Point, char Phase, uint64_t Id, uint32_t Arg){
+        	if (GSBP__UNLIKELY(this->TraceActive.load(std::memory_order_relaxed))){
+        		GSBP_DD::RecordTrace(Point, Phase, Id, Arg);
+        	}
+        }
+
+        // metrics socket -> see StartMetricsSocket()
+        std::atomic<bool>     RunMetricsThread;
+        boost::thread*        Metrics_thread;
+        boost::mutex          Metrics_mutex;	// StartMetricsSocket()/StopMetricsSocket()
+        int                   fdMetrics;
+        char                  MetricsSocketPath[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+        // payload pool -> free buffers for each size class; all buffers are released by the destructor
+        std::vector<uint8_t*> PayloadPool[gsbp_PayloadPoolSizeClasses];
+        std::vector<uint8_t*> PayloadPoolBuffers;
 
 
         /* Private Functions */
         void      InitialiseVariables(void);
         void	  SetDefaultExtConfiguration(void);
         int       OpenDevice(void);
-
-        void 	  AddRequest(RequestResponse_t item);
+        bool      StartConnection(uint16_t* ErrorCode);
+        static uint64_t GetMonotonicTimeNs(void);
+        void      RecordLatency(uint16_t CommandID, uint64_t LatencyNs);
+        static uint32_t GetLatencyBucket(uint64_t LatencyNs);
+        static uint64_t GetLatencyBucketValue(uint32_t Bucket);
+        void      MetricsServer(void);
+        void      RecordTrace(tracePoint_t Point, char Phase, uint64_t Id, uint32_t Arg);
+        traceRing_t* GetTraceRing(tracePoint_t Point);
+        bool      WriteTrace(const char* FileName, traceStatistics_t* Statistics);
+        void      Log(logSite_t Site, logSeverity_t Severity, const char* Format, ...) __attribute__((format(printf, 4, 5)));
+        uint32_t  DrainLogRing(void);
+        void      LogWriter(void);
+        void      StartLogThread(void);
+        void      StopLogThread(void);
+        void      PrintLogRecord(const logRecord_t* Record);
+
+        uint64_t  DoSendPackage(txPackage_t* P, asyncRequest_t* Async, uint64_t OldestRequestId, uint16_t* ErrorCode);
+        void 	  AddRequest(RequestResponse_t* Request, txPackage_t* Cmd, asyncRequest_t* Async);
+        void      CompleteAsyncRequests(bool OnlyTimedOut, uint16_t ErrorCode);
+        void      SignalHangup(void);
+        void      DispatchPackageHandlers(rxPackage_t* Package, uint64_t RequestId);
+        void      RunPackageHandlers(rxPackage_t* Package, uint64_t RequestId);
+        void      HandlerWorker(handlerWorker_t* Worker);
+        void      StartHandlerWorkers(void);
+        void      StopHandlerWorkers(void);
+        bool      DeliverToSubscribers(rxPackage_t* Package);
+        void      SetDefaultPackageHandler(packageHandler_t Handler);
         bool      ReadPackages(bool doReturnAfterTimeout);
+        uint32_t  DecodeRxChunk(const uint8_t* Chunk, uint32_t ChunkSize);
+        uint32_t  DecodeRxRing(void);
+        void      ResetRxDecoder(bool DiscardIncompletePackage);
         void      BuildPackage(uint8_t* RxBuffer, uint32_t RxBufferSize, packageState_t State, uint8_t ChecksumHeader);
         uint64_t  AddResponse(rxPackage_t* Response);
 
@@ -303,13 +860,34 @@ namespace ns_GSBP_DD_01 {
         const char* GetCmdString(uint8_t Id);
         const char* GetErrorString(uint16_t ErrorCode);
 
-        uint8_t   GetNextRequestIdLocal(void);
+        uint64_t  GetNextRequestIdGlobal(void);
         uint8_t   GetCurrentRequestIdLocal(void);
         uint64_t  GetCurrentRequestIdGlobal(void);
+        uint8_t   GetRequestIdLocal(uint64_t RequestIdGlobal);
+        void      ClaimRequest(RequestResponse_t* Request);
+
+        uint8_t*  AllocatePayload(const void* Data, uint32_t DataSize);
+        void      FreePayload(uint8_t* Data, uint32_t DataSize);
+        void      FreeRequestPayloads(RequestResponse_t* Request);
+        void      CopyResponse(RequestResponse_t* Request, rxPackage_t* ACK);
+        RequestResponse_t* FindResponse(uint64_t RequestId, uint16_t AckId, bool WaitForResponce, uint32_t* NumberOfOpenRequests);
+        uint32_t  MarkResponseTimeout(uint64_t RequestId);
+
+        uint32_t  EncodePackage(txPackage_t* P, uint8_t RequestIdLocal, uint8_t* Buffer);
+        bool      TransmitFrame(txFrame_t* Frame);
+        void      WriteTxQueue(void);
+        uint32_t  WriteFrames(struct iovec* IoVec, uint32_t NumberOfFrames);
+
+        void      CaptureData(captureDirection_t Direction, const struct iovec* IoVec, uint32_t NumberOfIoVec);
+        void      CaptureWriter(void);
+        uint32_t  BuildCaptureBlock(uint8_t* Buffer, captureDirection_t Direction, int64_t TimestampNs, const uint8_t* Data, uint32_t DataSize);
+        uint32_t  BuildCaptureOption(uint8_t* Buffer, uint16_t Code, const void* Value, uint16_t Length);
+        bool      WriteCaptureFile(const uint8_t* Data, uint32_t Size);
 
 		void      DoPrintNodeInfo(gsbp_ACK_nodeInfo_t* NodeInfo);
         void      DoPrintPackageContent(txPackage_t* Package, uint8_t RequestIdLocal);
         void      DoPrintPackageContent(rxPackage_t* Package);
+        void      DoPrintPackageContent(uint8_t RequestIdLocal, uint8_t* Data, uint32_t DataSize);
         void      DoPrintPackage(rxPackage_t* Package, bool IsACK);
         void      DoPrintRequestResponse(RequestResponse_t* Request, bool AddOnlyAck, bool PrintPackageContent);
         void	  DoPrintBits(void const*  const ptr, size_t const size);
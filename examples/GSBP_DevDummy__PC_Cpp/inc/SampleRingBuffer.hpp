@@ -0,0 +1,339 @@
+/*
+ * # Specific Device Interface #
+ *   C++ Interface class for the GSBP_DevDummy device,
+ *   utilizing the GSBP communication interface class.
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    SampleRingBuffer.hpp -> Lock-free sample buffer between the GSBP receiver and the application
+ *   Version: 2 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DUMMYDEVICE_SAMPLERINGBUFFER_H
+#define DUMMYDEVICE_SAMPLERINGBUFFER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+/*
+ * DummyDevice name space
+ */
+namespace nsDUMMYDEVICE_01 {
+
+// what happens with new values, if the buffer is full
+typedef enum {
+	OverflowBlock		= 0,	// the producer waits until the consumer made room (at most BlockTimeoutMs, then the newest values are dropped; 0 -> no waiting)
+	OverflowDropOldest	= 1,	// the oldest values are overwritten
+	OverflowDropNewest	= 2,	// the new values, which do not fit, are dropped
+} overflowPolicy_t;
+
+typedef struct {
+	uint64_t ValuesWritten;		// values written into the buffer
+	uint64_t ValuesRead;		// values read from the buffer
+	uint64_t Overflows;			// number of writes, which did not fit into the buffer
+	uint64_t ValuesDropped;		// values lost because of an overflow (oldest or newest, depending on the policy)
+	uint64_t BlockedWrites;		// number of writes, which had to wait for the consumer (OverflowBlock)
+} ringStatistics_t;
+
+/*
+ * bounded single-producer/single-consumer ring buffer for trivially copyable values
+ *  -> one thread writes (e.g. the GSBP receiver), one thread reads; no lock on the data path
+ *  -> the values are copied in and out with at most two memcpy() each
+ *  -> the read/write positions are free running 64bit counters, the capacity is rounded up to a power of two
+ *  -> instead of Read(), the consumer can borrow the values in place (Borrow()/Release()) and wait for new values (WaitForValues())
+ */
+template <typename T>
+class SampleRingBuffer {
+	static_assert(std::is_trivially_copyable<T>::value, "SampleRingBuffer needs a trivially copyable type");
+public:
+	SampleRingBuffer(uint32_t Capacity, overflowPolicy_t Policy)
+	{
+		this->Capacity = 1;
+		while (this->Capacity < Capacity && this->Capacity < 0x80000000){
+			this->Capacity <<= 1;
+		}
+		this->Mask = this->Capacity -1;
+		this->Buffer = new T[this->Capacity];
+		this->Policy.store(Policy);
+		this->BlockTimeoutMs.store(100);
+		this->Head.store(0);
+		this->Tail.store(0);
+		this->ProducerWaiting.store(false);
+		this->ConsumerWaitingFor.store(0);
+		this->BorrowTail = 0;
+		this->Overflows.store(0);
+		this->ValuesDropped.store(0);
+		this->BlockedWrites.store(0);
+		this->ValuesOverwritten.store(0);
+	}
+	~SampleRingBuffer(void)
+	{
+		delete[] this->Buffer;
+	}
+
+	/*
+	 * producer -> adds N values; returns the number of values added (the rest was dropped)
+	 */
+	uint32_t Write(const T* Data, uint32_t N)
+	{
+		overflowPolicy_t Policy = this->Policy.load(std::memory_order_relaxed);
+		uint64_t Head = this->Head.load(std::memory_order_relaxed);
+		uint32_t Dropped = 0;
+
+		if (N > this->Capacity && Policy == OverflowDropOldest){
+			// only the newest values can be kept
+			Dropped = N -this->Capacity;
+			Data += Dropped;
+			N = this->Capacity;
+		}
+		uint32_t Free = this->Capacity -(uint32_t)(Head -this->Tail.load(std::memory_order_acquire));
+		if (N > Free || Dropped > 0){
+			this->Overflows.fetch_add(1, std::memory_order_relaxed);
+			if (Policy == OverflowBlock){
+				this->BlockedWrites.fetch_add(1, std::memory_order_relaxed);
+				Free = SampleRingBuffer::WaitForRoom(Head, N);
+			}
+			if (Policy == OverflowDropOldest){
+				// move the read position forward -> the consumer notices it and discards its copy (see Read())
+				uint64_t Tail = this->Tail.load(std::memory_order_acquire);
+				while (Head -Tail +N > this->Capacity){
+					if (this->Tail.compare_exchange_weak(Tail, Head +N -this->Capacity, std::memory_order_acq_rel)){
+						this->ValuesOverwritten.fetch_add(Head +N -this->Capacity -Tail, std::memory_order_relaxed);
+						Dropped += (uint32_t)(Head +N -this->Capacity -Tail);
+						break;
+					}
+				}
+			} else if (N > Free){
+				Dropped += N -Free;
+				N = Free;
+			}
+			this->ValuesDropped.fetch_add(Dropped, std::memory_order_relaxed);
+		}
+
+		SampleRingBuffer::CopyIn(Head, Data, N);
+		this->Head.store(Head +N); // seq_cst -> pairs with ConsumerWaitingFor
+
+		// wake up the consumer, if it waits for this values
+		uint32_t WaitingFor = this->ConsumerWaitingFor.load(std::memory_order_seq_cst);
+		if (WaitingFor > 0 && Head +N -this->Tail.load(std::memory_order_acquire) >= WaitingFor){
+			boost::mutex::scoped_lock lock(this->Wait_mutex);
+			this->DataCondition.notify_one();
+		}
+		return N;
+	}
+
+	/*
+	 * consumer -> copies up to NumberOfValuesMax values out of the buffer; returns the number of values copied
+	 */
+	uint32_t Read(T* Data, uint32_t NumberOfValuesMax)
+	{
+		uint64_t Tail = this->Tail.load(std::memory_order_acquire);
+		uint32_t N;
+		do {
+			// with OverflowDropOldest the producer may move the read position (and overwrite the values) while they are copied
+			// -> the copy is only used, if the read position did not change in the meantime
+			N = (uint32_t)(this->Head.load(std::memory_order_acquire) -Tail);
+			if (N > NumberOfValuesMax){
+				N = NumberOfValuesMax;
+			}
+			SampleRingBuffer::CopyOut(Tail, Data, N);
+		} while (!this->Tail.compare_exchange_strong(Tail, Tail +N)); // seq_cst -> pairs with ProducerWaiting
+
+		if (N > 0){
+			SampleRingBuffer::NotifyProducer();
+		}
+		return N;
+	}
+
+	/*
+	 * consumer -> borrows the oldest values in place; returns the number of values in *Span (0 -> buffer empty)
+	 *  -> the span ends at the end of the internal buffer, the following values are returned by the next Borrow()
+	 *  -> the values stay valid until Release(), only one span can be borrowed at a time
+	 */
+	uint32_t Borrow(const T** Span, uint32_t NumberOfValuesMax)
+	{
+		this->BorrowTail = this->Tail.load(std::memory_order_acquire);
+		uint32_t N = (uint32_t)(this->Head.load(std::memory_order_acquire) -this->BorrowTail);
+		uint32_t Start = (uint32_t)(this->BorrowTail & this->Mask);
+		if (N > this->Capacity -Start){
+			N = this->Capacity -Start;
+		}
+		if (N > NumberOfValuesMax){
+			N = NumberOfValuesMax;
+		}
+		*Span = &this->Buffer[Start];
+		return N;
+	}
+
+	/*
+	 * consumer -> releases the first N values of the borrowed span
+	 *  -> false: the span was (partly) overwritten while it was borrowed (only possible with OverflowDropOldest)
+	 */
+	bool Release(uint32_t N)
+	{
+		uint64_t Tail = this->BorrowTail;
+		bool NotOverwritten = this->Tail.compare_exchange_strong(Tail, this->BorrowTail +N);
+		// the producer moved the read position -> keep the newer one, if it is past the released values
+		while (!NotOverwritten && Tail < this->BorrowTail +N){
+			if (this->Tail.compare_exchange_weak(Tail, this->BorrowTail +N)){
+				break;
+			}
+		}
+		this->BorrowTail += N;
+		if (N > 0){
+			SampleRingBuffer::NotifyProducer();
+		}
+		return NotOverwritten;
+	}
+
+	/*
+	 * consumer -> waits until at least N values are buffered or the timeout elapsed; returns the number of buffered values
+	 *  -> the producer wakes the consumer up as soon as the N values are there, there is no polling
+	 */
+	uint32_t WaitForValues(uint32_t N, uint32_t TimeoutMs)
+	{
+		if (N > this->Capacity){
+			N = this->Capacity;
+		}
+		uint32_t Available = SampleRingBuffer::GetNumberOfValues();
+		if (Available >= N || TimeoutMs == 0){
+			return Available;
+		}
+		boost::posix_time::ptime Timeout = boost::posix_time::microsec_clock::universal_time()
+				+boost::posix_time::milliseconds(TimeoutMs);
+		boost::mutex::scoped_lock lock(this->Wait_mutex);
+		this->ConsumerWaitingFor.store(N, std::memory_order_seq_cst);
+		Available = (uint32_t)(this->Head.load(std::memory_order_seq_cst) -this->Tail.load(std::memory_order_acquire));
+		while (Available < N){
+			bool Notified = this->DataCondition.timed_wait(lock, Timeout);
+			Available = (uint32_t)(this->Head.load(std::memory_order_acquire) -this->Tail.load(std::memory_order_acquire));
+			if (!Notified){
+				break;
+			}
+		}
+		this->ConsumerWaitingFor.store(0, std::memory_order_relaxed);
+		return Available;
+	}
+
+	uint32_t GetNumberOfValues(void)
+	{
+		return (uint32_t)(this->Head.load(std::memory_order_acquire) -this->Tail.load(std::memory_order_acquire));
+	}
+	uint32_t GetCapacity(void)
+	{
+		return this->Capacity;
+	}
+	void SetOverflowPolicy(overflowPolicy_t Policy, uint32_t BlockTimeoutMs)
+	{
+		this->Policy.store(Policy);
+		this->BlockTimeoutMs.store(BlockTimeoutMs);
+	}
+	void GetStatistics(ringStatistics_t* Statistics)
+	{
+		Statistics->ValuesWritten = this->Head.load(std::memory_order_acquire);
+		// the read position includes the values overwritten by OverflowDropOldest, which were never read
+		Statistics->ValuesRead    = this->Tail.load(std::memory_order_acquire) -this->ValuesOverwritten.load(std::memory_order_relaxed);
+		Statistics->Overflows     = this->Overflows.load(std::memory_order_relaxed);
+		Statistics->ValuesDropped = this->ValuesDropped.load(std::memory_order_relaxed);
+		Statistics->BlockedWrites = this->BlockedWrites.load(std::memory_order_relaxed);
+	}
+
+private:
+	T*       Buffer;
+	uint32_t Capacity;
+	uint32_t Mask;
+	std::atomic<overflowPolicy_t> Policy;
+	std::atomic<uint32_t> BlockTimeoutMs;
+	// write and read position; padded to own cache lines, as they are written by different threads
+	uint8_t  HeadPadding[64];
+	std::atomic<uint64_t> Head;
+	uint8_t  TailPadding[64 -sizeof(std::atomic<uint64_t>)];
+	std::atomic<uint64_t> Tail;
+	uint8_t  CounterPadding[64 -sizeof(std::atomic<uint64_t>)];
+	std::atomic<uint64_t> Overflows;
+	std::atomic<uint64_t> ValuesDropped;
+	std::atomic<uint64_t> BlockedWrites;
+	std::atomic<uint64_t> ValuesOverwritten;
+	// only used, if the producer (OverflowBlock) or the consumer (WaitForValues()) has to wait
+	std::atomic<bool> ProducerWaiting;
+	std::atomic<uint32_t> ConsumerWaitingFor;
+	boost::mutex Wait_mutex;
+	boost::condition_variable RoomCondition;
+	boost::condition_variable DataCondition;
+	// consumer only -> read position of the borrowed span
+	uint64_t BorrowTail;
+
+	void NotifyProducer(void)
+	{
+		if (this->ProducerWaiting.load(std::memory_order_seq_cst)){
+			boost::mutex::scoped_lock lock(this->Wait_mutex);
+			this->RoomCondition.notify_one();
+		}
+	}
+
+	void CopyIn(uint64_t Position, const T* Data, uint32_t N)
+	{
+		uint32_t Start = (uint32_t)(Position & this->Mask);
+		uint32_t First = (N < this->Capacity -Start) ? N : this->Capacity -Start;
+		memcpy(&this->Buffer[Start], Data, First *sizeof(T));
+		memcpy(&this->Buffer[0], Data +First, (N -First) *sizeof(T));
+	}
+	void CopyOut(uint64_t Position, T* Data, uint32_t N)
+	{
+		uint32_t Start = (uint32_t)(Position & this->Mask);
+		uint32_t First = (N < this->Capacity -Start) ? N : this->Capacity -Start;
+		memcpy(Data, &this->Buffer[Start], First *sizeof(T));
+		memcpy(Data +First, &this->Buffer[0], (N -First) *sizeof(T));
+	}
+
+	/*
+	 * waits until N values fit into the buffer or the block timeout elapsed -> returns the free space
+	 */
+	uint32_t WaitForRoom(uint64_t Head, uint32_t N)
+	{
+		if (N > this->Capacity){
+			N = this->Capacity;
+		}
+		boost::posix_time::ptime Timeout = boost::posix_time::microsec_clock::universal_time()
+				+boost::posix_time::milliseconds(this->BlockTimeoutMs.load());
+		boost::mutex::scoped_lock lock(this->Wait_mutex);
+		this->ProducerWaiting.store(true, std::memory_order_seq_cst);
+		uint32_t Free = this->Capacity -(uint32_t)(Head -this->Tail.load(std::memory_order_seq_cst));
+		while (Free < N){
+			if (!this->RoomCondition.timed_wait(lock, Timeout)){
+				Free = this->Capacity -(uint32_t)(Head -this->Tail.load(std::memory_order_acquire));
+				break;
+			}
+			Free = this->Capacity -(uint32_t)(Head -this->Tail.load(std::memory_order_acquire));
+		}
+		this->ProducerWaiting.store(false, std::memory_order_relaxed);
+		return Free;
+	}
+};
+
+} // namespace
+
+#endif /* DUMMYDEVICE_SAMPLERINGBUFFER_H */
@@ -0,0 +1,219 @@
+/*
+ * # Specific Device Interface #
+ *   C++ Interface class for the GSBP_DevDummy device,
+ *   utilizing the GSBP communication interface class.
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    CsvWriter.cpp -> Source file for the asynchronous CSV export
+ *   Version: 2 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "CsvWriter.hpp"
+
+namespace nsDUMMYDEVICE_01 {
+
+static const char DigitPairs[201] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/*
+ * writes the decimal digits of Value backwards, ending before End -> returns the first digit
+ */
+static inline char* FormatDigits(char *End, uint64_t Value)
+{
+	while (Value >= 100){
+		End -= 2;
+		memcpy(End, &DigitPairs[(Value % 100) *2], 2);
+		Value /= 100;
+	}
+	if (Value >= 10){
+		End -= 2;
+		memcpy(End, &DigitPairs[Value *2], 2);
+	} else {
+		*--End = (char)('0' +Value);
+	}
+	return End;
+}
+
+/*
+ * one CSV line, the same as printf("%+06d, %+5d\n", LineNumber, Value) -> returns the line length
+ */
+static inline size_t FormatLine(char *Line, uint64_t LineNumber, int16_t Value)
+{
+	char Digits[24];
+	char *End = Digits +sizeof(Digits);
+	char *p = Line;
+
+	// "%+06d" -> sign and at least 5 digits
+	char *First = FormatDigits(End, LineNumber);
+	*p++ = '+';
+	for (ptrdiff_t i=End -First; i<5; i++){
+		*p++ = '0';
+	}
+	memcpy(p, First, End -First);
+	p += End -First;
+	*p++ = ',';
+	*p++ = ' ';
+
+	// "%+5d" -> sign and digits, right aligned in 5 characters
+	uint32_t Magnitude = (Value < 0) ? (uint32_t)(-(int32_t)Value) : (uint32_t)Value;
+	First = FormatDigits(End, Magnitude);
+	for (ptrdiff_t i=End -First +1; i<5; i++){
+		*p++ = ' ';
+	}
+	*p++ = (Value < 0) ? '-' : '+';
+	memcpy(p, First, End -First);
+	p += End -First;
+	*p++ = '\n';
+	return p -Line;
+}
+
+
+CsvWriter::CsvWriter(void)
+	: Samples(CSV_SAMPLE_BUFFER_SIZE, OverflowDropNewest)
+{
+	this->fdFile = -1;
+	this->TextBuffer = NULL;
+	this->LineNumber = 0;
+	this->Run = false;
+	this->WriteError = false;
+}
+
+CsvWriter::~CsvWriter(void)
+{
+	if (this->fdFile >= 0){
+		CsvWriter::Close();
+	}
+}
+
+bool CsvWriter::Open(const char *FileName)
+{
+	if (this->fdFile >= 0){
+		return false;
+	}
+	this->fdFile = open(FileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (this->fdFile < 0){
+		printf("\e[1m\e[91mCsvWriter ERROR:\e[0m Output file '%s' can not be opened: %s\n", FileName, strerror(errno));
+		return false;
+	}
+	this->TextBuffer = new char[CSV_TEXT_BUFFER_SIZE];
+	this->LineNumber = 0;
+	this->WriteError = false;
+	this->Run = true;
+	this->WriterThread = boost::thread(&CsvWriter::WriteLines, this);
+	return true;
+}
+
+/*
+ * adds values to the export -> returns the number of values added; the rest was dropped, as the writer thread is behind
+ */
+uint32_t CsvWriter::Write(const int16_t *Data, uint32_t NumberOfValues)
+{
+	if (this->fdFile < 0){
+		return 0;
+	}
+	return this->Samples.Write(Data, NumberOfValues);
+}
+
+/*
+ * writes all remaining values and closes the file
+ */
+bool CsvWriter::Close(void)
+{
+	if (this->fdFile < 0){
+		return false;
+	}
+	this->Run = false;
+	this->WriterThread.join();
+	close(this->fdFile);
+	this->fdFile = -1;
+	delete[] this->TextBuffer;
+	this->TextBuffer = NULL;
+	return !this->WriteError;
+}
+
+uint64_t CsvWriter::GetNumberOfDroppedValues(void)
+{
+	ringStatistics_t Statistics;
+	this->Samples.GetStatistics(&Statistics);
+	return Statistics.ValuesDropped;
+}
+
+/*
+ * writer thread -> formats the values straight out of the ring buffer; writes, when the text buffer is full or no new values arrive
+ */
+void CsvWriter::WriteLines(void)
+{
+	size_t TextSize = 0;
+	while (true){
+		bool Running = this->Run;
+		this->Samples.WaitForValues(CSV_TEXT_BUFFER_SIZE /CSV_LINE_SIZE_MAX, 20);
+
+		const int16_t *Values;
+		uint32_t NumberOfValues;
+		while ((NumberOfValues = this->Samples.Borrow(&Values, (CSV_TEXT_BUFFER_SIZE -TextSize) /CSV_LINE_SIZE_MAX)) > 0){
+			for (uint32_t i=0; i<NumberOfValues; i++){
+				TextSize += FormatLine(&this->TextBuffer[TextSize], ++this->LineNumber, Values[i]);
+			}
+			this->Samples.Release(NumberOfValues);
+			if (CSV_TEXT_BUFFER_SIZE -TextSize < CSV_LINE_SIZE_MAX){
+				CsvWriter::WriteText(TextSize);
+				TextSize = 0;
+			}
+		}
+		if (TextSize > 0){
+			CsvWriter::WriteText(TextSize);
+			TextSize = 0;
+		}
+		// stop only after the values, which were added before Close()
+		if (!Running){
+			break;
+		}
+	}
+}
+
+bool CsvWriter::WriteText(size_t Size)
+{
+	const char *Text = this->TextBuffer;
+	while (Size > 0 && !this->WriteError){
+		ssize_t Written = write(this->fdFile, Text, Size);
+		if (Written < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			printf("\e[1m\e[91mCsvWriter ERROR:\e[0m Writing the output file failed: %s\n", strerror(errno));
+			this->WriteError = true;
+			return false;
+		}
+		Text += Written;
+		Size -= Written;
+	}
+	return !this->WriteError;
+}
+
+} // namespace
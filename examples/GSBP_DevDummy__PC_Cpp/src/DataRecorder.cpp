@@ -0,0 +1,566 @@
+/*
+ * # Specific Device Interface #
+ *   C++ Interface class for the GSBP_DevDummy device,
+ *   utilizing the GSBP communication interface class.
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    DataRecorder.cpp -> Source file for the binary measurement recording (writer and reader)
+ *   Version: 2 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <algorithm>
+
+#include "DataRecorder.hpp"
+
+namespace nsDUMMYDEVICE_01 {
+
+static int64_t GetTimeUs(void)
+{
+	struct timeval Time;
+	gettimeofday(&Time, NULL);
+	return (int64_t)Time.tv_sec *1000000 + Time.tv_usec;
+}
+
+
+/*
+ * ### writer ###
+ */
+DataRecorder::DataRecorder(void)
+{
+	this->fdFile = -1;
+	memset(&this->Header, 0, sizeof(this->Header));
+	this->ChunkSize = RECORDING_CHUNK_SIZE_DEFAULT;
+	this->NumberOfSamples = 0;
+	this->NumberOfChunks = 0;
+	this->FileOffset = 0;
+	this->WriteError = false;
+	this->CurrentChunk = NULL;
+	this->Run = false;
+}
+
+DataRecorder::~DataRecorder(void)
+{
+	if (this->fdFile >= 0){
+		DataRecorder::Close();
+	}
+}
+
+/*
+ * creates the recording file -> ChunkSize: samples per chunk (0 -> RECORDING_CHUNK_SIZE_DEFAULT)
+ */
+bool DataRecorder::Open(const char *FileName, GSBP_DD::gsbp_ACK_nodeInfo_t *NodeInfo, double SampleRateHz, uint32_t ChunkSize)
+{
+	if (this->fdFile >= 0){
+		return false;
+	}
+	this->fdFile = open(FileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (this->fdFile < 0){
+		printf("\e[1m\e[91mDataRecorder ERROR:\e[0m Recording file '%s' can not be opened: %s\n", FileName, strerror(errno));
+		return false;
+	}
+
+	// header
+	memset(&this->Header, 0, sizeof(this->Header));
+	memcpy(this->Header.magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+	this->Header.version = RECORDING_VERSION;
+	this->Header.headerSize = sizeof(recordingHeader_t);
+	this->Header.sampleType = RecordingSampleInt16;
+	this->Header.sampleSize = sizeof(int16_t);
+	this->Header.indexInterval = RECORDING_INDEX_INTERVAL;
+	this->Header.sampleRateHz = SampleRateHz;
+	this->Header.startTimeUs = GetTimeUs();
+	if (NodeInfo != NULL){
+		this->Header.boardID = NodeInfo->boardID;
+		this->Header.deviceClass = NodeInfo->deviceClass;
+		this->Header.serialNumber = NodeInfo->serialNumber;
+		memcpy(this->Header.versionProtocol, NodeInfo->versionProtocol, sizeof(this->Header.versionProtocol));
+		memcpy(this->Header.versionFirmware, NodeInfo->versionFirmware, sizeof(this->Header.versionFirmware));
+		memcpy(this->Header.nodeInfoMsg, NodeInfo->msg, sizeof(this->Header.nodeInfoMsg) -1);
+	}
+	if (write(this->fdFile, &this->Header, sizeof(this->Header)) != (ssize_t)sizeof(this->Header)){
+		printf("\e[1m\e[91mDataRecorder ERROR:\e[0m Writing the recording header failed: %s\n", strerror(errno));
+		close(this->fdFile);
+		this->fdFile = -1;
+		return false;
+	}
+
+	this->ChunkSize = (ChunkSize > 0) ? ChunkSize : RECORDING_CHUNK_SIZE_DEFAULT;
+	this->NumberOfSamples = 0;
+	this->NumberOfChunks = 0;
+	this->FileOffset = sizeof(this->Header);
+	this->WriteError = false;
+	this->Index.clear();
+
+	// chunk buffers and writer thread
+	for (uint32_t i=0; i<RECORDING_WRITE_BUFFERS; i++){
+		chunkBuffer_t *Chunk = new chunkBuffer_t;
+		Chunk->Data.resize(sizeof(recordingChunkHeader_t) +this->ChunkSize *sizeof(int16_t));
+		Chunk->NumberOfSamples = 0;
+		this->AllChunks.push_back(Chunk);
+		this->FreeChunks.push_back(Chunk);
+	}
+	this->Run = true;
+	this->WriterThread = boost::thread(&DataRecorder::WriteChunks, this);
+	DataRecorder::StartChunk();
+	return true;
+}
+
+/*
+ * adds samples to the recording -> only waits, if all chunk buffers are queued for the disk
+ */
+bool DataRecorder::Write(const int16_t *Data, uint32_t NumberOfValues)
+{
+	if (this->fdFile < 0 || this->WriteError){
+		return false;
+	}
+	while (NumberOfValues > 0){
+		chunkBuffer_t *Chunk = this->CurrentChunk;
+		recordingChunkHeader_t *ChunkHeader = (recordingChunkHeader_t*)Chunk->Data.data();
+		if (Chunk->NumberOfSamples == 0){
+			ChunkHeader->firstSample = this->NumberOfSamples;
+			ChunkHeader->timestampUs = GetTimeUs();
+		}
+		uint32_t N = std::min(NumberOfValues, this->ChunkSize -Chunk->NumberOfSamples);
+		memcpy(&Chunk->Data[sizeof(recordingChunkHeader_t) +Chunk->NumberOfSamples *sizeof(int16_t)], Data, N *sizeof(int16_t));
+		Chunk->NumberOfSamples += N;
+		this->NumberOfSamples += N;
+		Data += N;
+		NumberOfValues -= N;
+		if (Chunk->NumberOfSamples == this->ChunkSize){
+			DataRecorder::QueueChunk();
+			DataRecorder::StartChunk();
+		}
+	}
+	return true;
+}
+
+/*
+ * writes the remaining samples and the index, updates the header and closes the file
+ */
+bool DataRecorder::Close(void)
+{
+	if (this->fdFile < 0){
+		return false;
+	}
+	if (this->CurrentChunk->NumberOfSamples > 0){
+		DataRecorder::QueueChunk();
+	} else {
+		boost::mutex::scoped_lock lock(this->Queue_mutex);
+		this->FreeChunks.push_back(this->CurrentChunk);
+	}
+	this->CurrentChunk = NULL;
+
+	// stop the writer thread -> it writes all queued chunks first
+	{
+		boost::mutex::scoped_lock lock(this->Queue_mutex);
+		this->Run = false;
+		this->QueueCondition.notify_all();
+	}
+	this->WriterThread.join();
+
+	// index and header
+	if (!this->WriteError){
+		size_t IndexSize = this->Index.size() *sizeof(recordingIndexEntry_t);
+		if (IndexSize == 0 || pwrite(this->fdFile, this->Index.data(), IndexSize, this->FileOffset) == (ssize_t)IndexSize){
+			this->Header.numberOfSamples = this->NumberOfSamples;
+			this->Header.numberOfChunks = this->NumberOfChunks;
+			this->Header.indexOffset = this->FileOffset;
+			this->Header.indexEntries = this->Index.size();
+			if (pwrite(this->fdFile, &this->Header, sizeof(this->Header), 0) != (ssize_t)sizeof(this->Header)){
+				this->WriteError = true;
+			}
+		} else {
+			this->WriteError = true;
+		}
+		if (this->WriteError){
+			printf("\e[1m\e[91mDataRecorder ERROR:\e[0m Writing the recording index failed: %s\n", strerror(errno));
+		}
+	}
+	close(this->fdFile);
+	this->fdFile = -1;
+	DataRecorder::ReleaseChunks();
+	return !this->WriteError;
+}
+
+uint64_t DataRecorder::GetNumberOfSamples(void)
+{
+	return this->NumberOfSamples;
+}
+
+/*
+ * takes a free chunk buffer -> waits for the writer thread, if there is none
+ */
+void DataRecorder::StartChunk(void)
+{
+	boost::mutex::scoped_lock lock(this->Queue_mutex);
+	while (this->FreeChunks.empty()){
+		this->FreeCondition.wait(lock);
+	}
+	this->CurrentChunk = this->FreeChunks.back();
+	this->FreeChunks.pop_back();
+	this->CurrentChunk->NumberOfSamples = 0;
+}
+
+/*
+ * hands the current chunk to the writer thread; the file offset of the chunk is known here already
+ */
+void DataRecorder::QueueChunk(void)
+{
+	chunkBuffer_t *Chunk = this->CurrentChunk;
+	recordingChunkHeader_t *ChunkHeader = (recordingChunkHeader_t*)Chunk->Data.data();
+	ChunkHeader->magic = RECORDING_CHUNK_MAGIC;
+	ChunkHeader->numberOfSamples = Chunk->NumberOfSamples;
+	if (this->NumberOfChunks % RECORDING_INDEX_INTERVAL == 0){
+		recordingIndexEntry_t Entry;
+		Entry.firstSample = ChunkHeader->firstSample;
+		Entry.timestampUs = ChunkHeader->timestampUs;
+		Entry.fileOffset  = this->FileOffset;
+		this->Index.push_back(Entry);
+	}
+	this->FileOffset += sizeof(recordingChunkHeader_t) +Chunk->NumberOfSamples *sizeof(int16_t);
+	this->NumberOfChunks++;
+
+	boost::mutex::scoped_lock lock(this->Queue_mutex);
+	this->FullChunks.push_back(Chunk);
+	this->QueueCondition.notify_one();
+}
+
+/*
+ * writer thread -> writes all queued chunks with one writev() call
+ */
+void DataRecorder::WriteChunks(void)
+{
+	std::vector<chunkBuffer_t*> Chunks;
+	struct iovec Iov[RECORDING_WRITE_BUFFERS];
+
+	boost::mutex::scoped_lock lock(this->Queue_mutex);
+	while (true){
+		while (this->FullChunks.empty() && this->Run){
+			this->QueueCondition.wait(lock);
+		}
+		if (this->FullChunks.empty()){
+			break;
+		}
+		Chunks.assign(this->FullChunks.begin(), this->FullChunks.end());
+		this->FullChunks.clear();
+		lock.unlock();
+
+		int NumberOfIov = 0;
+		for (size_t i=0; i<Chunks.size(); i++){
+			Iov[NumberOfIov].iov_base = Chunks[i]->Data.data();
+			Iov[NumberOfIov].iov_len  = sizeof(recordingChunkHeader_t) +Chunks[i]->NumberOfSamples *sizeof(int16_t);
+			NumberOfIov++;
+		}
+		// write all -> continue after partial writes
+		struct iovec *Next = Iov;
+		while (NumberOfIov > 0 && !this->WriteError){
+			ssize_t Written = writev(this->fdFile, Next, NumberOfIov);
+			if (Written < 0){
+				if (errno == EINTR){
+					continue;
+				}
+				printf("\e[1m\e[91mDataRecorder ERROR:\e[0m Writing the recording failed: %s\n", strerror(errno));
+				this->WriteError = true;
+				break;
+			}
+			while (NumberOfIov > 0 && (size_t)Written >= Next->iov_len){
+				Written -= Next->iov_len;
+				Next++;
+				NumberOfIov--;
+			}
+			if (NumberOfIov > 0){
+				Next->iov_base = (uint8_t*)Next->iov_base +Written;
+				Next->iov_len -= Written;
+			}
+		}
+
+		lock.lock();
+		for (size_t i=0; i<Chunks.size(); i++){
+			this->FreeChunks.push_back(Chunks[i]);
+		}
+		this->FreeCondition.notify_one();
+	}
+}
+
+void DataRecorder::ReleaseChunks(void)
+{
+	for (size_t i=0; i<this->AllChunks.size(); i++){
+		delete this->AllChunks[i];
+	}
+	this->AllChunks.clear();
+	this->FreeChunks.clear();
+	this->FullChunks.clear();
+}
+
+
+/*
+ * ### reader ###
+ */
+DataRecording::DataRecording(void)
+{
+	this->fdFile = -1;
+	this->Map = NULL;
+	this->MapSize = 0;
+	this->Header = NULL;
+	this->NumberOfSamples = 0;
+	this->NumberOfChunks = 0;
+	this->DataEnd = 0;
+}
+
+DataRecording::~DataRecording(void)
+{
+	DataRecording::Close();
+}
+
+/*
+ * maps the recording file and loads the index -> the samples are only read, when they are used
+ */
+bool DataRecording::Open(const char *FileName)
+{
+	DataRecording::Close();
+	this->fdFile = open(FileName, O_RDONLY);
+	if (this->fdFile < 0){
+		printf("\e[1m\e[91mDataRecording ERROR:\e[0m Recording file '%s' can not be opened: %s\n", FileName, strerror(errno));
+		return false;
+	}
+	struct stat FileStat;
+	if (fstat(this->fdFile, &FileStat) != 0 || (size_t)FileStat.st_size < sizeof(recordingHeader_t)){
+		printf("\e[1m\e[91mDataRecording ERROR:\e[0m '%s' is not a recording file!\n", FileName);
+		DataRecording::Close();
+		return false;
+	}
+	this->MapSize = FileStat.st_size;
+	void *Map = mmap(NULL, this->MapSize, PROT_READ, MAP_SHARED, this->fdFile, 0);
+	if (Map == MAP_FAILED){
+		printf("\e[1m\e[91mDataRecording ERROR:\e[0m Recording file '%s' can not be mapped: %s\n", FileName, strerror(errno));
+		this->MapSize = 0;
+		DataRecording::Close();
+		return false;
+	}
+	this->Map = (uint8_t*)Map;
+
+	// check the header
+	this->Header = (const recordingHeader_t*)this->Map;
+	if (memcmp(this->Header->magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0 || this->Header->version != RECORDING_VERSION
+			|| this->Header->headerSize < sizeof(recordingHeader_t) || this->Header->headerSize > this->MapSize
+			|| this->Header->sampleType != RecordingSampleInt16 || this->Header->indexInterval == 0){
+		printf("\e[1m\e[91mDataRecording ERROR:\e[0m '%s' is not a supported recording file!\n", FileName);
+		DataRecording::Close();
+		return false;
+	}
+
+	// index -> rebuilt, if the recording was not closed correctly or the index does not cover all chunks
+	if (this->Header->indexOffset >= this->Header->headerSize && this->Header->indexOffset <= this->MapSize
+			&& this->Header->indexEntries <= (this->MapSize -this->Header->indexOffset) /sizeof(recordingIndexEntry_t)
+			&& this->Header->numberOfChunks <= this->Header->indexEntries *this->Header->indexInterval){
+		const recordingIndexEntry_t *Index = (const recordingIndexEntry_t*)&this->Map[this->Header->indexOffset];
+		this->Index.assign(Index, Index +this->Header->indexEntries);
+		this->NumberOfSamples = this->Header->numberOfSamples;
+		this->NumberOfChunks = this->Header->numberOfChunks;
+		this->DataEnd = this->Header->indexOffset;
+	} else {
+		DataRecording::RebuildIndex();
+	}
+	return true;
+}
+
+void DataRecording::Close(void)
+{
+	if (this->Map != NULL){
+		munmap(this->Map, this->MapSize);
+	}
+	if (this->fdFile >= 0){
+		close(this->fdFile);
+	}
+	this->fdFile = -1;
+	this->Map = NULL;
+	this->MapSize = 0;
+	this->Header = NULL;
+	this->NumberOfSamples = 0;
+	this->NumberOfChunks = 0;
+	this->DataEnd = 0;
+	this->Index.clear();
+}
+
+const recordingHeader_t* DataRecording::GetHeader(void)
+{
+	return this->Header;
+}
+
+uint64_t DataRecording::GetNumberOfSamples(void)
+{
+	return this->NumberOfSamples;
+}
+
+uint64_t DataRecording::GetNumberOfChunks(void)
+{
+	return this->NumberOfChunks;
+}
+
+/*
+ * returns the samples of a chunk in place (NULL -> no such chunk)
+ */
+const int16_t* DataRecording::GetChunk(uint64_t Chunk, uint32_t *NumberOfSamples, uint64_t *FirstSample, int64_t *TimestampUs)
+{
+	const recordingChunkHeader_t *ChunkHeader = DataRecording::GetChunkHeader(Chunk);
+	if (ChunkHeader == NULL){
+		return NULL;
+	}
+	*NumberOfSamples = ChunkHeader->numberOfSamples;
+	*FirstSample = ChunkHeader->firstSample;
+	*TimestampUs = ChunkHeader->timestampUs;
+	return (const int16_t*)(ChunkHeader +1);
+}
+
+/*
+ * returns the chunk containing the sample (GetNumberOfChunks() -> no such sample)
+ */
+uint64_t DataRecording::FindChunkBySample(uint64_t Sample)
+{
+	if (Sample >= this->NumberOfSamples || this->Index.empty()){
+		return this->NumberOfChunks;
+	}
+	// last index entry at or before the sample, then along the chunks
+	auto Entry = std::upper_bound(this->Index.begin(), this->Index.end(), Sample,
+			[](uint64_t S, const recordingIndexEntry_t &E){ return S < E.firstSample; });
+	uint64_t Chunk = (uint64_t)(Entry -this->Index.begin() -1) *this->Header->indexInterval;
+	const recordingChunkHeader_t *ChunkHeader = DataRecording::GetChunkHeader(Chunk);
+	while (ChunkHeader != NULL && Sample >= ChunkHeader->firstSample +ChunkHeader->numberOfSamples){
+		ChunkHeader = DataRecording::NextChunkHeader(ChunkHeader);
+		Chunk++;
+	}
+	return (ChunkHeader != NULL) ? Chunk : this->NumberOfChunks;
+}
+
+/*
+ * returns the last chunk, which started at or before the time (unix time in us)
+ */
+uint64_t DataRecording::FindChunkByTime(int64_t TimestampUs)
+{
+	if (this->Index.empty()){
+		return this->NumberOfChunks;
+	}
+	auto Entry = std::upper_bound(this->Index.begin(), this->Index.end(), TimestampUs,
+			[](int64_t T, const recordingIndexEntry_t &E){ return T < E.timestampUs; });
+	if (Entry == this->Index.begin()){
+		return 0;
+	}
+	uint64_t Chunk = (uint64_t)(Entry -this->Index.begin() -1) *this->Header->indexInterval;
+	const recordingChunkHeader_t *ChunkHeader = DataRecording::NextChunkHeader(DataRecording::GetChunkHeader(Chunk));
+	while (ChunkHeader != NULL && ChunkHeader->timestampUs <= TimestampUs){
+		ChunkHeader = DataRecording::NextChunkHeader(ChunkHeader);
+		Chunk++;
+	}
+	return Chunk;
+}
+
+/*
+ * copies samples starting with FirstSample -> returns the number of samples copied
+ */
+uint64_t DataRecording::ReadSamples(uint64_t FirstSample, int16_t *Data, uint64_t NumberOfValuesMax)
+{
+	uint64_t NumberOfValues = 0;
+	uint64_t Chunk = DataRecording::FindChunkBySample(FirstSample);
+	const recordingChunkHeader_t *ChunkHeader = DataRecording::GetChunkHeader(Chunk);
+	while (ChunkHeader != NULL && NumberOfValues < NumberOfValuesMax){
+		uint64_t Offset = FirstSample +NumberOfValues -ChunkHeader->firstSample;
+		uint64_t N = std::min((uint64_t)ChunkHeader->numberOfSamples -Offset, NumberOfValuesMax -NumberOfValues);
+		memcpy(&Data[NumberOfValues], (const int16_t*)(ChunkHeader +1) +Offset, N *sizeof(int16_t));
+		NumberOfValues += N;
+		ChunkHeader = DataRecording::NextChunkHeader(ChunkHeader);
+	}
+	return NumberOfValues;
+}
+
+/*
+ * walks all chunks -> for recordings, which were not closed (e.g. the program crashed)
+ */
+bool DataRecording::RebuildIndex(void)
+{
+	this->Index.clear();
+	this->NumberOfSamples = 0;
+	this->NumberOfChunks = 0;
+	this->DataEnd = this->MapSize;
+	uint64_t Offset = this->Header->headerSize;
+	const recordingChunkHeader_t *ChunkHeader;
+	while ((ChunkHeader = DataRecording::ChunkAt(Offset)) != NULL){
+		if (this->NumberOfChunks % this->Header->indexInterval == 0){
+			recordingIndexEntry_t Entry;
+			Entry.firstSample = ChunkHeader->firstSample;
+			Entry.timestampUs = ChunkHeader->timestampUs;
+			Entry.fileOffset  = (const uint8_t*)ChunkHeader -this->Map;
+			this->Index.push_back(Entry);
+		}
+		this->NumberOfSamples = ChunkHeader->firstSample +ChunkHeader->numberOfSamples;
+		this->NumberOfChunks++;
+		Offset = (const uint8_t*)(ChunkHeader +1) -this->Map +ChunkHeader->numberOfSamples *sizeof(int16_t);
+	}
+	// the chunk area ends after the last complete chunk
+	this->DataEnd = Offset;
+	return (this->NumberOfChunks > 0);
+}
+
+const recordingChunkHeader_t* DataRecording::GetChunkHeader(uint64_t Chunk)
+{
+	if (Chunk >= this->NumberOfChunks){
+		return NULL;
+	}
+	const recordingChunkHeader_t *ChunkHeader = DataRecording::ChunkAt(this->Index[Chunk /this->Header->indexInterval].fileOffset);
+	for (uint64_t i=0; i<Chunk %this->Header->indexInterval && ChunkHeader != NULL; i++){
+		ChunkHeader = DataRecording::NextChunkHeader(ChunkHeader);
+	}
+	return ChunkHeader;
+}
+
+/*
+ * -> NULL: no further (complete) chunk
+ */
+const recordingChunkHeader_t* DataRecording::NextChunkHeader(const recordingChunkHeader_t *Chunk)
+{
+	if (Chunk == NULL){
+		return NULL;
+	}
+	return DataRecording::ChunkAt((const uint8_t*)(Chunk +1) -this->Map +Chunk->numberOfSamples *sizeof(int16_t));
+}
+
+/*
+ * returns the chunk at the file offset, if it is complete and within the chunk area
+ */
+const recordingChunkHeader_t* DataRecording::ChunkAt(uint64_t Offset)
+{
+	if (Offset > this->DataEnd || Offset +sizeof(recordingChunkHeader_t) > this->DataEnd){
+		return NULL;
+	}
+	const recordingChunkHeader_t *Chunk = (const recordingChunkHeader_t*)&this->Map[Offset];
+	if (Chunk->magic != RECORDING_CHUNK_MAGIC || Offset +sizeof(recordingChunkHeader_t) +(uint64_t)Chunk->numberOfSamples *sizeof(int16_t) > this->DataEnd){
+		return NULL;
+	}
+	return Chunk;
+}
+
+} // namespace
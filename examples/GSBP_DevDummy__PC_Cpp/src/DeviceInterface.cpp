@@ -29,11 +29,10 @@
 #include "GSBP_DevDummy.hpp"
 #include "DeviceInterface.hpp"
 
-const uint32_t GSBP_DeviceClass__GSBPdevel		= 1;
-
 namespace nsDUMMYDEVICE_01 {
 
 DummyDevice::DummyDevice(const char *DeviceID, const char *SerialDeviceFile)
+	: DataBuffer(DUMMYDEVICE_DATA_BUFFER_SIZE, OverflowDropNewest)
 {
 	/*
 	 * Initialise the private variables
@@ -53,9 +52,34 @@ DummyDevice::DummyDevice(const char *DeviceID, const char *SerialDeviceFile)
 
 	// set the internal variables
 	this->DeviceInitialised = false;
-	this->NumberOfDataValues = 0;
 
 	// communication interface
+	this->Interface = new GSBP_DD((char*)DeviceID, (char*)SerialDeviceFile, GSBP_DeviceClass__GSBPdevel, DummyDevice::GetInterfaceConfiguration());
+	DummyDevice::SubscribeToData();
+}
+
+/*
+ * uses an open file descriptor as device, e.g. the in-memory transport of FakeDevice -> the interface closes it
+ */
+DummyDevice::DummyDevice(const char *DeviceID, int DeviceFd)
+	: DataBuffer(DUMMYDEVICE_DATA_BUFFER_SIZE, OverflowDropNewest)
+{
+	memset(this->DeviceIDClass, 0, sizeof(this->DeviceIDClass));
+	if ( snprintf(this->DeviceIDClass, sizeof(this->DeviceIDClass), "%s", DeviceID) < 0){ // C++11
+		memset(  this->DeviceIDClass, 0, sizeof(this->DeviceIDClass));
+		snprintf(this->DeviceIDClass, sizeof(this->DeviceIDClass), "%s", "DummyDevice");
+	}
+	memset(  this->DeviceFileName, 0, sizeof(this->DeviceFileName));
+	snprintf(this->DeviceFileName, sizeof(this->DeviceFileName), "fd:%d", DeviceFd);
+	this->DeviceInitialised = false;
+
+	// communication interface
+	this->Interface = new GSBP_DD((char*)DeviceID, DeviceFd, GSBP_DeviceClass__GSBPdevel, DummyDevice::GetInterfaceConfiguration());
+	DummyDevice::SubscribeToData();
+}
+
+GSBP_DD::gsbpConfiguration_t DummyDevice::GetInterfaceConfiguration(void)
+{
 	GSBP_DD::gsbpConfiguration_t Config = {0};
     Config.UpdateDeviceID = false;
 	sprintf(Config.DeviceID, "GSBP");
@@ -69,7 +93,16 @@ DummyDevice::DummyDevice(const char *DeviceID, const char *SerialDeviceFile)
 	Config.ApplicationDataACK_ID = (uint16_t)ApplicationDataACK;
 	Config.DisplayWarnings = true;
 	Config.DisplayErrors   = true;
-	this->Interface = new GSBP_DD((char*)DeviceID, (char*)SerialDeviceFile, GSBP_DeviceClass__GSBPdevel, Config);
+	Config.NumberOfHandlerThreads = 1;
+	return Config;
+}
+
+void DummyDevice::SubscribeToData(void)
+{
+	// the measurement data is routed directly from the decoder to the data handler
+	uint16_t ErrorCode;
+	this->Interface->Subscribe((uint16_t)ApplicationDataACK, GSBP_DD::MeasurementDataRequestID,
+			std::bind(&DummyDevice::MeasurementDataHandler, this, std::placeholders::_1), &ErrorCode);
 }
 
 DummyDevice::~DummyDevice(void) {
@@ -174,29 +207,47 @@ bool DummyDevice::StartMCUApplication(uint16_t* ErrorCode)
 
 uint16_t DummyDevice::GetData(int16_t Data[], uint16_t NumberOfValuesMax)
 {
-	uint16_t NumberOfValuesToGet = NumberOfValuesMax;
-	if (NumberOfValuesToGet > this->NumberOfDataValues){
-		NumberOfValuesToGet = this->NumberOfDataValues;
-	}
+	// copy the data to the external memory -> no lock, the receiver keeps adding values meanwhile
+	return (uint16_t)this->DataBuffer.Read(Data, NumberOfValuesMax);
+}
 
-	// look the buffer
-	boost::mutex::scoped_lock lock(this->DataMutex);
+/*
+ * waits until at least NumberOfValues measurement values are received or the timeout elapsed
+ *  -> returns the number of values, which can be fetched with GetData() or BorrowData()
+ */
+uint32_t DummyDevice::WaitForData(uint32_t NumberOfValues, uint32_t TimeoutMs)
+{
+	return this->DataBuffer.WaitForValues(NumberOfValues, TimeoutMs);
+}
 
-	// copy the data to the external memory
-	for (uint16_t i=0; i<NumberOfValuesToGet; i++){
-		Data[i] = this->DataValues[i];
-	}
-	// move the remaining data to the start of the buffer
-	for (uint16_t i=0; i<(this->NumberOfDataValues -NumberOfValuesToGet); i++){
-		this->DataValues[i] = this->DataValues[i +NumberOfValuesToGet];
-	}
-	// update the data counter
-	this->NumberOfDataValues -= NumberOfValuesToGet;
+/*
+ * zero-copy alternative to GetData() -> *Data points to the received values inside the buffer
+ *  -> the values stay valid until ReleaseData(); returns the number of values (0 -> no data)
+ */
+uint32_t DummyDevice::BorrowData(const int16_t **Data, uint32_t NumberOfValuesMax)
+{
+	return this->DataBuffer.Borrow(Data, NumberOfValuesMax);
+}
+/*
+ * -> false: the borrowed values were overwritten in the meantime (only with OverflowDropOldest)
+ */
+bool DummyDevice::ReleaseData(uint32_t NumberOfValues)
+{
+	return this->DataBuffer.Release(NumberOfValues);
+}
 
-	// unlook the buffer
-	lock.unlock();
+/*
+ * sets what happens with new measurement values, if GetData() is not called often enough and the buffer is full
+ *  -> OverflowBlock stalls the GSBP receiver for up to BlockTimeoutMs
+ */
+void DummyDevice::SetDataOverflowPolicy(overflowPolicy_t Policy, uint32_t BlockTimeoutMs)
+{
+	this->DataBuffer.SetOverflowPolicy(Policy, BlockTimeoutMs);
+}
 
-	return NumberOfValuesToGet;
+void DummyDevice::GetDataStatistics(ringStatistics_t *Statistics)
+{
+	this->DataBuffer.GetStatistics(Statistics);
 }
 
 bool DummyDevice::StopMCUApplication(void)
@@ -310,27 +361,26 @@ bool DummyDevice::PackageHandler(GSBP_DD::rxPackage_t *Package, uint64_t Request
 	//	this->DeviceIDClass, RequestID, Package->CommandID);
 	//this->Interface->PrintPackage(Package);
 
-	switch (Package->CommandID){
-	case ApplicationDataACK:{ // Dummy Measurement Data
-		// copy the ACK data to the buffer ...
-
-		// get the ACK data
-		measurementDataACK_t *ack = (measurementDataACK_t*) Package->Data;
-		// look the buffer
-		boost::mutex::scoped_lock lock(this->DataMutex);
-		// copy the ACK data to the buffer
-		for (uint16_t i=0; i<ack->numberOfValues; i++){
-				this->DataValues[this->NumberOfDataValues++] = ack->data[i];
-		}
-		// unlook the buffer
-		lock.unlock();
+	// fallback for all ACK IDs without an own handler (see SetPackageHandler()); the measurement data (ApplicationDataACK) is handled by MeasurementDataHandler()
+	return false;
+}
 
-		return true;
-		} break;
-	default: // do nothing
-		break;
+void DummyDevice::MeasurementDataHandler(GSBP_DD::rxPackage_t *Package)
+{
+	// get the ACK data
+	measurementDataACK_t *ack = (measurementDataACK_t*) Package->Data;
+	if (Package->DataSize < sizeof(ack->numberOfValues)){
+		return;
 	}
-	return false;
+	uint32_t NumberOfValues = ack->numberOfValues;
+	if (NumberOfValues > (Package->DataSize -sizeof(ack->numberOfValues)) /sizeof(ack->data[0])){
+		NumberOfValues = (Package->DataSize -sizeof(ack->numberOfValues)) /sizeof(ack->data[0]);
+	}
+	if (NumberOfValues > DUMMYDEVICE_PAYLOAD_SIZE_MAX){
+		NumberOfValues = DUMMYDEVICE_PAYLOAD_SIZE_MAX;
+	}
+	// copy the ACK data to the buffer -> the overflow policy decides about the values, which do not fit
+	this->DataBuffer.Write((int16_t*)&Package->Data[sizeof(ack->numberOfValues)], NumberOfValues);
 }
 
 const char*	DummyDevice::GetCommandIdString(uint16_t Cmd)
@@ -0,0 +1,530 @@
+/*
+ * # Specific Device Interface #
+ *   C++ Interface class for the GSBP_DevDummy device,
+ *   utilizing the GSBP communication interface class.
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    FakeDevice.cpp -> in-memory fake of the GSBP_DevDummy MCU
+ *   Version: 2 (09.2020)
+ *
+ *   This file is part of GeneralSerialByteProtocol (GSBP).
+ *
+ *   GSBP is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   GSBP is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <algorithm>
+
+#include "FakeDevice.hpp"
+
+namespace nsDUMMYDEVICE_01 {
+
+#define FAKEDEVICE_START_BYTE		0x7E
+#define FAKEDEVICE_END_BYTE			0x81
+#define FAKEDEVICE_HEADER_SIZE		5		// start byte, CMD, request ID, 16 bit size
+#define FAKEDEVICE_IDLE_WAIT_US		100000	// the device thread checks Run at least this often
+#define FAKEDEVICE_MSG_ERROR		2		// gsbp_MsgTypes_t::MsgError
+
+// states of the MCU example (mcuStates_t) used by the fake device
+#define FAKEDEVICE_STATE_PRE_INIT			0		// preInit
+#define FAKEDEVICE_STATE_POST_INIT			2		// postInit
+#define FAKEDEVICE_STATE_MEASUREMENT		4		// measurementActive
+
+static uint64_t GetTimeUs(void)
+{
+	struct timespec Time;
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+	return (uint64_t)Time.tv_sec *1000000 + Time.tv_nsec /1000;
+}
+
+FakeDevice::FakeDevice(void)
+{
+	this->fdDevice = -1;
+	this->fdInterface = -1;
+	this->Run = false;
+	this->DefaultLatencyUs = 0;
+	this->DataPattern = FakeDataRamp;
+	this->DataParameter = 0;
+	this->DataPeriodUs = 0;
+	this->ValuesPerPackage = 0;
+	this->DataLimit = 0;
+	memset(&this->Statistics, 0, sizeof(this->Statistics));
+	this->RxBufferLevel = 0;
+	this->State = FAKEDEVICE_STATE_PRE_INIT;
+	memset(&this->InitConfig, 0, sizeof(this->InitConfig));
+	this->DataValue = 0;
+	this->RandomState = 1;
+	this->NextDataUs = 0;
+	this->DataPackagesSent = 0;
+}
+
+FakeDevice::~FakeDevice(void)
+{
+	FakeDevice::Close();
+}
+
+/*
+ * creates the transport and starts the device -> returns the interface end of the transport or -1
+ *   the returned file descriptor is owned by the GSBP interface (DummyDevice(ID, fd) or GSBP_DD::ConnectToDevice(fd, ...))
+ */
+int FakeDevice::Open(void)
+{
+	if (this->fdDevice >= 0){
+		return -1;
+	}
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0){
+		printf("\e[1m\e[91mFakeDevice ERROR:\e[0m The transport can not be created: %s\n", strerror(errno));
+		return -1;
+	}
+	int BufferSize = FAKEDEVICE_SOCKET_BUFFER_SIZE;
+	for (int i = 0; i < 2; i++){
+		setsockopt(fds[i], SOL_SOCKET, SO_SNDBUF, &BufferSize, sizeof(BufferSize));
+		setsockopt(fds[i], SOL_SOCKET, SO_RCVBUF, &BufferSize, sizeof(BufferSize));
+	}
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	this->fdDevice = fds[0];
+	this->fdInterface = fds[1];
+
+	// device state after power up
+	memset(&this->Statistics, 0, sizeof(this->Statistics));
+	this->PendingResponses.clear();
+	this->RxBufferLevel = 0;
+	this->State = FAKEDEVICE_STATE_PRE_INIT;
+
+	this->Run = true;
+	this->DeviceThread = boost::thread(&FakeDevice::DeviceLoop, this);
+	return this->fdInterface;
+}
+
+/*
+ * stops the device -> delete the DummyDevice/GSBP interface first; the interface reads an closed transport otherwise
+ */
+void FakeDevice::Close(void)
+{
+	if (this->fdDevice < 0){
+		return;
+	}
+	this->Run = false;
+	this->DeviceThread.join();
+	close(this->fdDevice);
+	this->fdDevice = -1;
+	this->fdInterface = -1;
+}
+
+/*
+ * configures the reaction to a command -> LatencyUs: time between the reception of the command and the response
+ */
+void FakeDevice::SetCommandBehaviour(uint16_t CommandID, fakeAction_t Action, uint32_t LatencyUs)
+{
+	boost::mutex::scoped_lock lock(this->Config_mutex);
+	behaviour_t B = {Action, LatencyUs};
+	this->Behaviour[CommandID] = B;
+}
+
+/*
+ * latency of all commands without a SetCommandBehaviour() entry
+ */
+void FakeDevice::SetDefaultLatency(uint32_t LatencyUs)
+{
+	boost::mutex::scoped_lock lock(this->Config_mutex);
+	this->DefaultLatencyUs = LatencyUs;
+}
+
+/*
+ * values of the measurement data -> takes effect with the next InitCMD
+ */
+void FakeDevice::SetDataPattern(fakeDataPattern_t Pattern, int16_t Parameter)
+{
+	boost::mutex::scoped_lock lock(this->Config_mutex);
+	this->DataPattern = Pattern;
+	this->DataParameter = Parameter;
+}
+
+/*
+ * overrides the data period and the package size of the InitCMD -> PeriodUs 0: send as fast as the transport takes it
+ *   SetDataRate(0, 0) restores the behaviour of the MCU (period and size of the InitCMD)
+ */
+void FakeDevice::SetDataRate(uint32_t PeriodUs, uint16_t ValuesPerPackage)
+{
+	boost::mutex::scoped_lock lock(this->Config_mutex);
+	this->DataPeriodUs = PeriodUs;
+	this->ValuesPerPackage = (ValuesPerPackage > DUMMYDEVICE_PAYLOAD_SIZE_MAX) ? DUMMYDEVICE_PAYLOAD_SIZE_MAX : ValuesPerPackage;
+}
+
+/*
+ * stops the data stream after NumberOfPackages packages per StartApplicationCMD -> 0: unlimited
+ */
+void FakeDevice::SetDataLimit(uint64_t NumberOfPackages)
+{
+	boost::mutex::scoped_lock lock(this->Config_mutex);
+	this->DataLimit = NumberOfPackages;
+}
+
+void FakeDevice::GetStatistics(fakeDeviceStatistics_t *Statistics)
+{
+	boost::mutex::scoped_lock lock(this->Config_mutex);
+	*Statistics = this->Statistics;
+}
+
+
+/*
+ * ### device thread ###
+ */
+void FakeDevice::DeviceLoop(void)
+{
+	while (this->Run){
+		uint64_t Now = GetTimeUs();
+
+		// send the responses, which are due
+		while (!this->PendingResponses.empty() && this->PendingResponses.begin()->first <= Now){
+			std::vector<uint8_t> &Frame = this->PendingResponses.begin()->second;
+			if (FakeDevice::SendBytes(Frame.data(), Frame.size())){
+				boost::mutex::scoped_lock lock(this->Config_mutex);
+				this->Statistics.ResponsesSent++;
+			}
+			this->PendingResponses.erase(this->PendingResponses.begin());
+		}
+
+		// data stream
+		bool Streaming = false;
+		uint32_t PeriodUs = 0;
+		if (this->State == FAKEDEVICE_STATE_MEASUREMENT){
+			boost::mutex::scoped_lock lock(this->Config_mutex);
+			Streaming = (this->DataLimit == 0 || this->DataPackagesSent < this->DataLimit);
+			PeriodUs  = (this->DataPeriodUs > 0 || this->ValuesPerPackage > 0) ? this->DataPeriodUs : (uint32_t)this->InitConfig.dataPeriodMS *1000;
+		}
+		if (Streaming && this->NextDataUs <= Now){
+			FakeDevice::SendData();
+			// keep the rate, but do not burst if the interface was not able to take the data
+			this->NextDataUs += PeriodUs;
+			if (this->NextDataUs + PeriodUs < Now){
+				this->NextDataUs = Now;
+			}
+		}
+
+		// wait for a command or the next event
+		uint64_t WaitUs = FAKEDEVICE_IDLE_WAIT_US;
+		Now = GetTimeUs();
+		if (!this->PendingResponses.empty()){
+			uint64_t Due = this->PendingResponses.begin()->first;
+			WaitUs = (Due <= Now) ? 0 : std::min(WaitUs, Due - Now);
+		}
+		if (Streaming){
+			WaitUs = (this->NextDataUs <= Now) ? 0 : std::min(WaitUs, this->NextDataUs - Now);
+		}
+		struct pollfd P = {this->fdDevice, POLLIN, 0};
+		struct timespec Timeout = {(time_t)(WaitUs /1000000), (long)(WaitUs %1000000) *1000};
+		int Events = ppoll(&P, 1, &Timeout, NULL);
+		if (Events < 0 && errno != EINTR){
+			printf("\e[1m\e[91mFakeDevice ERROR:\e[0m Waiting for a command failed: %s\n", strerror(errno));
+			break;
+		}
+		if (Events <= 0){
+			continue;
+		}
+		if (P.revents & POLLIN){
+			ssize_t BytesRead = read(this->fdDevice, this->RxBuffer + this->RxBufferLevel, sizeof(this->RxBuffer) - this->RxBufferLevel);
+			if (BytesRead > 0){
+				{
+					boost::mutex::scoped_lock lock(this->Config_mutex);
+					this->Statistics.BytesReceived += BytesRead;
+				}
+				this->RxBufferLevel += BytesRead;
+				FakeDevice::DecodeFrames();
+				continue;
+			}
+			if (BytesRead < 0 && (errno == EAGAIN || errno == EINTR)){
+				continue;
+			}
+		}
+		// the interface closed its end of the transport
+		if (P.revents & (POLLIN | POLLHUP | POLLERR)){
+			break;
+		}
+	}
+}
+
+/*
+ * |0x7E|CMD|ReqID|size lo|size hi|payload|0x81| -> decodes all complete frames in the receive buffer
+ */
+void FakeDevice::DecodeFrames(void)
+{
+	uint32_t Pos = 0;
+	while (Pos < this->RxBufferLevel){
+		// search the start byte
+		if (this->RxBuffer[Pos] != FAKEDEVICE_START_BYTE){
+			boost::mutex::scoped_lock lock(this->Config_mutex);
+			this->Statistics.FramingErrors++;
+			Pos++;
+			continue;
+		}
+		if (this->RxBufferLevel - Pos < FAKEDEVICE_HEADER_SIZE){
+			break;
+		}
+		uint16_t DataSize = this->RxBuffer[Pos +3] | (this->RxBuffer[Pos +4] << 8);
+		uint32_t FrameSize = FAKEDEVICE_HEADER_SIZE + DataSize +1;
+		if (FrameSize > sizeof(this->RxBuffer)){
+			// can not be a frame -> search the next start byte
+			boost::mutex::scoped_lock lock(this->Config_mutex);
+			this->Statistics.FramingErrors++;
+			Pos++;
+			continue;
+		}
+		if (this->RxBufferLevel - Pos < FrameSize){
+			break;
+		}
+		if (this->RxBuffer[Pos + FrameSize -1] != FAKEDEVICE_END_BYTE){
+			boost::mutex::scoped_lock lock(this->Config_mutex);
+			this->Statistics.FramingErrors++;
+			Pos++;
+			continue;
+		}
+		FakeDevice::HandleCommand(this->RxBuffer[Pos +1], this->RxBuffer[Pos +2], &this->RxBuffer[Pos + FAKEDEVICE_HEADER_SIZE], DataSize);
+		Pos += FrameSize;
+	}
+	// keep the incomplete frame
+	if (Pos > 0){
+		memmove(this->RxBuffer, this->RxBuffer + Pos, this->RxBufferLevel - Pos);
+		this->RxBufferLevel -= Pos;
+	}
+}
+
+/*
+ * the command handler of the GSBP_DevDummy MCU; the response is send after the configured latency
+ */
+void FakeDevice::HandleCommand(uint8_t CommandID, uint8_t RequestID, const uint8_t *Data, uint16_t DataSize)
+{
+	behaviour_t B = {FakeAnswer, 0};
+	{
+		boost::mutex::scoped_lock lock(this->Config_mutex);
+		this->Statistics.CommandsReceived++;
+		std::map<uint16_t, behaviour_t>::iterator it = this->Behaviour.find(CommandID);
+		if (it != this->Behaviour.end()){
+			B = it->second;
+		} else {
+			B.LatencyUs = this->DefaultLatencyUs;
+		}
+		if (B.Action == FakeIgnore){
+			this->Statistics.CommandsIgnored++;
+			return;
+		}
+	}
+	uint64_t DueUs = GetTimeUs() + B.LatencyUs;
+	if (B.Action == FakeErrorMessage){
+		FakeDevice::QueueMessage(RequestID, E_CMD_NotValidNow, "command rejected by the fake device", DueUs);
+		return;
+	}
+	if (B.Action == FakeEcho){
+		FakeDevice::QueueResponse((uint8_t)(CommandID +1), RequestID, Data, DataSize, DueUs);
+		return;
+	}
+
+	uint8_t Ack[3];
+	switch (CommandID){
+		case NodeInfoCMD: {
+			GSBP_DD::gsbp_ACK_nodeInfo_t NodeInfo;
+			memset(&NodeInfo, 0, sizeof(NodeInfo));
+			NodeInfo.deviceClass = GSBP_DeviceClass__GSBPdevel;
+			NodeInfo.serialNumber = FAKEDEVICE_SERIAL_NUMBER;
+			NodeInfo.versionProtocol[1] = 1;
+			NodeInfo.versionFirmware[1] = 1;
+			memcpy(NodeInfo.msg, FAKEDEVICE_NODE_INFO_MSG, sizeof(FAKEDEVICE_NODE_INFO_MSG));
+			FakeDevice::QueueResponse(NodeInfoACK, RequestID, &NodeInfo,
+					(uint16_t)(sizeof(NodeInfo) - sizeof(NodeInfo.msg) + sizeof(FAKEDEVICE_NODE_INFO_MSG)), DueUs);
+			break;
+		}
+		case StatusCMD: {
+			mcuStatus_t Status;
+			Status.errorCode = E_NoError;
+			Status.state = this->State;
+			int MsgSize = snprintf((char*)Status.msg, sizeof(Status.msg), "FAKE DEVICE: state %u", this->State);
+			FakeDevice::QueueResponse(StatusACK, RequestID, &Status, (uint16_t)(sizeof(Status) - sizeof(Status.msg) + MsgSize +1), DueUs);
+			break;
+		}
+		case InitCMD: {
+			if (DataSize < sizeof(initCMD_t)){
+				FakeDevice::QueueMessage(RequestID, E_BufferToSmall, "InitCMD: payload too small", DueUs);
+				break;
+			}
+			if (this->State == FAKEDEVICE_STATE_MEASUREMENT){
+				FakeDevice::QueueMessage(RequestID, E_CMD_NotValidNow, "InitCMD: measurement is active", DueUs);
+				break;
+			}
+			memcpy(&this->InitConfig, Data, sizeof(initCMD_t));
+			if (this->InitConfig.dataSize > DUMMYDEVICE_PAYLOAD_SIZE_MAX){
+				this->InitConfig.dataSize = DUMMYDEVICE_PAYLOAD_SIZE_MAX;
+			}
+			{
+				boost::mutex::scoped_lock lock(this->Config_mutex);
+				this->DataValue = (this->DataPattern == FakeDataConstant) ? this->DataParameter : 0;
+				this->RandomState = 0x9E3779B9u ^ (uint16_t)this->DataParameter;
+			}
+			initACK_t InitAck;
+			InitAck.success = true;
+			InitAck.dataSize = this->InitConfig.dataSize;
+			InitAck.dataPeriodMS = this->InitConfig.dataPeriodMS;
+			InitAck.increment = this->InitConfig.increment;
+			this->State = FAKEDEVICE_STATE_POST_INIT;
+			FakeDevice::QueueResponse(InitACK, RequestID, &InitAck, sizeof(InitAck), DueUs);
+			break;
+		}
+		case StartApplicationCMD:
+			if (this->State != FAKEDEVICE_STATE_POST_INIT){
+				FakeDevice::QueueMessage(RequestID, E_CMD_NotValidNow, "StartApplicationCMD: not initialised", DueUs);
+				break;
+			}
+			// the first data package follows the response
+			this->State = FAKEDEVICE_STATE_MEASUREMENT;
+			this->DataPackagesSent = 0;
+			this->NextDataUs = DueUs;
+			Ack[0] = CommandID; Ack[1] = 0; Ack[2] = true;
+			FakeDevice::QueueResponse(UniversalACK, RequestID, Ack, sizeof(Ack), DueUs);
+			break;
+		case StopApplicationCMD:
+		case DeInitCMD:
+		case ResetCMD:
+			this->State = (CommandID == StopApplicationCMD) ? FAKEDEVICE_STATE_POST_INIT : FAKEDEVICE_STATE_PRE_INIT;
+			Ack[0] = CommandID; Ack[1] = 0; Ack[2] = true;
+			FakeDevice::QueueResponse(UniversalACK, RequestID, Ack, sizeof(Ack), DueUs);
+			break;
+		default:
+			FakeDevice::QueueMessage(RequestID, E_UnknownCMD, "unknown command", DueUs);
+			break;
+	}
+}
+
+void FakeDevice::QueueResponse(uint8_t AckID, uint8_t RequestID, const void *Data, uint16_t DataSize, uint64_t DueUs)
+{
+	std::vector<uint8_t> Frame(FAKEDEVICE_HEADER_SIZE + DataSize +1);
+	Frame[0] = FAKEDEVICE_START_BYTE;
+	Frame[1] = AckID;
+	Frame[2] = RequestID;
+	Frame[3] = DataSize & 0xFF;
+	Frame[4] = DataSize >> 8;
+	memcpy(&Frame[FAKEDEVICE_HEADER_SIZE], Data, DataSize);
+	Frame[FAKEDEVICE_HEADER_SIZE + DataSize] = FAKEDEVICE_END_BYTE;
+	this->PendingResponses.insert(std::make_pair(DueUs, Frame));
+}
+
+void FakeDevice::QueueMessage(uint8_t RequestID, uint16_t ErrorCode, const char *Message, uint64_t DueUs)
+{
+	uint8_t Msg[256];
+	size_t MsgSize = strlen(Message) +1;
+	if (MsgSize > sizeof(Msg) -4){
+		MsgSize = sizeof(Msg) -4;
+	}
+	Msg[0] = FAKEDEVICE_MSG_ERROR;
+	Msg[1] = this->State;
+	Msg[2] = ErrorCode & 0xFF;
+	Msg[3] = ErrorCode >> 8;
+	memcpy(&Msg[4], Message, MsgSize);
+	Msg[sizeof(Msg) -1] = 0;
+	FakeDevice::QueueResponse(MessageACK, RequestID, Msg, (uint16_t)(4 + MsgSize), DueUs);
+}
+
+/*
+ * sends the complete frame -> waits while the transport is full, but not longer than the device runs
+ */
+bool FakeDevice::SendBytes(const uint8_t *Data, size_t Size)
+{
+	size_t Sent = 0;
+	while (Sent < Size){
+		ssize_t n = send(this->fdDevice, Data + Sent, Size - Sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n > 0){
+			Sent += n;
+			continue;
+		}
+		if (n < 0 && (errno == EAGAIN || errno == EINTR)){
+			if (!this->Run){
+				return false;
+			}
+			struct pollfd P = {this->fdDevice, POLLOUT, 0};
+			poll(&P, 1, FAKEDEVICE_IDLE_WAIT_US /1000);
+			continue;
+		}
+		// the interface closed its end of the transport
+		this->Run = false;
+		return false;
+	}
+	boost::mutex::scoped_lock lock(this->Config_mutex);
+	this->Statistics.BytesSent += Size;
+	return true;
+}
+
+int16_t FakeDevice::NextValue(void)
+{
+	int16_t Value;
+	switch (this->DataPattern){
+		case FakeDataConstant:
+			return this->DataParameter;
+		case FakeDataRandom:
+			// xorshift32 -> the same sequence for the same seed
+			this->RandomState ^= this->RandomState << 13;
+			this->RandomState ^= this->RandomState >> 17;
+			this->RandomState ^= this->RandomState << 5;
+			return (int16_t)(this->RandomState & 0xFFFF);
+		case FakeDataRamp:
+		default:
+			Value = this->DataValue;
+			this->DataValue = (int16_t)(this->DataValue + this->InitConfig.increment);
+			return Value;
+	}
+}
+
+/*
+ * sends one ApplicationDataACK package (RequestID 255, like the MCU)
+ */
+bool FakeDevice::SendData(void)
+{
+	uint8_t  Frame[FAKEDEVICE_HEADER_SIZE + sizeof(measurementDataACK_t) +1];
+	measurementDataACK_t *D = (measurementDataACK_t*)&Frame[FAKEDEVICE_HEADER_SIZE];
+	uint16_t NumberOfValues;
+	{
+		boost::mutex::scoped_lock lock(this->Config_mutex);
+		NumberOfValues = (this->ValuesPerPackage > 0) ? this->ValuesPerPackage : this->InitConfig.dataSize;
+		if (NumberOfValues == 0){
+			NumberOfValues = 1;
+		}
+		for (uint16_t i = 0; i < NumberOfValues; i++){
+			D->data[i] = FakeDevice::NextValue();
+		}
+	}
+	D->numberOfValues = NumberOfValues;
+	uint16_t DataSize = sizeof(D->numberOfValues) + NumberOfValues *sizeof(int16_t);
+	Frame[0] = FAKEDEVICE_START_BYTE;
+	Frame[1] = ApplicationDataACK;
+	Frame[2] = GSBP_DD::MeasurementDataRequestID;
+	Frame[3] = DataSize & 0xFF;
+	Frame[4] = DataSize >> 8;
+	Frame[FAKEDEVICE_HEADER_SIZE + DataSize] = FAKEDEVICE_END_BYTE;
+	if (!FakeDevice::SendBytes(Frame, FAKEDEVICE_HEADER_SIZE + DataSize +1)){
+		return false;
+	}
+	this->DataPackagesSent++;
+	boost::mutex::scoped_lock lock(this->Config_mutex);
+	this->Statistics.DataPackagesSent++;
+	this->Statistics.DataValuesSent += NumberOfValues;
+	return true;
+}
+
+} // namespace
@@ -32,6 +32,8 @@
 #include <cerrno>
 
 #include "DeviceInterface.hpp"
+#include "DataRecorder.hpp"
+#include "CsvWriter.hpp"
 
 using namespace std;
 using namespace nsDUMMYDEVICE_01;
@@ -50,9 +52,13 @@ int main ( int argc, char *argv[] )
 
 	char *DeviceName;
 	char  NameTemp[100] = {0};
-	FILE *fdData;
+	CsvWriter Csv;
+	DataRecorder Recorder;
+	bool RecordBinary = false;
 
 	int ValuesToGet = 0, ValuesReceived = 0;
+	uint64_t ValuesNotRecorded = 0;	// values refused by the binary recorder (write error)
+	ringStatistics_t DataStatistics = {0};
 	int WatchdogTime = 0;
 	int StatusProzent = 0, StatusProzentOld = 0;
 	struct timeval Time;
@@ -60,7 +66,7 @@ int main ( int argc, char *argv[] )
 
 	if (argc < 3){ // at least 2 Arguments
 		// We print argv[0] assuming it is the program name
-		cout << "Usage: " << argv[0] << " <device name> <number of data values>\n";
+		cout << "Usage: " << argv[0] << " <device name> <number of data values> [csv|bin]\n";
 		exit(-1);
 
 		// Debug options
@@ -77,14 +83,19 @@ int main ( int argc, char *argv[] )
 			fprintf(stderr,	"Error: Number of values invalid! Must be a number between 1 and 100000000! (IS: \'%i\')\n", ValuesToGet);
 			exit(-1);
 		}
+		// output format -> binary recording (see DataRecorder.hpp) or CSV
+		if (argc > 3 && strcmp(argv[3], "bin") == 0){
+			RecordBinary = true;
+		}
 	}
 
 	// output file
-	sprintf(NameTemp, "Dummy_Data.csv");
-	fdData = fopen(NameTemp, "w");
-	if (fdData < NULL){
-		fprintf(stderr,"Error: Output file \'%s\' can not be opened. \n\n", NameTemp);
-		exit(-1);
+	if (!RecordBinary){
+		sprintf(NameTemp, "Dummy_Data.csv");
+		if (!Csv.Open(NameTemp)){
+			fprintf(stderr,"Error: Output file \'%s\' can not be opened. \n\n", NameTemp);
+			exit(-1);
+		}
 	}
 
 	// Main program
@@ -125,6 +136,13 @@ int main ( int argc, char *argv[] )
 	// get and print NodeInfo
 	GSBP_DD::gsbp_ACK_nodeInfo_t NodeInfo = {0};
 	Device->GetNodeInfo(&NodeInfo, true);
+	if (RecordBinary){
+		sprintf(NameTemp, "Dummy_Data.gsbprec");
+		if (!Recorder.Open(NameTemp, &NodeInfo, 1000.0 /InitSetup.dataPeriodMS *InitSetup.dataSize, 0)){
+			delete Device;
+			exit(-1);
+		}
+	}
 
 	/*
 	 *  LOOP to get the dummy data
@@ -140,8 +158,8 @@ int main ( int argc, char *argv[] )
 	Device->GetStatus(&Status); // TODO: do something with this
 
 	// dummy data
-	int16_t DataValues[N_DATA_VALUES_MAX];
-	uint16_t NumberOfValues = 0;
+	const int16_t *DataValues = NULL;
+	uint32_t NumberOfValues = 0;
 
 	// starting the dummy measurement
 	Device->StartMCUApplication();
@@ -151,12 +169,20 @@ int main ( int argc, char *argv[] )
 		gettimeofday(&Time,NULL);
 		T2 = Time.tv_sec * 1000.0 + Time.tv_usec / 1000.0;
 
-		// get dummy data
-		NumberOfValues = Device->GetData(DataValues, N_DATA_VALUES_MAX);
-		if (NumberOfValues > 0){
-			for (uint16_t i=0; i<NumberOfValues; i++){
-				ValuesReceived++;
-				fprintf(fdData, "%+06d, %+5d\n", ValuesReceived, DataValues[i]);
+		// get dummy data -> wait for the next values and write them directly out of the receive buffer
+		if (Device->WaitForData(1, 100) > 0){
+			while ((NumberOfValues = Device->BorrowData(&DataValues, N_DATA_VALUES_MAX)) > 0){
+				// the values are formatted/written by the writer threads
+				// the CSV writer counts the values, which did not fit into its buffer, itself
+				if (RecordBinary){
+					if (!Recorder.Write(DataValues, NumberOfValues)){
+						ValuesNotRecorded += NumberOfValues;
+					}
+				} else {
+					Csv.Write(DataValues, NumberOfValues);
+				}
+				ValuesReceived += NumberOfValues;
+				Device->ReleaseData(NumberOfValues);
 			}
 			WatchdogTime = 0;
 		}
@@ -169,9 +195,8 @@ int main ( int argc, char *argv[] )
 			StatusProzentOld = StatusProzent;
 		}
 
-		usleep(10000); // 10ms
-		WatchdogTime++;
-		if (WatchdogTime > 200){
+		WatchdogTime++; // 100ms without data
+		if (WatchdogTime > 20){
 			// no new value was received in 2 sec -> abort
 			printf("\n\e[1m\e[91mWatchdog was triggered:\e[0m no new value within 2 sec received! -> aborting\n\n");
 			break;
@@ -186,18 +211,44 @@ int main ( int argc, char *argv[] )
 	// deinitialising the device
 	Device->DeinitialiseMCU();
 
+	// values lost in the receive buffer
+	Device->GetDataStatistics(&DataStatistics);
+
 	// free memory
 	delete Device;
 
-	// close the files
-	fflush(fdData);
-	fclose(fdData);
+	// close the files -> report every lost value
+	bool DataLost = false;
+	if (RecordBinary){
+		if (!Recorder.Close()){
+			fprintf(stderr, "Error: The recording \'%s\' could not be written completely!\n", NameTemp);
+			DataLost = true;
+		}
+		if (ValuesNotRecorded > 0){
+			fprintf(stderr, "Error: %llu values were not recorded!\n", (unsigned long long)ValuesNotRecorded);
+			DataLost = true;
+		}
+	} else {
+		if (!Csv.Close()){
+			fprintf(stderr, "Error: The output file \'%s\' could not be written completely!\n", NameTemp);
+			DataLost = true;
+		}
+		if (Csv.GetNumberOfDroppedValues() > 0){
+			fprintf(stderr, "Error: %llu values were dropped by the CSV writer (buffer full)!\n", (unsigned long long)Csv.GetNumberOfDroppedValues());
+			DataLost = true;
+		}
+	}
+	if (DataStatistics.ValuesDropped > 0){
+		fprintf(stderr, "Error: %llu values were dropped in the receive buffer (%llu overflows)!\n",
+				(unsigned long long)DataStatistics.ValuesDropped, (unsigned long long)DataStatistics.Overflows);
+		DataLost = true;
+	}
 
 	// end the program
 	gettimeofday(&Time,NULL);
 	T2 = Time.tv_sec*1000 + Time.tv_usec/1000;
 	printf("\nProgram done\nProgram runtime: %f sec\n\n", (T2 -T1) / 1000.0);
-	exit(0);
+	exit(DataLost ? -1 : 0);
 }
 
 void abort_program(int sig) {
@@ -0,0 +1,399 @@
+/*
+ * # Benchmark #
+ *   a C++ program to measure the hot paths of the GSBP interface class
+ *   with the in-memory fake of the GSBP_DevDummy device.
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    Benchmark.cpp -> Source file for the microbenchmarks (not part of the DevSAP build)
+ *   Version: 1 (09.2020)
+ *
+ *   This file is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This file is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <vector>
+#include <unistd.h>
+
+#include "FakeDevice.hpp"
+
+using namespace std;
+using namespace nsDUMMYDEVICE_01;
+
+/*
+ * cases (one result line per case and payload size):
+ *   send      SendPackage(): encoding, request table, writev() -> the fake device drops the command
+ *   decode    receive path of measurement data: decoder, BuildPackage(), subscription sink (replay of a byte dump)
+ *   response  receive path of responses: decoder, BuildPackage(), AddResponse() lookup, package handler (replay)
+ *   pipelined SendPackagesPipelined() with 64 requests in flight -> AddResponse() matching; includes the transport
+ *   roundtrip SendPackage() + GetResponse() one at a time -> wake up of the waiting thread; includes the transport
+ *   getdata   DummyDevice::GetData() of the values in the data buffer; one package = payload/2 values
+ */
+#define BENCHMARK_CMD_ID				100		// not a GSBP_DevDummy command; the fake device drops it
+#define BENCHMARK_WINDOW_SIZE			64
+#define BENCHMARK_DEFAULT_PACKAGES		20000
+#define BENCHMARK_FRAME_OVERHEAD		6		// start byte, CMD, request ID, 16 bit size, end byte
+
+static const uint32_t PayloadSizes[] = {0, 16, 64, 256, 1024, gsbp_RxMaxUserDataSize};
+
+// allocation counter -> every operator new of the program is counted
+static std::atomic<uint64_t> Allocations(0);
+void* operator new(size_t Size)
+{
+	Allocations.fetch_add(1, std::memory_order_relaxed);
+	void* P = malloc(Size ? Size : 1);
+	if (P == NULL){
+		throw std::bad_alloc();
+	}
+	return P;
+}
+void* operator new[](size_t Size)
+{
+	return operator new(Size);
+}
+void operator delete(void* P) noexcept
+{
+	free(P);
+}
+void operator delete[](void* P) noexcept
+{
+	free(P);
+}
+void operator delete(void* P, size_t Size) noexcept
+{
+	free(P);
+}
+void operator delete[](void* P, size_t Size) noexcept
+{
+	free(P);
+}
+
+struct result_t {
+	const char* Case;
+	uint32_t PayloadSize;
+	uint64_t Packages;
+	double   Seconds;
+	uint64_t Bytes;
+	uint64_t Allocations;
+};
+static FILE* Output = stdout;
+
+static void PrintResult(result_t* R)
+{
+	fprintf(Output, "%s,%u,%llu,%.1f,%.2f,%.3f\n", R->Case, R->PayloadSize, (unsigned long long)R->Packages,
+			(R->Packages > 0) ? R->Seconds *1e9 /R->Packages : 0.0,
+			(R->Seconds > 0) ? R->Bytes /R->Seconds /1e6 : 0.0,
+			(R->Packages > 0) ? (double)R->Allocations /R->Packages : 0.0);
+	fflush(Output);
+}
+
+static GSBP_DD::gsbpConfiguration_t GetConfiguration(void)
+{
+	GSBP_DD::gsbpConfiguration_t Config = {0};
+	Config.UpdateDeviceID = false;
+	sprintf(Config.DeviceID, "GSBP");
+	Config.UseThreadToRead = true;
+	Config.NodeInfoCMD_ID = (uint16_t)NodeInfoCMD;
+	Config.NodeInfoACK_ID = (uint16_t)NodeInfoACK;
+	Config.MessageACK_ID  = (uint16_t)MessageACK;
+	Config.ApplicationDataACK_ID = (uint16_t)ApplicationDataACK;
+	Config.DisplayWarnings = true;
+	Config.DisplayErrors   = true;
+	Config.NumberOfHandlerThreads = 1;
+	return Config;
+}
+
+// stdout only carries the CSV lines -> no statistics at the destruction, the log messages go to stderr
+static void QuietInterface(GSBP_DD* Interface)
+{
+	Interface->EnableDebugCategory(GSBP_DD::DebugGsbpStats, false);
+	Interface->SetLogSink([](const GSBP_DD::logRecord_t* Record){
+		fprintf(stderr, "Benchmark: %s\n", Record->Message);
+	});
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point Start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+}
+
+/*
+ * ### request path (fake device) ###
+ */
+static bool RunRequestCase(const char* Case, uint32_t PayloadSize, uint64_t Packages)
+{
+	FakeDevice Fake;
+	Fake.SetCommandBehaviour(BENCHMARK_CMD_ID, FakeIgnore, 0);
+	int fd = Fake.Open();
+	if (fd < 0){
+		return false;
+	}
+	result_t R = {Case, PayloadSize, 0, 0.0, 0, 0};
+	{
+		GSBP_DD Interface((char*)"Benchmark", fd, GSBP_DeviceClass__GSBPdevel, GetConfiguration());
+		QuietInterface(&Interface);
+		if (!Interface.IsDeviceConnected()){
+			return false;
+		}
+		GSBP_DD::txPackage_t P = {0};
+		P.CommandID = (strcmp(Case, "send") == 0) ? BENCHMARK_CMD_ID : StatusCMD;
+		P.DataSize = PayloadSize;
+		for (uint32_t i=0; i<PayloadSize; i++){
+			P.Data[i] = (uint8_t)i;
+		}
+		uint16_t ErrorCode;
+		uint64_t Failed = 0;
+		std::vector<GSBP_DD::pipelineRequest_t> Requests;
+		if (strcmp(Case, "pipelined") == 0){
+			Requests.resize(Packages);
+			for (uint64_t i=0; i<Packages; i++){
+				Requests[i].Cmd = &P;
+				Requests[i].AckId = StatusACK;
+				Requests[i].Ack = NULL;
+			}
+		}
+
+		uint64_t AllocationsStart = Allocations.load();
+		std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+		if (strcmp(Case, "send") == 0){
+			for (uint64_t i=0; i<Packages; i++){
+				if (Interface.SendPackage(&P, &ErrorCode) == 0){
+					Failed++;
+				}
+			}
+		} else if (strcmp(Case, "roundtrip") == 0){
+			GSBP_DD::rxPackage_t Ack;
+			uint32_t NumberOfOpenRequests;
+			for (uint64_t i=0; i<Packages; i++){
+				uint64_t RequestID = Interface.SendPackage(&P, &ErrorCode);
+				if (RequestID == 0 || !Interface.GetResponse(RequestID, StatusACK, &Ack, 1000, &NumberOfOpenRequests, &ErrorCode)){
+					Failed++;
+				}
+			}
+		} else {
+			uint32_t NumberOfFailedRequests;
+			Interface.SendPackagesPipelined(Requests.data(), (uint32_t)Packages, BENCHMARK_WINDOW_SIZE, 1000, &NumberOfFailedRequests);
+			Failed = NumberOfFailedRequests;
+		}
+		R.Seconds = SecondsSince(Start);
+		R.Allocations = Allocations.load() - AllocationsStart;
+		R.Packages = Packages - Failed;
+		R.Bytes = R.Packages *(PayloadSize + BENCHMARK_FRAME_OVERHEAD);
+		if (Failed > 0){
+			fprintf(stderr, "%s (%u bytes): %llu requests failed\n", Case, PayloadSize, (unsigned long long)Failed);
+		}
+	}
+	Fake.Close();
+	PrintResult(&R);
+	return true;
+}
+
+/*
+ * ### receive path (replay of a byte dump) ###
+ */
+static bool RunReceiveCase(const char* Case, uint32_t PayloadSize, uint64_t Packages)
+{
+	bool IsData = (strcmp(Case, "decode") == 0);
+
+	// byte dump of the packages -> replayed as raw received bytes
+	char FileName[] = "/tmp/gsbp_benchmark_XXXXXX";
+	int fd = mkstemp(FileName);
+	if (fd < 0){
+		fprintf(stderr, "%s: The byte dump can not be created: %s\n", Case, strerror(errno));
+		return false;
+	}
+	std::vector<uint8_t> Frame(PayloadSize + BENCHMARK_FRAME_OVERHEAD);
+	std::vector<uint8_t> Dump;
+	Dump.reserve(1024*1024);
+	bool WriteOk = true;
+	for (uint64_t i=0; i<Packages && WriteOk; i++){
+		Frame[0] = 0x7E;
+		Frame[1] = IsData ? ApplicationDataACK : StatusACK;
+		Frame[2] = IsData ? (uint8_t)GSBP_DD::MeasurementDataRequestID : (uint8_t)(1 + i % gsbp_MaxRequestIdLocal);
+		Frame[3] = PayloadSize & 0xFF;
+		Frame[4] = PayloadSize >> 8;
+		for (uint32_t j=0; j<PayloadSize; j++){
+			Frame[5 +j] = (uint8_t)(i +j);
+		}
+		Frame[5 + PayloadSize] = 0x81;
+		Dump.insert(Dump.end(), Frame.begin(), Frame.end());
+		if (Dump.size() >= 1024*1024 || i +1 == Packages){
+			WriteOk = (write(fd, Dump.data(), Dump.size()) == (ssize_t)Dump.size());
+			Dump.clear();
+		}
+	}
+	close(fd);
+	if (!WriteOk){
+		unlink(FileName);
+		return false;
+	}
+
+	result_t R = {Case, PayloadSize, 0, 0.0, 0, 0};
+	{
+		GSBP_DD Interface((char*)"Benchmark");
+		QuietInterface(&Interface);
+		uint16_t ErrorCode;
+		Interface.UpdateConfiguration(GetConfiguration(), &ErrorCode);
+		std::atomic<uint64_t> Received(0);
+		Interface.Subscribe((uint16_t)ApplicationDataACK, GSBP_DD::MeasurementDataRequestID,
+				[&](GSBP_DD::rxPackage_t *Package){ Received.fetch_add(1, std::memory_order_relaxed); }, &ErrorCode);
+
+		GSBP_DD::replayStatistics_t Stats;
+		uint64_t AllocationsStart = Allocations.load();
+		bool ReplayOk = Interface.ReplayCapture(FileName, false, &Stats, &ErrorCode);
+		R.Allocations = Allocations.load() - AllocationsStart;
+		R.Seconds = Stats.Seconds;
+		R.Packages = Stats.PackagesDecoded;
+		R.Bytes = Stats.BytesReplayed;
+		if (!ReplayOk || R.Packages != Packages || (IsData && Received.load() != Packages)){
+			fprintf(stderr, "%s (%u bytes): %llu of %llu packages decoded\n", Case, PayloadSize,
+					(unsigned long long)R.Packages, (unsigned long long)Packages);
+		}
+	}
+	unlink(FileName);
+	PrintResult(&R);
+	return true;
+}
+
+/*
+ * ### DummyDevice::GetData() ###
+ * -> the data buffer is filled by the fake device first, only the reading is measured
+ */
+static bool RunGetDataCase(uint32_t PayloadSize, uint64_t Packages)
+{
+	uint16_t ValuesPerPackage = (PayloadSize /2 > 0) ? PayloadSize /2 : 1;
+	if (ValuesPerPackage > DUMMYDEVICE_PAYLOAD_SIZE_MAX){
+		ValuesPerPackage = DUMMYDEVICE_PAYLOAD_SIZE_MAX;
+	}
+	uint64_t PackagesPerRound = (DUMMYDEVICE_DATA_BUFFER_SIZE /2) /ValuesPerPackage;
+
+	FakeDevice Fake;
+	Fake.SetDataRate(0, ValuesPerPackage);
+	Fake.SetDataLimit(PackagesPerRound);
+	int fd = Fake.Open();
+	if (fd < 0){
+		return false;
+	}
+	result_t R = {"getdata", PayloadSize, 0, 0.0, 0, 0};
+	{
+		DummyDevice Device("Benchmark", fd);
+		initCMD_t Init = {ValuesPerPackage, 1, 1};
+		initACK_t InitAck;
+		if (!Device.IsDeviceConnected() || !Device.InitialiseMCU(&Init, &InitAck)){
+			return false;
+		}
+		std::vector<int16_t> Data(ValuesPerPackage);
+		while (R.Packages < Packages){
+			// fill the buffer
+			if (!Device.StartMCUApplication()){
+				return false;
+			}
+			Device.WaitForData(PackagesPerRound *ValuesPerPackage, 2000);
+			Device.StopMCUApplication();
+			// read it
+			uint64_t AllocationsStart = Allocations.load();
+			std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+			uint16_t N;
+			uint64_t PackagesInRound = 0;
+			while ((N = Device.GetData(Data.data(), ValuesPerPackage)) > 0){
+				PackagesInRound++;
+				R.Bytes += N *sizeof(int16_t);
+			}
+			R.Seconds += SecondsSince(Start);
+			R.Allocations += Allocations.load() - AllocationsStart;
+			// the fake device sent nothing within the timeout -> abort instead of waiting forever
+			if (PackagesInRound == 0){
+				fprintf(stderr, "getdata (%u bytes): no data received within 2 s after %llu packages\n", PayloadSize,
+						(unsigned long long)R.Packages);
+				return false;
+			}
+			R.Packages += PackagesInRound;
+		}
+	}
+	Fake.Close();
+	PrintResult(&R);
+	return true;
+}
+
+
+// main program
+int main ( int argc, char *argv[] )
+{
+	const char* Cases[] = {"send", "decode", "response", "pipelined", "roundtrip", "getdata"};
+	const char* SelectedCase = NULL;
+	uint64_t Packages = BENCHMARK_DEFAULT_PACKAGES;
+	int Option;
+	while ((Option = getopt(argc, argv, "c:n:o:h")) != -1){
+		switch (Option){
+		case 'c':
+			SelectedCase = optarg;
+			break;
+		case 'n':
+			Packages = strtoull(optarg, NULL, 10);
+			break;
+		case 'o':
+			Output = fopen(optarg, "w");
+			if (Output == NULL){
+				fprintf(stderr, "ERROR: %s can not be opened: %s\n", optarg, strerror(errno));
+				return 1;
+			}
+			break;
+		default:
+			printf("Usage: %s [-c case] [-n packages] [-o results.csv]\n", argv[0]);
+			printf("   -> cases: send, decode, response, pipelined, roundtrip, getdata (default: all)\n");
+			printf("   -> one CSV line per case and payload size; all other output goes to stderr\n");
+			return 1;
+		}
+	}
+	if (Packages == 0){
+		Packages = 1;
+	}
+	if (Output == stdout){
+		// the DummyDevice and the interface class print to stdout -> keep stdout for the CSV lines and send the rest to stderr
+		int fdCsv = dup(STDOUT_FILENO);
+		if (fdCsv < 0 || (Output = fdopen(fdCsv, "w")) == NULL){
+			fprintf(stderr, "ERROR: stdout can not be duplicated: %s\n", strerror(errno));
+			return 1;
+		}
+		fflush(stdout);
+		dup2(STDERR_FILENO, STDOUT_FILENO);
+	}
+
+	fprintf(Output, "case,payload_bytes,packages,ns_per_package,mb_per_s,allocs_per_package\n");
+	bool Ok = true;
+	for (uint32_t c=0; c<sizeof(Cases)/sizeof(Cases[0]); c++){
+		if (SelectedCase != NULL && strcmp(SelectedCase, Cases[c]) != 0){
+			continue;
+		}
+		for (uint32_t s=0; s<sizeof(PayloadSizes)/sizeof(PayloadSizes[0]); s++){
+			if (strcmp(Cases[c], "decode") == 0 || strcmp(Cases[c], "response") == 0){
+				Ok &= RunReceiveCase(Cases[c], PayloadSizes[s], Packages);
+			} else if (strcmp(Cases[c], "getdata") == 0){
+				Ok &= RunGetDataCase(PayloadSizes[s], Packages);
+			} else {
+				Ok &= RunRequestCase(Cases[c], PayloadSizes[s], Packages);
+			}
+		}
+	}
+	fclose(Output);
+	return Ok ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/*
+ * # Replay Capture #
+ *   a C++ program to replay a wire capture of the GSBP_DevDummy device
+ *   through the receive path of the GSBP interface class.
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    ReplayCapture.cpp -> Source file for the replay program (not part of the DevSAP build)
+ *   Version: 1 (09.2020)
+ *
+ *   This file is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This file is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+
+#include "DeviceInterface.hpp"
+
+using namespace std;
+using namespace nsDUMMYDEVICE_01;
+
+// main program
+int main ( int argc, char *argv[] )
+{
+	if (argc < 2){
+		printf("Usage: %s <capture file> [realtime]\n", argv[0]);
+		printf("   -> replays the received bytes of a capture (see GSBP_DD::StartCapture()) or a raw byte dump\n");
+		return 1;
+	}
+	bool RealTime = (argc > 2 && strcmp(argv[2], "realtime") == 0);
+
+	// no device -> only the configuration is needed for the replay
+	GSBP_DD Interface((char*)"Replay");
+	GSBP_DD::gsbpConfiguration_t Config = {0};
+	Config.UpdateDeviceID = false;
+	sprintf(Config.DeviceID, "GSBP");
+	Config.UseThreadToRead = true;
+	Config.NodeInfoCMD_ID = (uint16_t)NodeInfoCMD;
+	Config.NodeInfoACK_ID = (uint16_t)NodeInfoACK;
+	Config.MessageACK_ID  = (uint16_t)MessageACK;
+	Config.ApplicationDataACK_ID = (uint16_t)ApplicationDataACK;
+	Config.DisplayWarnings = true;
+	Config.DisplayErrors   = true;
+	Config.NumberOfHandlerThreads = 1;
+	uint16_t ErrorCode;
+	if (!Interface.UpdateConfiguration(Config, &ErrorCode)){
+		printf("ERROR: The configuration could not be set (%d)!\n", ErrorCode);
+		return 1;
+	}
+
+	// count the measurement values, as the data handler of the device interface would receive them
+	std::atomic<uint64_t> NumberOfDataPackages(0), NumberOfDataValues(0);
+	Interface.Subscribe((uint16_t)ApplicationDataACK, GSBP_DD::MeasurementDataRequestID,
+			[&](GSBP_DD::rxPackage_t *Package){
+				measurementDataACK_t *Data = (measurementDataACK_t*)Package->Data;
+				NumberOfDataPackages++;
+				NumberOfDataValues += Data->numberOfValues;
+			}, &ErrorCode);
+
+	GSBP_DD::replayStatistics_t Stats;
+	bool ReplayOk = Interface.ReplayCapture(argv[1], RealTime, &Stats, &ErrorCode);
+
+	printf("Replay of %s (%s):\n", argv[1], RealTime ? "real time" : "maximum speed");
+	printf("   Chunks:        %llu\n", (unsigned long long)Stats.ChunksReplayed);
+	printf("   Bytes:         %llu\n", (unsigned long long)Stats.BytesReplayed);
+	printf("   Packages:      %llu\n", (unsigned long long)Stats.PackagesDecoded);
+	printf("   Data packages: %llu (%llu values)\n", (unsigned long long)NumberOfDataPackages.load(), (unsigned long long)NumberOfDataValues.load());
+	printf("   Duration:      %.3f s\n", Stats.Seconds);
+	printf("   Throughput:    %.0f packages/s, %.2f MB/s\n", Stats.PackagesPerSecond, Stats.MegaBytesPerSecond);
+	return ReplayOk ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+/*
+ * # Stress Benchmark #
+ *   a C++ program to measure the GSBP interface class with many threads sending requests,
+ *   while the in-memory fake of the GSBP_DevDummy device streams measurement data.
+ *
+ *   Copyright (C) 2015-2020 Markus Valtin <os@markus.valtin.net>
+ *
+ *   Author:  Markus Valtin
+ *   File:    StressBenchmark.cpp -> Source file for the concurrency benchmark (not part of the DevSAP build)
+ *   Version: 1 (09.2020)
+ *
+ *   This file is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This file is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Copyright Header.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+
+#include "FakeDevice.hpp"
+
+using namespace std;
+using namespace nsDUMMYDEVICE_01;
+
+/*
+ * every requester thread alternates between
+ *   StatusCMD    -> StatusACK; the state must be "measurement active"
+ *   ParameterCMD -> ParameterACK; the fake device echoes the payload (thread, sequence number), which must match
+ * while the fake device streams ApplicationDataACK packages (ramp), which are checked for gaps.
+ * A request without a response counts as lost, a response with another ID or content as mismatched.
+ */
+#define STRESS_PARAMETER_CMD			110		// not a GSBP_DevDummy command; echoed by the fake device
+#define STRESS_PARAMETER_ACK			111
+#define STRESS_RESPONSE_TIMEOUT_MS		1000
+#define STRESS_STATE_MEASUREMENT		4		// mcuStates_t::measurementActive
+
+struct parameter_t {
+	uint32_t Thread;
+	uint32_t Sequence;
+	uint8_t  Padding[24];
+};
+
+struct options_t {
+	uint32_t Threads;
+	bool     Sweep;
+	double   Seconds;
+	uint32_t DataPeriodUs;
+	uint16_t ValuesPerPackage;
+	uint32_t LatencyUs;
+	bool     UseThreadToRead;
+};
+
+struct requester_t {
+	std::vector<uint32_t> RoundTripNs;
+	uint64_t Lost;
+	uint64_t Mismatched;
+};
+
+static GSBP_DD::gsbpConfiguration_t GetConfiguration(bool UseThreadToRead)
+{
+	GSBP_DD::gsbpConfiguration_t Config = {0};
+	Config.UpdateDeviceID = false;
+	sprintf(Config.DeviceID, "GSBP");
+	Config.UseThreadToRead = UseThreadToRead;
+	Config.NodeInfoCMD_ID = (uint16_t)NodeInfoCMD;
+	Config.NodeInfoACK_ID = (uint16_t)NodeInfoACK;
+	Config.MessageACK_ID  = (uint16_t)MessageACK;
+	Config.ApplicationDataACK_ID = (uint16_t)ApplicationDataACK;
+	Config.DisplayWarnings = true;
+	Config.DisplayErrors   = true;
+	Config.NumberOfHandlerThreads = 1;
+	return Config;
+}
+
+// stdout only carries the CSV lines -> no statistics at the destruction, the log messages go to stderr
+static void QuietInterface(GSBP_DD* Interface)
+{
+	Interface->EnableDebugCategory(GSBP_DD::DebugGsbpStats, false);
+	Interface->SetLogSink([](const GSBP_DD::logRecord_t* Record){
+		fprintf(stderr, "Stress: %s\n", Record->Message);
+	});
+}
+
+static bool SendAndWait(GSBP_DD* Interface, uint16_t CommandID, const void* Data, uint16_t DataSize, uint16_t AckID)
+{
+	GSBP_DD::txPackage_t P = {0};
+	P.CommandID = CommandID;
+	P.DataSize = DataSize;
+	memcpy(P.Data, Data, DataSize);
+	GSBP_DD::rxPackage_t Ack;
+	uint32_t NumberOfOpenRequests;
+	uint16_t ErrorCode;
+	uint64_t RequestID = Interface->SendPackage(&P, &ErrorCode);
+	return RequestID != 0 && Interface->GetResponse(RequestID, AckID, &Ack, STRESS_RESPONSE_TIMEOUT_MS, &NumberOfOpenRequests, &ErrorCode);
+}
+
+static void Requester(GSBP_DD* Interface, uint32_t Thread, std::chrono::steady_clock::time_point Deadline, requester_t* R)
+{
+	GSBP_DD::txPackage_t P = {0};
+	GSBP_DD::rxPackage_t Ack;
+	parameter_t Parameter = {0};
+	Parameter.Thread = Thread;
+	uint32_t NumberOfOpenRequests;
+	uint16_t ErrorCode;
+	R->RoundTripNs.reserve(1000000);
+	for (uint32_t i=0; std::chrono::steady_clock::now() < Deadline; i++){
+		bool IsStatus = (i % 2 == 0);
+		if (IsStatus){
+			P.CommandID = StatusCMD;
+			P.DataSize = 0;
+		} else {
+			Parameter.Sequence = i;
+			P.CommandID = STRESS_PARAMETER_CMD;
+			P.DataSize = sizeof(Parameter);
+			memcpy(P.Data, &Parameter, sizeof(Parameter));
+		}
+		std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+		uint64_t RequestID = Interface->SendPackage(&P, &ErrorCode);
+		// any response -> a response of another request is detected here and not hidden as a timeout
+		if (RequestID == 0 || !Interface->GetResponse(RequestID, 0, &Ack, STRESS_RESPONSE_TIMEOUT_MS, &NumberOfOpenRequests, &ErrorCode)){
+			R->Lost++;
+			continue;
+		}
+		R->RoundTripNs.push_back((uint32_t)std::min<int64_t>(UINT32_MAX,
+				std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Start).count()));
+		if (IsStatus){
+			mcuStatus_t* Status = (mcuStatus_t*)Ack.Data;
+			if (Ack.CommandID != StatusACK || Ack.DataSize < 3 || Status->state != STRESS_STATE_MEASUREMENT){
+				R->Mismatched++;
+			}
+		} else {
+			if (Ack.CommandID != STRESS_PARAMETER_ACK || Ack.DataSize != sizeof(Parameter) || memcmp(Ack.Data, &Parameter, sizeof(Parameter)) != 0){
+				R->Mismatched++;
+			}
+		}
+	}
+}
+
+static double Percentile(std::vector<uint32_t>& Sorted, double P)
+{
+	if (Sorted.empty()){
+		return 0.0;
+	}
+	size_t Index = (size_t)(P *(Sorted.size() -1) +0.5);
+	return Sorted[Index] /1000.0;
+}
+
+static void PrintLockStatistics(FILE* Output, GSBP_DD::lockStatistics_t* L)
+{
+	fprintf(Output, ",%llu,%llu,%.0f,%llu,%.0f,%llu", (unsigned long long)L->Acquisitions, (unsigned long long)L->Contended,
+			(L->Contended > 0) ? (double)L->WaitNs /L->Contended : 0.0, (unsigned long long)L->WaitNsMax,
+			(L->Acquisitions > 0) ? (double)L->HoldNs /L->Acquisitions : 0.0, (unsigned long long)L->HoldNsMax);
+}
+
+static bool RunStress(options_t* O, uint32_t Threads, FILE* Output)
+{
+	FakeDevice Fake;
+	Fake.SetCommandBehaviour(StatusCMD, FakeAnswer, O->LatencyUs);
+	Fake.SetCommandBehaviour(STRESS_PARAMETER_CMD, FakeEcho, O->LatencyUs);
+	Fake.SetDataRate(O->DataPeriodUs, O->ValuesPerPackage);
+	int fd = Fake.Open();
+	if (fd < 0){
+		return false;
+	}
+	std::vector<requester_t> Requesters(Threads);
+	std::atomic<uint64_t> DataValues(0), DataGaps(0);
+	GSBP_DD::lockStatistics_t RequestResponseLock, ReadPackageLock;
+	double Seconds;
+	{
+		GSBP_DD Interface((char*)"Stress", fd, GSBP_DeviceClass__GSBPdevel, GetConfiguration(O->UseThreadToRead));
+		QuietInterface(&Interface);
+		if (!Interface.IsDeviceConnected()){
+			return false;
+		}
+		// streaming consumer -> the ramp of the fake device must not have gaps
+		int16_t NextValue = 0;
+		uint16_t ErrorCode;
+		Interface.Subscribe((uint16_t)ApplicationDataACK, GSBP_DD::MeasurementDataRequestID,
+				[&](GSBP_DD::rxPackage_t *Package){
+					measurementDataACK_t *Data = (measurementDataACK_t*)Package->Data;
+					if (Data->numberOfValues > 0 && Data->data[0] != NextValue){
+						DataGaps++;
+					}
+					NextValue = (int16_t)(Data->data[0] + Data->numberOfValues);
+					DataValues += Data->numberOfValues;
+				}, &ErrorCode);
+		initCMD_t Init = {O->ValuesPerPackage, 1, 1};
+		if (!SendAndWait(&Interface, InitCMD, &Init, sizeof(Init), InitACK) ||
+				!SendAndWait(&Interface, StartApplicationCMD, NULL, 0, UniversalACK)){
+			fprintf(stderr, "The fake device could not be started!\n");
+			return false;
+		}
+
+		Interface.EnableLockStatistics(true);
+		Interface.GetLockStatistics(NULL, NULL, true);
+		uint64_t DataValuesStart = DataValues.load();
+		std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point Deadline = Start + std::chrono::microseconds((int64_t)(O->Seconds *1e6));
+		std::vector<boost::thread*> RequesterThreads;
+		for (uint32_t t=0; t<Threads; t++){
+			Requesters[t].Lost = 0;
+			Requesters[t].Mismatched = 0;
+			RequesterThreads.push_back(new boost::thread(Requester, &Interface, t, Deadline, &Requesters[t]));
+		}
+		for (uint32_t t=0; t<Threads; t++){
+			RequesterThreads[t]->join();
+			delete RequesterThreads[t];
+		}
+		Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+		DataValues -= DataValuesStart;
+		Interface.GetLockStatistics(&RequestResponseLock, &ReadPackageLock, false);
+		Interface.EnableLockStatistics(false);
+		SendAndWait(&Interface, StopApplicationCMD, NULL, 0, UniversalACK);
+	}
+	Fake.Close();
+
+	// results
+	std::vector<uint32_t> RoundTripNs;
+	uint64_t Lost = 0, Mismatched = 0;
+	for (uint32_t t=0; t<Threads; t++){
+		RoundTripNs.insert(RoundTripNs.end(), Requesters[t].RoundTripNs.begin(), Requesters[t].RoundTripNs.end());
+		Lost += Requesters[t].Lost;
+		Mismatched += Requesters[t].Mismatched;
+	}
+	std::sort(RoundTripNs.begin(), RoundTripNs.end());
+	fprintf(Output, "%u,%s,%llu,%.0f,%.2f,%.1f,%.1f,%.1f,%.1f,%llu,%llu,%llu", Threads, O->UseThreadToRead ? "thread" : "caller",
+			(unsigned long long)RoundTripNs.size(), RoundTripNs.size() /Seconds, DataValues.load() *sizeof(int16_t) /Seconds /1e6,
+			Percentile(RoundTripNs, 0.5), Percentile(RoundTripNs, 0.99), Percentile(RoundTripNs, 0.999),
+			RoundTripNs.empty() ? 0.0 : RoundTripNs.back() /1000.0,
+			(unsigned long long)Lost, (unsigned long long)Mismatched, (unsigned long long)DataGaps.load());
+	PrintLockStatistics(Output, &RequestResponseLock);
+	PrintLockStatistics(Output, &ReadPackageLock);
+	fprintf(Output, "\n");
+	fflush(Output);
+	return true;
+}
+
+
+// main program
+int main ( int argc, char *argv[] )
+{
+	options_t O = {4, false, 3.0, 1000, 256, 0, true};
+	FILE* Output = stdout;
+	int Option;
+	while ((Option = getopt(argc, argv, "t:sd:p:v:l:ro:h")) != -1){
+		switch (Option){
+		case 't': O.Threads = (uint32_t)atoi(optarg); break;
+		case 's': O.Sweep = true; break;
+		case 'd': O.Seconds = atof(optarg); break;
+		case 'p': O.DataPeriodUs = (uint32_t)atoi(optarg); break;
+		case 'v': O.ValuesPerPackage = (uint16_t)atoi(optarg); break;
+		case 'l': O.LatencyUs = (uint32_t)atoi(optarg); break;
+		case 'r': O.UseThreadToRead = false; break;
+		case 'o':
+			Output = fopen(optarg, "w");
+			if (Output == NULL){
+				fprintf(stderr, "ERROR: %s can not be opened: %s\n", optarg, strerror(errno));
+				return 1;
+			}
+			break;
+		default:
+			printf("Usage: %s [-t threads] [-s] [-d seconds] [-p data period us] [-v values per package] [-l latency us] [-r] [-o results.csv]\n", argv[0]);
+			printf("   -> -s: runs 1, 2, 4, ... threads up to -t; -r: no receiver thread, the requesting threads read the packages\n");
+			printf("   -> -p 0: the fake device streams as fast as the interface reads the data\n");
+			printf("   -> one CSV line per run; all other output goes to stderr\n");
+			return 1;
+		}
+	}
+	if (O.Threads == 0){
+		O.Threads = 1;
+	}
+	if (O.ValuesPerPackage == 0 || O.ValuesPerPackage > DUMMYDEVICE_PAYLOAD_SIZE_MAX){
+		O.ValuesPerPackage = DUMMYDEVICE_PAYLOAD_SIZE_MAX;
+	}
+	if (Output == stdout){
+		// the fake device and the interface class print to stdout -> keep stdout for the CSV lines and send the rest to stderr
+		int fdCsv = dup(STDOUT_FILENO);
+		if (fdCsv < 0 || (Output = fdopen(fdCsv, "w")) == NULL){
+			fprintf(stderr, "ERROR: stdout can not be duplicated: %s\n", strerror(errno));
+			return 1;
+		}
+		fflush(stdout);
+		dup2(STDERR_FILENO, STDOUT_FILENO);
+	}
+
+	fprintf(Output, "threads,receiver,requests,requests_per_s,data_mb_per_s,rtt_p50_us,rtt_p99_us,rtt_p999_us,rtt_max_us,lost,mismatched,data_gaps,"
+			"rr_lock_acquisitions,rr_lock_contended,rr_lock_wait_avg_ns,rr_lock_wait_max_ns,rr_lock_hold_avg_ns,rr_lock_hold_max_ns,"
+			"rp_lock_acquisitions,rp_lock_contended,rp_lock_wait_avg_ns,rp_lock_wait_max_ns,rp_lock_hold_avg_ns,rp_lock_hold_max_ns\n");
+	bool Ok = true;
+	for (uint32_t Threads = O.Sweep ? 1 : O.Threads; Threads <= O.Threads; Threads = (Threads *2 <= O.Threads || Threads == O.Threads) ? Threads *2 : O.Threads){
+		Ok &= RunStress(&O, Threads, Output);
+	}
+	fclose(Output);
+	return Ok ? 0 : 1;
+}